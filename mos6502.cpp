@@ -1,5 +1,14 @@
 #include "mos6502.h"
 
+#include <string.h>
+
+#ifdef JIT
+#if !defined(__x86_64__) || !defined(__GNUC__) || !defined(__unix__)
+#error "JIT needs an x86-64 host, GCC/Clang and mmap()"
+#endif
+#include <sys/mman.h>
+#endif
+
 #define NEGATIVE  0x80
 #define OVERFLOW  0x40
 #define CONSTANT  0x20
@@ -9,27 +18,120 @@
 #define ZERO      0x02
 #define CARRY     0x01
 
-#define SET_NEGATIVE(x)  ((x) ? (status |= NEGATIVE)  : (status &= (~NEGATIVE)) )
 #define SET_OVERFLOW(x)  ((x) ? (status |= OVERFLOW)  : (status &= (~OVERFLOW)) )
 #define SET_CONSTANT(x)  ((x) ? (status |= CONSTANT)  : (status &= (~CONSTANT)) )
 #define SET_BREAK(x)     ((x) ? (status |= BREAK)     : (status &= (~BREAK)) )
 #define SET_DECIMAL(x)   ((x) ? (status |= DECIMAL)   : (status &= (~DECIMAL)) )
 #define SET_INTERRUPT(x) ((x) ? (status |= INTERRUPT) : (status &= (~INTERRUPT)) )
-#define SET_ZERO(x)      ((x) ? (status |= ZERO)      : (status &= (~ZERO)) )
 #define SET_CARRY(x)     ((x) ? (status |= CARRY)     : (status &= (~CARRY)) )
 
-#define IF_NEGATIVE()  ((status & NEGATIVE) ? true : false)
 #define IF_OVERFLOW()  ((status & OVERFLOW) ? true : false)
 #define IF_CONSTANT()  ((status & CONSTANT) ? true : false)
 #define IF_BREAK()     ((status & BREAK) ? true : false)
 #define IF_DECIMAL()   ((status & DECIMAL) ? true : false)
 #define IF_INTERRUPT() ((status & INTERRUPT) ? true : false)
-#define IF_ZERO()      ((status & ZERO) ? true : false)
 #define IF_CARRY()     ((status & CARRY) ? true : false)
 
+#ifdef LAZY_FLAGS_STATS
+#define COUNT_NZ_UPDATE() (nz_updates++)
+#define COUNT_NZ_READ()   (nz_reads++)
+#else
+#define COUNT_NZ_UPDATE() ((void)0)
+#define COUNT_NZ_READ()   ((void)0)
+#endif
+
+#ifdef LAZY_FLAGS
+
+// N and Z live outside of status: N is bit 7 of flag_n, Z is set when
+// flag_z is zero. Most ops just record their result byte in both, the
+// status byte is only put together when somebody looks at it.
+#define SET_NEGATIVE(x)  (COUNT_NZ_UPDATE(), flag_n = (x) ? NEGATIVE : 0)
+#define SET_ZERO(x)      (COUNT_NZ_UPDATE(), flag_z = (x) ? 0 : 1)
+#define SET_NZ(x)        (COUNT_NZ_UPDATE(), flag_n = flag_z = (x))
+
+#define IF_NEGATIVE()    (COUNT_NZ_READ(), (flag_n & NEGATIVE) ? true : false)
+#define IF_ZERO()        (COUNT_NZ_READ(), flag_z ? false : true)
+
+// whole status register, N and Z included
+#define STATUS()         (COUNT_NZ_READ(), (uint8_t)((status & ~(NEGATIVE | ZERO)) | \
+                                                     (flag_n & NEGATIVE) | \
+                                                     (flag_z ? 0 : ZERO)))
+#define SET_STATUS(x)    (status = (x), flag_n = status, flag_z = !(status & ZERO))
+
+#else
+
+#define SET_NEGATIVE(x)  ((x) ? (status |= NEGATIVE)  : (status &= (~NEGATIVE)) )
+#define SET_ZERO(x)      ((x) ? (status |= ZERO)      : (status &= (~ZERO)) )
+#define SET_NZ(x)        (SET_NEGATIVE((x) & NEGATIVE), SET_ZERO(!(x)))
+
+#define IF_NEGATIVE()    ((status & NEGATIVE) ? true : false)
+#define IF_ZERO()        ((status & ZERO) ? true : false)
+
+#define STATUS()         (status)
+#define SET_STATUS(x)    (status = (x))
+
+#endif
+
+// the shortcuts that run several instructions as one are off while
+// tracing or profiling
+#ifdef TRACE
+#define TRACING() (trace != nullptr)
+#else
+#define TRACING() false
+#endif
+#ifdef PROFILE
+#define PROFILING() (profile != nullptr)
+#else
+#define PROFILING() false
+#endif
+#define INSTRUMENTED() (TRACING() || PROFILING())
+
+// breakpoints and watchpoints: the bit of an address in a bitmap, a stop
+// pending in the running instruction, any watchpoint set
+#ifdef BREAKPOINTS
+#define ADDR_BIT(BITS, ADDR) ((BITS[(ADDR) >> 6] >> ((ADDR) & 63)) & 1)
+#define STOPPING() stopping
+#define WATCHING() (watchPages != 0)
+#else
+#define STOPPING() false
+#define WATCHING() false
+#endif
+
+// the performance counters only see the instructions that run, so no idle
+// loop is skipped
+#ifdef PERF_COUNTERS
+#define COUNTING() true
+#else
+#define COUNTING() false
+#endif
+
+// counted by every opcode handler. Taken branches cost one cycle, the
+// rest of their penalty and that of the indexed modes is for crossings
+#ifdef PERF_COUNTERS
+#define PERF_COUNT(HEX, MODE, CYCLES, ELAPSED) \
+   perf.instructions++; \
+   perf.cycles += ELAPSED; \
+   perf.opcodes[HEX]++; \
+   perf.modes[MODE_ ## MODE]++; \
+   if (MODE_ ## MODE == MODE_REL) { \
+      if (branched) perf.branchesTaken++; \
+      else perf.branchesNotTaken++; \
+      perf.crossings += crossed; \
+   } \
+   else perf.crossings += (ELAPSED) - (CYCLES)
+#else
+#define PERF_COUNT(HEX, MODE, CYCLES, ELAPSED)
+#endif
+
 mos6502::Instr mos6502::InstrTable[256];
 
-mos6502::mos6502(BusRead r, BusWrite w, ClockCycle c)
+#if defined(BUS_HEADER)
+mos6502::mos6502(mos6502_bus* bus, ClockCycles c)
+#elif defined(BUS_CONTEXT)
+mos6502::mos6502(BusReadCtx r, BusWriteCtx w, void* ctx, ClockCycles c)
+#else
+mos6502::mos6502(BusRead r, BusWrite w, ClockCycles c)
+#endif
    : reset_A(0x00)
    , reset_X(0x00)
    , reset_Y(0x00)
@@ -40,9 +142,120 @@ mos6502::mos6502(BusRead r, BusWrite w, ClockCycle c)
    , nmi_inhibit(false)
    , nmi_line(true)
 {
-   Write = (BusWrite)w;
-   Read = (BusRead)r;
-   Cycle = (ClockCycle)c;
+#ifdef BUS_HEADER
+   this->bus = bus;
+#else
+   busWrite = w;
+   busRead = r;
+#endif
+#ifdef BUS_CONTEXT
+   readCtx = ctx;
+   writeCtx = ctx;
+#endif
+   Cycles = (ClockCycles)c;
+   Cycle = nullptr;
+   cycleStamp = 0;
+   illegalOpcode = false;
+
+   eventCount = 0;
+   eventSerial = 0;
+   eventNext = UINT64_MAX;
+
+#ifdef MEMORY_MAP
+   for(int i = 0; i < 256; i++)
+   {
+      readPage[i] = nullptr;
+      writePage[i] = nullptr;
+   }
+#endif
+
+#ifdef BLOCK_CACHE
+   blocks = new Block[BLOCK_CACHE_SIZE]();
+   for(int i = 0; i < 256; i++)
+   {
+      pageGen[i] = 0;
+   }
+   flushes = 0;
+   fetch = nullptr;
+#endif
+
+#ifdef SUPERINSTRUCTIONS
+   pairSplit = false;
+#endif
+
+#ifdef IDLE_LOOPS
+   for(int i = 0; i < 256; i++)
+   {
+      idleSafe[i] = false;
+   }
+   idleArmed = false;
+   idleClean = false;
+#endif
+#ifdef SUPERINSTRUCTIONS_STATS
+   for(int i = 0; i < PAIR_COUNT; i++)
+   {
+      pairRuns[i] = 0;
+   }
+#endif
+
+#ifdef JIT
+   jitCode = (uint8_t*)mmap(nullptr, JIT_CODE_SIZE,
+         PROT_READ | PROT_WRITE | PROT_EXEC,
+         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+   if (jitCode == MAP_FAILED)
+   {
+      jitCode = nullptr;
+   }
+   jitUsed = 0;
+   jitBlocks = 0;
+   jitEnabled = jitCode != nullptr;
+#endif
+
+#ifdef LAZY_FLAGS_STATS
+   nz_updates = 0;
+   nz_reads = 0;
+#endif
+
+#ifdef PERF_COUNTERS
+   ClearPerfCounters();
+#endif
+
+#ifdef BREAKPOINTS
+   memset(breakBits, 0, sizeof(breakBits));
+   memset(readBits, 0, sizeof(readBits));
+   memset(writeBits, 0, sizeof(writeBits));
+   memset(untilBits, 0, sizeof(untilBits));
+   memset(watchPage, 0, sizeof(watchPage));
+   watchPages = 0;
+#ifdef MEMORY_MAP
+   for(int i = 0; i < 256; i++)
+   {
+      mapRead[i] = nullptr;
+      mapWrite[i] = nullptr;
+   }
+#endif
+   breakResume = -1;
+   stopping = false;
+   stopBrk = false;
+   stopTrap = false;
+   stopReason = STOP_NONE;
+   stopAddr = 0;
+#endif
+
+#ifdef PROFILE
+   profile = nullptr;
+#endif
+
+#ifdef TRACE
+   traceAddr = 0;
+   traceOperand = 0;
+   traceData = 0;
+   trace = nullptr;
+   traceUsed = 0;
+   traceSize = 0;
+   traceFlush = nullptr;
+   traceCtx = nullptr;
+#endif
 
    static bool initialized = false;
    if (initialized) return;
@@ -56,11 +269,27 @@ mos6502::mos6502(BusRead r, BusWrite w, ClockCycle c)
    instr.scode = "(null)";
    instr.penalty = false;
    instr.cycles = 0;
+   instr.bytes = 1;
    for(int i = 0; i < 256; i++)
    {
       InstrTable[i] = instr;
    }
 
+   // instruction length by addressing mode
+#define BYTES_ACC 1
+#define BYTES_IMP 1
+#define BYTES_IMM 2
+#define BYTES_ZER 2
+#define BYTES_ZEX 2
+#define BYTES_ZEY 2
+#define BYTES_REL 2
+#define BYTES_INX 2
+#define BYTES_INY 2
+#define BYTES_ABS 3
+#define BYTES_ABX 3
+#define BYTES_ABY 3
+#define BYTES_ABI 3
+
    // insert opcodes
 #define MAKE_INSTR(HEX, CODE, MODE, CYCLES, PENALTY) \
    instr.code = &mos6502::Op_ ## CODE; \
@@ -69,1319 +298,444 @@ mos6502::mos6502(BusRead r, BusWrite w, ClockCycle c)
    instr.saddr = # MODE; \
    instr.cycles = CYCLES; \
    instr.penalty = PENALTY; \
+   instr.bytes = BYTES_ ## MODE; \
    InstrTable[HEX] = instr;
 
-// ADC
-// Add Memory to Accumulator with Carry
-//
-// A + M + C -> A, C
-// N    Z       C       I       D       V
-// +    +       +       -       -       +
-// addressing   assembler       opc     bytes   cycles
-// immediate    ADC #oper       69      2       2
-// zeropage     ADC oper        65      2       3
-// zeropage,X   ADC oper,X      75      2       4
-// absolute     ADC oper        6D      3       4
-// absolute,X   ADC oper,X      7D      3       4*
-// absolute,Y   ADC oper,Y      79      3       4*
-// (indirect,X) ADC (oper,X)    61      2       6
-// (indirect),Y ADC (oper),Y    71      2       5*
-
-   MAKE_INSTR(0x69, ADC, IMM, 2, false);
-   MAKE_INSTR(0x65, ADC, ZER, 3, false);
-   MAKE_INSTR(0x75, ADC, ZEX, 4, false);
-   MAKE_INSTR(0x6D, ADC, ABS, 4, false);
-   MAKE_INSTR(0x7D, ADC, ABX, 4, true);
-   MAKE_INSTR(0x79, ADC, ABY, 4, true);
-   MAKE_INSTR(0x61, ADC, INX, 6, false);
-   MAKE_INSTR(0x71, ADC, INY, 5, true);
-
-// AND
-// AND Memory with Accumulator
-//
-// A AND M -> A
-// N    Z       C       I       D       V
-// +    +       -       -       -       -
-// addressing   assembler       opc     bytes   cycles
-// immediate    AND #oper       29      2       2
-// zeropage     AND oper        25      2       3
-// zeropage,X   AND oper,X      35      2       4
-// absolute     AND oper        2D      3       4
-// absolute,X   AND oper,X      3D      3       4*
-// absolute,Y   AND oper,Y      39      3       4*
-// (indirect,X) AND (oper,X)    21      2       6
-// (indirect),Y AND (oper),Y    31      2       5*
-
-   MAKE_INSTR(0x29, AND, IMM, 2, false);
-   MAKE_INSTR(0x25, AND, ZER, 3, false);
-   MAKE_INSTR(0x35, AND, ZEX, 4, false);
-   MAKE_INSTR(0x2D, AND, ABS, 4, false);
-   MAKE_INSTR(0x3D, AND, ABX, 4, true);
-   MAKE_INSTR(0x39, AND, ABY, 4, true);
-   MAKE_INSTR(0x21, AND, INX, 6, false);
-   MAKE_INSTR(0x31, AND, INY, 5, true);
-
-// ASL
-// Shift Left One Bit (Memory or Accumulator)
-//
-// C <- [76543210] <- 0
-// N    Z       C       I       D       V
-// +    +       +       -       -       -
-// addressing   assembler       opc     bytes   cycles
-// accumulator  ASL A           0A      1       2
-// zeropage     ASL oper        06      2       5
-// zeropage,X   ASL oper,X      16      2       6
-// absolute     ASL oper        0E      3       6
-// absolute,X   ASL oper,X      1E      3       7
-
-   MAKE_INSTR(0x0A, ASL_ACC, ACC, 2, false);
-   MAKE_INSTR(0x06, ASL, ZER, 5, false);
-   MAKE_INSTR(0x16, ASL, ZEX, 6, false);
-   MAKE_INSTR(0x0E, ASL, ABS, 6, false);
-   MAKE_INSTR(0x1E, ASL, ABX, 7, false);
-
-// BCC
-// Branch on Carry Clear
-//
-// branch on C = 0
-// N    Z       C       I       D       V
-// -    -       -       -       -       -
-// addressing   assembler       opc     bytes   cycles
-// relative     BCC oper        90      2       2**
-
-   MAKE_INSTR(0x90, BCC, REL, 2, true);
-
-// BCS
-// Branch on Carry Set
-//
-// branch on C = 1
-// N    Z       C       I       D       V
-// -    -       -       -       -       -
-// addressing   assembler       opc     bytes   cycles
-// relative     BCS oper        B0      2       2**
-
-   MAKE_INSTR(0xB0, BCS, REL, 2, true);
-
-// BEQ
-// Branch on Result Zero
-//
-// branch on Z = 1
-// N    Z       C       I       D       V
-// -    -       -       -       -       -
-// addressing   assembler       opc     bytes   cycles
-// relative     BEQ oper        F0      2       2**
-
-   MAKE_INSTR(0xF0, BEQ, REL, 2, true);
-
-// BIT
-// Test Bits in Memory with Accumulator
-//
-// bits 7 and 6 of operand are transfered to bit 7 and 6 of SR (N,V);
-// the zero-flag is set according to the result of the operand AND
-// the accumulator (set, if the result is zero, unset otherwise).
-// This allows a quick check of a few bits at once without affecting
-// any of the registers, other than the status register (SR).
-//
-// → Further details.
-//
-// A AND M -> Z, M7 -> N, M6 -> V
-// N    Z       C       I       D       V
-// M7   +       -       -       -       M6
-// addressing   assembler       opc     bytes   cycles
-// zeropage     BIT oper        24      2       3
-// absolute     BIT oper        2C      3       4
-
-   MAKE_INSTR(0x24, BIT, ZER, 3, false);
-   MAKE_INSTR(0x2C, BIT, ABS, 4, false);
-
-// BMI
-// Branch on Result Minus
-//
-// branch on N = 1
-// N    Z       C       I       D       V
-// -    -       -       -       -       -
-// addressing   assembler       opc     bytes   cycles
-// relative     BMI oper        30      2       2**
-
-   MAKE_INSTR(0x30, BMI, REL, 2, true);
-
-// BNE
-// Branch on Result not Zero
-//
-// branch on Z = 0
-// N    Z       C       I       D       V
-// -    -       -       -       -       -
-// addressing   assembler       opc     bytes   cycles
-// relative     BNE oper        D0      2       2**
-
-   MAKE_INSTR(0xD0, BNE, REL, 2, true);
-
-// BPL
-// Branch on Result Plus
-//
-// branch on N = 0
-// N    Z       C       I       D       V
-// -    -       -       -       -       -
-// addressing   assembler       opc     bytes   cycles
-// relative     BPL oper        10      2       2**
-
-   MAKE_INSTR(0x10, BPL, REL, 2, true);
-
-// BRK
-// Force Break
-//
-// BRK initiates a software interrupt similar to a hardware
-// interrupt (IRQ). The return address pushed to the stack is
-// PC+2, providing an extra byte of spacing for a break mark
-// (identifying a reason for the break.)
-// The status register will be pushed to the stack with the break
-// flag set to 1. However, when retrieved during RTI or by a PLP
-// instruction, the break flag will be ignored.
-// The interrupt disable flag is not set automatically.
-//
-// → Further details.
-//
-// interrupt,
-// push PC+2, push SR
-// N    Z       C       I       D       V
-// -    -       -       1       -       -
-// addressing   assembler       opc     bytes   cycles
-// implied      BRK     00      1       7
-
-   MAKE_INSTR(0x00, BRK, IMP, 7, false);
-
-// BVC
-// Branch on Overflow Clear
-//
-// branch on V = 0
-// N    Z       C       I       D       V
-// -    -       -       -       -       -
-// addressing   assembler       opc     bytes   cycles
-// relative     BVC oper        50      2       2**
-
-   MAKE_INSTR(0x50, BVC, REL, 2, true);
-
-// BVS
-// Branch on Overflow Set
-//
-// branch on V = 1
-// N    Z       C       I       D       V
-// -    -       -       -       -       -
-// addressing   assembler       opc     bytes   cycles
-// relative     BVS oper        70      2       2**
-
-   MAKE_INSTR(0x70, BVS, REL, 2, true);
-
-// CLC
-// Clear Carry Flag
-//
-// 0 -> C
-// N    Z       C       I       D       V
-// -    -       0       -       -       -
-// addressing   assembler       opc     bytes   cycles
-// implied      CLC     18      1       2
-
-   MAKE_INSTR(0x18, CLC, IMP, 2, false);
-
-// CLD
-// Clear Decimal Mode
-//
-// 0 -> D
-// N    Z       C       I       D       V
-// -    -       -       -       0       -
-// addressing   assembler       opc     bytes   cycles
-// implied      CLD     D8      1       2
-
-   MAKE_INSTR(0xD8, CLD, IMP, 2, false);
-
-// CLI
-// Clear Interrupt Disable Bit
-//
-// 0 -> I
-// N    Z       C       I       D       V
-// -    -       -       0       -       -
-// addressing   assembler       opc     bytes   cycles
-// implied      CLI     58      1       2
-
-   MAKE_INSTR(0x58, CLI, IMP, 2, false);
-
-// CLV
-// Clear Overflow Flag
-//
-// 0 -> V
-// N    Z       C       I       D       V
-// -    -       -       -       -       0
-// addressing   assembler       opc     bytes   cycles
-// implied      CLV     B8      1       2
-
-   MAKE_INSTR(0xB8, CLV, IMP, 2, false);
-
-// CMP
-// Compare Memory with Accumulator
-//
-// A - M
-// N    Z       C       I       D       V
-// +    +       +       -       -       -
-// addressing   assembler       opc     bytes   cycles
-// immediate    CMP #oper       C9      2       2
-// zeropage     CMP oper        C5      2       3
-// zeropage,X   CMP oper,X      D5      2       4
-// absolute     CMP oper        CD      3       4
-// absolute,X   CMP oper,X      DD      3       4*
-// absolute,Y   CMP oper,Y      D9      3       4*
-// (indirect,X) CMP (oper,X)    C1      2       6
-// (indirect),Y CMP (oper),Y    D1      2       5*
-
-   MAKE_INSTR(0xC9, CMP, IMM, 2, false);
-   MAKE_INSTR(0xC5, CMP, ZER, 3, false);
-   MAKE_INSTR(0xD5, CMP, ZEX, 4, false);
-   MAKE_INSTR(0xCD, CMP, ABS, 4, false);
-   MAKE_INSTR(0xDD, CMP, ABX, 4, true);
-   MAKE_INSTR(0xD9, CMP, ABY, 4, true);
-   MAKE_INSTR(0xC1, CMP, INX, 6, false);
-   MAKE_INSTR(0xD1, CMP, INY, 5, true);
-
-// CPX
-// Compare Memory and Index X
-//
-// X - M
-// N    Z       C       I       D       V
-// +    +       +       -       -       -
-// addressing   assembler       opc     bytes   cycles
-// immediate    CPX #oper       E0      2       2
-// zeropage     CPX oper        E4      2       3
-// absolute     CPX oper        EC      3       4
-
-   MAKE_INSTR(0xE0, CPX, IMM, 2, false);
-   MAKE_INSTR(0xE4, CPX, ZER, 3, false);
-   MAKE_INSTR(0xEC, CPX, ABS, 4, false);
-
-// CPY
-// Compare Memory and Index Y
-//
-// Y - M
-// N    Z       C       I       D       V
-// +    +       +       -       -       -
-// addressing   assembler       opc     bytes   cycles
-// immediate    CPY #oper       C0      2       2
-// zeropage     CPY oper        C4      2       3
-// absolute     CPY oper        CC      3       4
-
-   MAKE_INSTR(0xC0, CPY, IMM, 2, false);
-   MAKE_INSTR(0xC4, CPY, ZER, 3, false);
-   MAKE_INSTR(0xCC, CPY, ABS, 4, false);
-
-// DEC
-// Decrement Memory by One
-//
-// M - 1 -> M
-// N    Z       C       I       D       V
-// +    +       -       -       -       -
-// addressing   assembler       opc     bytes   cycles
-// zeropage     DEC oper        C6      2       5
-// zeropage,X   DEC oper,X      D6      2       6
-// absolute     DEC oper        CE      3       6
-// absolute,X   DEC oper,X      DE      3       7
-
-   MAKE_INSTR(0xC6, DEC, ZER, 5, false);
-   MAKE_INSTR(0xD6, DEC, ZEX, 6, false);
-   MAKE_INSTR(0xCE, DEC, ABS, 6, false);
-   MAKE_INSTR(0xDE, DEC, ABX, 7, false);
-
-// DEX
-// Decrement Index X by One
-//
-// X - 1 -> X
-// N    Z       C       I       D       V
-// +    +       -       -       -       -
-// addressing   assembler       opc     bytes   cycles
-// implied      DEX     CA      1       2
-
-   MAKE_INSTR(0xCA, DEX, IMP, 2, false);
-
-// DEY
-// Decrement Index Y by One
-//
-// Y - 1 -> Y
-// N    Z       C       I       D       V
-// +    +       -       -       -       -
-// addressing   assembler       opc     bytes   cycles
-// implied      DEY     88      1       2
-
-   MAKE_INSTR(0x88, DEY, IMP, 2, false);
-
-// EOR
-// Exclusive-OR Memory with Accumulator
-//
-// A EOR M -> A
-// N    Z       C       I       D       V
-// +    +       -       -       -       -
-// addressing   assembler       opc     bytes   cycles
-// immediate    EOR #oper       49      2       2
-// zeropage     EOR oper        45      2       3
-// zeropage,X   EOR oper,X      55      2       4
-// absolute     EOR oper        4D      3       4
-// absolute,X   EOR oper,X      5D      3       4*
-// absolute,Y   EOR oper,Y      59      3       4*
-// (indirect,X) EOR (oper,X)    41      2       6
-// (indirect),Y EOR (oper),Y    51      2       5*
-
-   MAKE_INSTR(0x49, EOR, IMM, 2, false);
-   MAKE_INSTR(0x45, EOR, ZER, 3, false);
-   MAKE_INSTR(0x55, EOR, ZEX, 4, false);
-   MAKE_INSTR(0x4D, EOR, ABS, 4, false);
-   MAKE_INSTR(0x5D, EOR, ABX, 4, true);
-   MAKE_INSTR(0x59, EOR, ABY, 4, true);
-   MAKE_INSTR(0x41, EOR, INX, 6, false);
-   MAKE_INSTR(0x51, EOR, INY, 5, true);
-
-// INC
-// Increment Memory by One
-//
-// M + 1 -> M
-// N    Z       C       I       D       V
-// +    +       -       -       -       -
-// addressing   assembler       opc     bytes   cycles
-// zeropage     INC oper        E6      2       5
-// zeropage,X   INC oper,X      F6      2       6
-// absolute     INC oper        EE      3       6
-// absolute,X   INC oper,X      FE      3       7
-
-   MAKE_INSTR(0xE6, INC, ZER, 5, false);
-   MAKE_INSTR(0xF6, INC, ZEX, 6, false);
-   MAKE_INSTR(0xEE, INC, ABS, 6, false);
-   MAKE_INSTR(0xFE, INC, ABX, 7, false);
-
-// INX
-// Increment Index X by One
-//
-// X + 1 -> X
-// N    Z       C       I       D       V
-// +    +       -       -       -       -
-// addressing   assembler       opc     bytes   cycles
-// implied      INX     E8      1       2
-
-   MAKE_INSTR(0xE8, INX, IMP, 2, false);
-
-// INY
-// Increment Index Y by One
-//
-// Y + 1 -> Y
-// N    Z       C       I       D       V
-// +    +       -       -       -       -
-// addressing   assembler       opc     bytes   cycles
-// implied      INY     C8      1       2
-
-   MAKE_INSTR(0xC8, INY, IMP, 2, false);
-
-// JMP
-// Jump to New Location
-//
-// operand 1st byte -> PCL
-// operand 2nd byte -> PCH
-// N    Z       C       I       D       V
-// -    -       -       -       -       -
-// addressing   assembler       opc     bytes   cycles
-// absolute     JMP oper        4C      3       3
-// indirect     JMP (oper)      6C      3       5
-
-   MAKE_INSTR(0x4C, JMP, ABS, 3, false);
-   MAKE_INSTR(0x6C, JMP, ABI, 5, false);
-
-// JSR
-// Jump to New Location Saving Return Address
-//
-// push (PC+2),
-// operand 1st byte -> PCL
-// operand 2nd byte -> PCH
-// N    Z       C       I       D       V
-// -    -       -       -       -       -
-// addressing   assembler       opc     bytes   cycles
-// absolute     JSR oper        20      3       6
-
-   MAKE_INSTR(0x20, JSR, ABS, 6, false);
-
-// LDA
-// Load Accumulator with Memory
-//
-// M -> A
-// N    Z       C       I       D       V
-// +    +       -       -       -       -
-// addressing   assembler       opc     bytes   cycles
-// immediate    LDA #oper       A9      2       2
-// zeropage     LDA oper        A5      2       3
-// zeropage,X   LDA oper,X      B5      2       4
-// absolute     LDA oper        AD      3       4
-// absolute,X   LDA oper,X      BD      3       4*
-// absolute,Y   LDA oper,Y      B9      3       4*
-// (indirect,X) LDA (oper,X)    A1      2       6
-// (indirect),Y LDA (oper),Y    B1      2       5*
-
-   MAKE_INSTR(0xA9, LDA, IMM, 2, false);
-   MAKE_INSTR(0xA5, LDA, ZER, 3, false);
-   MAKE_INSTR(0xB5, LDA, ZEX, 4, false);
-   MAKE_INSTR(0xAD, LDA, ABS, 4, false);
-   MAKE_INSTR(0xBD, LDA, ABX, 4, true);
-   MAKE_INSTR(0xB9, LDA, ABY, 4, true);
-   MAKE_INSTR(0xA1, LDA, INX, 6, false);
-   MAKE_INSTR(0xB1, LDA, INY, 5, true);
-
-// LDX
-// Load Index X with Memory
-//
-// M -> X
-// N    Z       C       I       D       V
-// +    +       -       -       -       -
-// addressing   assembler       opc     bytes   cycles
-// immediate    LDX #oper       A2      2       2
-// zeropage     LDX oper        A6      2       3
-// zeropage,Y   LDX oper,Y      B6      2       4
-// absolute     LDX oper        AE      3       4
-// absolute,Y   LDX oper,Y      BE      3       4*
-
-   MAKE_INSTR(0xA2, LDX, IMM, 2, false);
-   MAKE_INSTR(0xA6, LDX, ZER, 3, false);
-   MAKE_INSTR(0xB6, LDX, ZEY, 4, false);
-   MAKE_INSTR(0xAE, LDX, ABS, 4, false);
-   MAKE_INSTR(0xBE, LDX, ABY, 4, true);
-
-// LDY
-// Load Index Y with Memory
-//
-// M -> Y
-// N    Z       C       I       D       V
-// +    +       -       -       -       -
-// addressing   assembler       opc     bytes   cycles
-// immediate    LDY #oper       A0      2       2
-// zeropage     LDY oper        A4      2       3
-// zeropage,X   LDY oper,X      B4      2       4
-// absolute     LDY oper        AC      3       4
-// absolute,X   LDY oper,X      BC      3       4*
-
-   MAKE_INSTR(0xA0, LDY, IMM, 2, false);
-   MAKE_INSTR(0xA4, LDY, ZER, 3, false);
-   MAKE_INSTR(0xB4, LDY, ZEX, 4, false);
-   MAKE_INSTR(0xAC, LDY, ABS, 4, false);
-   MAKE_INSTR(0xBC, LDY, ABX, 4, true);
-
-// LSR
-// Shift One Bit Right (Memory or Accumulator)
-//
-// 0 -> [76543210] -> C
-// N    Z       C       I       D       V
-// 0    +       +       -       -       -
-// addressing   assembler       opc     bytes   cycles
-// accumulator  LSR A           4A      1       2
-// zeropage     LSR oper        46      2       5
-// zeropage,X   LSR oper,X      56      2       6
-// absolute     LSR oper        4E      3       6
-// absolute,X   LSR oper,X      5E      3       7
-
-   MAKE_INSTR(0x4A, LSR_ACC, ACC, 2, false);
-   MAKE_INSTR(0x46, LSR, ZER, 5, false);
-   MAKE_INSTR(0x56, LSR, ZEX, 6, false);
-   MAKE_INSTR(0x4E, LSR, ABS, 6, false);
-   MAKE_INSTR(0x5E, LSR, ABX, 7, false);
-
-// NOP
-// No Operation
-//
-// ---
-// N    Z       C       I       D       V
-// -    -       -       -       -       -
-// addressing   assembler       opc     bytes   cycles
-// implied      NOP     EA      1       2
-
-   MAKE_INSTR(0xEA, NOP, IMP, 2, false);
-
-// ORA
-// OR Memory with Accumulator
-//
-// A OR M -> A
-// N    Z       C       I       D       V
-// +    +       -       -       -       -
-// addressing   assembler       opc     bytes   cycles
-// immediate    ORA #oper       09      2       2
-// zeropage     ORA oper        05      2       3
-// zeropage,X   ORA oper,X      15      2       4
-// absolute     ORA oper        0D      3       4
-// absolute,X   ORA oper,X      1D      3       4*
-// absolute,Y   ORA oper,Y      19      3       4*
-// (indirect,X) ORA (oper,X)    01      2       6
-// (indirect),Y ORA (oper),Y    11      2       5*
-
-   MAKE_INSTR(0x09, ORA, IMM, 2, false);
-   MAKE_INSTR(0x05, ORA, ZER, 3, false);
-   MAKE_INSTR(0x15, ORA, ZEX, 4, false);
-   MAKE_INSTR(0x0D, ORA, ABS, 4, false);
-   MAKE_INSTR(0x1D, ORA, ABX, 4, true);
-   MAKE_INSTR(0x19, ORA, ABY, 4, true);
-   MAKE_INSTR(0x01, ORA, INX, 6, false);
-   MAKE_INSTR(0x11, ORA, INY, 5, true);
-
-// PHA
-// Push Accumulator on Stack
-//
-// push A
-// N    Z       C       I       D       V
-// -    -       -       -       -       -
-// addressing   assembler       opc     bytes   cycles
-// implied      PHA     48      1       3
-
-   MAKE_INSTR(0x48, PHA, IMP, 3, false);
-
-// PHP
-// Push Processor Status on Stack
-//
-// The status register will be pushed with the break
-// flag and bit 5 set to 1.
-//
-// push SR
-// N    Z       C       I       D       V
-// -    -       -       -       -       -
-// addressing   assembler       opc     bytes   cycles
-// implied      PHP     08      1       3
-
-   MAKE_INSTR(0x08, PHP, IMP, 3, false);
-
-// PLA
-// Pull Accumulator from Stack
-//
-// pull A
-// N    Z       C       I       D       V
-// +    +       -       -       -       -
-// addressing   assembler       opc     bytes   cycles
-// implied      PLA     68      1       4
-
-   MAKE_INSTR(0x68, PLA, IMP, 4, false);
-
-// PLP
-// Pull Processor Status from Stack
-//
-// The status register will be pulled with the break
-// flag and bit 5 ignored.
-//
-// pull SR
-// N    Z       C       I       D       V
-// from stack
-// addressing   assembler       opc     bytes   cycles
-// implied      PLP     28      1       4
-
-   MAKE_INSTR(0x28, PLP, IMP, 4, false);
-
-// ROL
-// Rotate One Bit Left (Memory or Accumulator)
-//
-// C <- [76543210] <- C
-// N    Z       C       I       D       V
-// +    +       +       -       -       -
-// addressing   assembler       opc     bytes   cycles
-// accumulator  ROL A           2A      1       2
-// zeropage     ROL oper        26      2       5
-// zeropage,X   ROL oper,X      36      2       6
-// absolute     ROL oper        2E      3       6
-// absolute,X   ROL oper,X      3E      3       7
-
-   MAKE_INSTR(0x2A, ROL_ACC, ACC, 2, false);
-   MAKE_INSTR(0x26, ROL, ZER, 5, false);
-   MAKE_INSTR(0x36, ROL, ZEX, 6, false);
-   MAKE_INSTR(0x2E, ROL, ABS, 6, false);
-   MAKE_INSTR(0x3E, ROL, ABX, 7, false);
-
-// ROR
-// Rotate One Bit Right (Memory or Accumulator)
-//
-// C -> [76543210] -> C
-// N    Z       C       I       D       V
-// +    +       +       -       -       -
-// addressing   assembler       opc     bytes   cycles
-// accumulator  ROR A           6A      1       2
-// zeropage     ROR oper        66      2       5
-// zeropage,X   ROR oper,X      76      2       6
-// absolute     ROR oper        6E      3       6
-// absolute,X   ROR oper,X      7E      3       7
-
-   MAKE_INSTR(0x6A, ROR_ACC, ACC, 2, false);
-   MAKE_INSTR(0x66, ROR, ZER, 5, false);
-   MAKE_INSTR(0x76, ROR, ZEX, 6, false);
-   MAKE_INSTR(0x6E, ROR, ABS, 6, false);
-   MAKE_INSTR(0x7E, ROR, ABX, 7, false);
-
-// RTI
-// Return from Interrupt
-//
-// The status register is pulled with the break flag
-// and bit 5 ignored. Then PC is pulled from the stack.
-//
-// pull SR, pull PC
-// N    Z       C       I       D       V
-// from stack
-// addressing   assembler       opc     bytes   cycles
-// implied      RTI     40      1       6
-
-   MAKE_INSTR(0x40, RTI, IMP, 6, false);
-
-// RTS
-// Return from Subroutine
-//
-// pull PC, PC+1 -> PC
-// N    Z       C       I       D       V
-// -    -       -       -       -       -
-// addressing   assembler       opc     bytes   cycles
-// implied      RTS     60      1       6
-
-   MAKE_INSTR(0x60, RTS, IMP, 6, false);
-
-// SBC
-// Subtract Memory from Accumulator with Borrow
-//
-// A - M - C̅ -> A
-// N    Z       C       I       D       V
-// +    +       +       -       -       +
-// addressing   assembler       opc     bytes   cycles
-// immediate    SBC #oper       E9      2       2
-// zeropage     SBC oper        E5      2       3
-// zeropage,X   SBC oper,X      F5      2       4
-// absolute     SBC oper        ED      3       4
-// absolute,X   SBC oper,X      FD      3       4*
-// absolute,Y   SBC oper,Y      F9      3       4*
-// (indirect,X) SBC (oper,X)    E1      2       6
-// (indirect),Y SBC (oper),Y    F1      2       5*
-
-   MAKE_INSTR(0xE9, SBC, IMM, 2, false);
-   MAKE_INSTR(0xE5, SBC, ZER, 3, false);
-   MAKE_INSTR(0xF5, SBC, ZEX, 4, false);
-   MAKE_INSTR(0xED, SBC, ABS, 4, false);
-   MAKE_INSTR(0xFD, SBC, ABX, 4, true);
-   MAKE_INSTR(0xF9, SBC, ABY, 4, true);
-   MAKE_INSTR(0xE1, SBC, INX, 6, false);
-   MAKE_INSTR(0xF1, SBC, INY, 5, true);
-
-// SEC
-// Set Carry Flag
-//
-// 1 -> C
-// N    Z       C       I       D       V
-// -    -       1       -       -       -
-// addressing   assembler       opc     bytes   cycles
-// implied      SEC     38      1       2
-
-   MAKE_INSTR(0x38, SEC, IMP, 2, false);
-
-// SED
-// Set Decimal Flag
-//
-// 1 -> D
-// N    Z       C       I       D       V
-// -    -       -       -       1       -
-// addressing   assembler       opc     bytes   cycles
-// implied      SED     F8      1       2
-
-   MAKE_INSTR(0xF8, SED, IMP, 2, false);
-
-// SEI
-// Set Interrupt Disable Status
-//
-// 1 -> I
-// N    Z       C       I       D       V
-// -    -       -       1       -       -
-// addressing   assembler       opc     bytes   cycles
-// implied      SEI     78      1       2
-
-   MAKE_INSTR(0x78, SEI, IMP, 2, false);
-
-// STA
-// Store Accumulator in Memory
-//
-// A -> M
-// N    Z       C       I       D       V
-// -    -       -       -       -       -
-// addressing   assembler       opc     bytes   cycles
-// zeropage     STA oper        85      2       3
-// zeropage,X   STA oper,X      95      2       4
-// absolute     STA oper        8D      3       4
-// absolute,X   STA oper,X      9D      3       5
-// absolute,Y   STA oper,Y      99      3       5
-// (indirect,X) STA (oper,X)    81      2       6
-// (indirect),Y STA (oper),Y    91      2       6
-
-   MAKE_INSTR(0x85, STA, ZER, 3, false);
-   MAKE_INSTR(0x95, STA, ZEX, 4, false);
-   MAKE_INSTR(0x8D, STA, ABS, 4, false);
-   MAKE_INSTR(0x9D, STA, ABX, 5, false);
-   MAKE_INSTR(0x99, STA, ABY, 5, false);
-   MAKE_INSTR(0x81, STA, INX, 6, false);
-   MAKE_INSTR(0x91, STA, INY, 6, false);
-
-// STX
-// Store Index X in Memory
-//
-// X -> M
-// N    Z       C       I       D       V
-// -    -       -       -       -       -
-// addressing   assembler       opc     bytes   cycles
-// zeropage     STX oper        86      2       3
-// zeropage,Y   STX oper,Y      96      2       4
-// absolute     STX oper        8E      3       4
-
-   MAKE_INSTR(0x86, STX, ZER, 3, false);
-   MAKE_INSTR(0x96, STX, ZEY, 4, false);
-   MAKE_INSTR(0x8E, STX, ABS, 4, false);
-
-// STY
-// Sore Index Y in Memory
-//
-// Y -> M
-// N    Z       C       I       D       V
-// -    -       -       -       -       -
-// addressing   assembler       opc     bytes   cycles
-// zeropage     STY oper        84      2       3
-// zeropage,X   STY oper,X      94      2       4
-// absolute     STY oper        8C      3       4
-
-   MAKE_INSTR(0x84, STY, ZER, 3, false);
-   MAKE_INSTR(0x94, STY, ZEX, 4, false);
-   MAKE_INSTR(0x8C, STY, ABS, 4, false);
-
-// TAX
-// Transfer Accumulator to Index X
-//
-// A -> X
-// N    Z       C       I       D       V
-// +    +       -       -       -       -
-// addressing   assembler       opc     bytes   cycles
-// implied      TAX     AA      1       2
-
-   MAKE_INSTR(0xAA, TAX, IMP, 2, false);
-
-// TAY
-// Transfer Accumulator to Index Y
-//
-// A -> Y
-// N    Z       C       I       D       V
-// +    +       -       -       -       -
-// addressing   assembler       opc     bytes   cycles
-// implied      TAY     A8      1       2
-
-   MAKE_INSTR(0xA8, TAY, IMP, 2, false);
-
-// TSX
-// Transfer Stack Pointer to Index X
-//
-// SP -> X
-// N    Z       C       I       D       V
-// +    +       -       -       -       -
-// addressing   assembler       opc     bytes   cycles
-// implied      TSX     BA      1       2
-
-   MAKE_INSTR(0xBA, TSX, IMP, 2, false);
-
-// TXA
-// Transfer Index X to Accumulator
-//
-// X -> A
-// N    Z       C       I       D       V
-// +    +       -       -       -       -
-// addressing   assembler       opc     bytes   cycles
-// implied      TXA     8A      1       2
-
-   MAKE_INSTR(0x8A, TXA, IMP, 2, false);
-
-// TXS
-// Transfer Index X to Stack Register
-//
-// X -> SP
-// N    Z       C       I       D       V
-// -    -       -       -       -       -
-// addressing   assembler       opc     bytes   cycles
-// implied      TXS     9A      1       2
-
-   MAKE_INSTR(0x9A, TXS, IMP, 2, false);
-
-// TYA
-// Transfer Index Y to Accumulator
-//
-// Y -> A
-// N    Z       C       I       D       V
-// +    +       -       -       -       -
-// addressing   assembler       opc     bytes   cycles
-// implied      TYA     98      1       2
-
-   MAKE_INSTR(0x98, TYA, IMP, 2, false);
+#include "mos6502_opcodes.h"
+#undef MAKE_INSTR
+
+#undef BYTES_ACC
+#undef BYTES_IMP
+#undef BYTES_IMM
+#undef BYTES_ZER
+#undef BYTES_ZEX
+#undef BYTES_ZEY
+#undef BYTES_REL
+#undef BYTES_INX
+#undef BYTES_INY
+#undef BYTES_ABS
+#undef BYTES_ABX
+#undef BYTES_ABY
+#undef BYTES_ABI
 
-#ifdef ILLEGAL_OPCODES
+   return;
+}
 
-// ALR (ASR)
-// AND oper + LSR
-//
-// A AND oper, 0 -> [76543210] -> C
-//
-// N    Z       C       I       D       V
-// +    +       +       -       -       -
-// addressing   assembler       opc     bytes   cycles
-// immediate    ALR #oper       4B      2       2
-
-   MAKE_INSTR(0x4B, ALR, IMM, 2, false);
-
-// ANC
-// AND oper + set C as ASL
-//
-// A AND oper, bit(7) -> C
-//
-// N    Z       C       I       D       V
-// +    +       +       -       -       -
-// addressing   assembler       opc     bytes   cycles
-// immediate    ANC #oper       0B      2       2
-
-   MAKE_INSTR(0x0B, ANC, IMM, 2, false);
-
-// ANC (ANC2)
-// AND oper + set C as ROL
-//
-// effectively the same as instr. 0B
-//
-// A AND oper, bit(7) -> C
-//
-// N    Z       C       I       D       V
-// +    +       +       -       -       -
-// addressing   assembler       opc     bytes   cycles
-// immediate    ANC #oper       2B      2       2
-
-   MAKE_INSTR(0x2B, ANC, IMM, 2, false);
-
-// ANE (XAA)
-// * OR X + AND oper
-//
-// Highly unstable, do not use.
-//
-// A base value in A is determined based on the contets of A and a constant,
-// which may be typically $00, $ff, $ee, etc. The value of this constant
-// depends on temperature, the chip series, and maybe other factors, as well.
-// In order to eliminate these uncertaincies from the equation, use either 0
-// as the operand or a value of $FF in the accumulator.
-//
-// (A OR CONST) AND X AND oper -> A
-//
-// N    Z       C       I       D       V
-// +    +       -       -       -       -
-// addressing   assembler       opc     bytes   cycles
-// immediate    ANE #oper       8B      2       2       ††
-
-   MAKE_INSTR(0x8B, ANE, IMM, 2, false);
-
-// ARR
-// AND oper + ROR
-//
-// This operation involves the adder:
-// V-flag is set according to (A AND oper) + oper
-// The carry is not set, but bit 7 (sign) is exchanged with the carry
-//
-// A AND oper, C -> [76543210] -> C
-//
-// N    Z       C       I       D       V
-// +    +       +       -       -       +
-// addressing   assembler       opc     bytes   cycles
-// immediate    ARR #oper       6B      2       2
-
-   MAKE_INSTR(0x6B, ARR, IMM, 2, false);
-
-// DCP (DCM)
-// DEC oper + CMP oper
-//
-// M - 1 -> M, A - M
-//
-// Decrements the operand and then compares the result to the accumulator.
-//
-// N    Z       C       I       D       V
-// +    +       +       -       -       -
-// addressing   assembler       opc     bytes   cycles
-// zeropage     DCP oper        C7      2       5
-// zeropage,X   DCP oper,X      D7      2       6
-// absolute     DCP oper        CF      3       6
-// absolute,X   DCP oper,X      DF      3       7
-// absolute,Y   DCP oper,Y      DB      3       7
-// (indirect,X) DCP (oper,X)    C3      2       8
-// (indirect),Y DCP (oper),Y    D3      2       8
-
-   MAKE_INSTR(0xC7, DCP, ZER, 5, false);
-   MAKE_INSTR(0xD7, DCP, ZEX, 6, false);
-   MAKE_INSTR(0xCF, DCP, ABS, 6, false);
-   MAKE_INSTR(0xDF, DCP, ABX, 7, false);
-   MAKE_INSTR(0xDB, DCP, ABY, 7, false);
-   MAKE_INSTR(0xC3, DCP, INX, 8, false);
-   MAKE_INSTR(0xD3, DCP, INY, 8, false);
-
-// ISC (ISB, INS)
-// INC oper + SBC oper
-//
-// M + 1 -> M, A - M - C̅ -> A
-//
-// N    Z       C       I       D       V
-// +    +       +       -       -       +
-// addressing   assembler       opc     bytes   cycles
-// zeropage     ISC oper        E7      2       5
-// zeropage,X   ISC oper,X      F7      2       6
-// absolute     ISC oper        EF      3       6
-// absolute,X   ISC oper,X      FF      3       7
-// absolute,Y   ISC oper,Y      FB      3       7
-// (indirect,X) ISC (oper,X)    E3      2       8
-// (indirect),Y ISC (oper),Y    F3      2       8
-
-   MAKE_INSTR(0xE7, ISC, ZER, 5, false);
-   MAKE_INSTR(0xF7, ISC, ZEX, 6, false);
-   MAKE_INSTR(0xEF, ISC, ABS, 6, false);
-   MAKE_INSTR(0xFF, ISC, ABX, 7, false);
-   MAKE_INSTR(0xFB, ISC, ABY, 7, false);
-   MAKE_INSTR(0xE3, ISC, INX, 8, false);
-   MAKE_INSTR(0xF3, ISC, INY, 8, false);
-
-// LAS (LAR)
-// LDA/TSX oper
-//
-// M AND SP -> A, X, SP
-//
-// N    Z       C       I       D       V
-// +    +       -       -       -       -
-// addressing   assembler       opc     bytes   cycles
-// absolute,Y   LAS oper,Y      BB      3       4*
-
-   MAKE_INSTR(0xBB, LAS, ABY, 4, true);
-
-// LAX
-// LDA oper + LDX oper
-//
-// M -> A -> X
-//
-// N    Z       C       I       D       V
-// +    +       -       -       -       -
-// addressing   assembler       opc     bytes   cycles
-// zeropage     LAX oper        A7      2       3
-// zeropage,Y   LAX oper,Y      B7      2       4
-// absolute     LAX oper        AF      3       4
-// absolute,Y   LAX oper,Y      BF      3       4*
-// (indirect,X) LAX (oper,X)    A3      2       6
-// (indirect),Y LAX (oper),Y    B3      2       5*
-
-   MAKE_INSTR(0xA7, LAX, ZER, 3, false);
-   MAKE_INSTR(0xB7, LAX, ZEY, 4, false);
-   MAKE_INSTR(0xAF, LAX, ABS, 4, false);
-   MAKE_INSTR(0xBF, LAX, ABY, 4, true);
-   MAKE_INSTR(0xA3, LAX, INX, 6, false);
-   MAKE_INSTR(0xB3, LAX, INY, 5, true);
-
-// LXA (LAX immediate)
-// Store * AND oper in A and X
-//
-// Highly unstable, involves a 'magic' constant, see ANE
-//
-// (A OR CONST) AND oper -> A -> X
-//
-// N    Z       C       I       D       V
-// +    +       -       -       -       -
-// addressing   assembler       opc     bytes   cycles
-// immediate    LXA #oper       AB      2       2       ††
-
-   MAKE_INSTR(0xAB, LXA, IMM, 2, false);
-
-// RLA
-// ROL oper + AND oper
-//
-// M = C <- [76543210] <- C, A AND M -> A
-//
-// N    Z       C       I       D       V
-// +    +       +       -       -       -
-// addressing   assembler       opc     bytes   cycles
-// zeropage     RLA oper        27      2       5
-// zeropage,X   RLA oper,X      37      2       6
-// absolute     RLA oper        2F      3       6
-// absolute,X   RLA oper,X      3F      3       7
-// absolute,Y   RLA oper,Y      3B      3       7
-// (indirect,X) RLA (oper,X)    23      2       8
-// (indirect),Y RLA (oper),Y    33      2       8
-
-   MAKE_INSTR(0x27, RLA, ZER, 5, false);
-   MAKE_INSTR(0x37, RLA, ZEX, 6, false);
-   MAKE_INSTR(0x2F, RLA, ABS, 6, false);
-   MAKE_INSTR(0x3F, RLA, ABX, 7, false);
-   MAKE_INSTR(0x3B, RLA, ABY, 7, false);
-   MAKE_INSTR(0x23, RLA, INX, 8, false);
-   MAKE_INSTR(0x33, RLA, INY, 8, false);
-
-// RRA
-// ROR oper + ADC oper
-//
-// M = C -> [76543210] -> C, A + M + C -> A, C
-//
-// N    Z       C       I       D       V
-// +    +       +       -       -       +
-// addressing   assembler       opc     bytes   cycles
-// zeropage     RRA oper        67      2       5
-// zeropage,X   RRA oper,X      77      2       6
-// absolute     RRA oper        6F      3       6
-// absolute,X   RRA oper,X      7F      3       7
-// absolute,Y   RRA oper,Y      7B      3       7
-// (indirect,X) RRA (oper,X)    63      2       8
-// (indirect),Y RRA (oper),Y    73      2       8
-
-   MAKE_INSTR(0x67, RRA, ZER, 5, false);
-   MAKE_INSTR(0x77, RRA, ZEX, 6, false);
-   MAKE_INSTR(0x6F, RRA, ABS, 6, false);
-   MAKE_INSTR(0x7F, RRA, ABX, 7, false);
-   MAKE_INSTR(0x7B, RRA, ABY, 7, false);
-   MAKE_INSTR(0x63, RRA, INX, 8, false);
-   MAKE_INSTR(0x73, RRA, INY, 8, false);
-
-// SAX (AXS, AAX)
-// A and X are put on the bus at the same time (resulting effectively in an AND operation) and stored in M
-//
-// A AND X -> M
-//
-// N    Z       C       I       D       V
-// -    -       -       -       -       -
-// addressing   assembler       opc     bytes   cycles
-// zeropage     SAX oper        87      2       3
-// zeropage,Y   SAX oper,Y      97      2       4
-// absolute     SAX oper        8F      3       4
-// (indirect,X) SAX (oper,X)    83      2       6
-
-   MAKE_INSTR(0x87, SAX, ZER, 3, false);
-   MAKE_INSTR(0x97, SAX, ZEY, 4, false);
-   MAKE_INSTR(0x8F, SAX, ABS, 4, false);
-   MAKE_INSTR(0x83, SAX, INX, 6, false);
-
-// SBX (AXS, SAX)
-// CMP and DEX at once, sets flags like CMP
-//
-// (A AND X) - oper -> X
-//
-// N    Z       C       I       D       V
-// +    +       +       -       -       -
-// addressing   assembler       opc     bytes   cycles
-// immediate    SBX #oper       CB      2       2
-
-   MAKE_INSTR(0xCB, SBX, IMM, 2, false);
-
-// SHA (AHX, AXA)
-// Stores A AND X AND (high-byte of addr. + 1) at addr.
-//
-// unstable: sometimes 'AND (H+1)' is dropped, page boundary crossings
-// may not work (with the high-byte of the value used as the high-byte of the address)
-//
-// A AND X AND (H+1) -> M
-//
-// N    Z       C       I       D       V
-// -    -       -       -       -       -
-// addressing   assembler       opc     bytes   cycles
-// absolute,Y   SHA oper,Y      9F      3       5       †
-// (indirect),Y SHA (oper),Y    93      2       6       †
-
-   MAKE_INSTR(0x9F, SHA, ABY, 5, false);
-   MAKE_INSTR(0x93, SHA, INY, 6, false);
-
-// SHX (A11, SXA, XAS)
-// Stores X AND (high-byte of addr. + 1) at addr.
-//
-// unstable: sometimes 'AND (H+1)' is dropped, page boundary
-// crossings may not work (with the high-byte of the value used as the high-byte of the address)
-//
-// X AND (H+1) -> M
-//
-// N    Z       C       I       D       V
-// -    -       -       -       -       -
-// addressing   assembler       opc     bytes   cycles
-// absolute,Y   SHX oper,Y      9E      3       5       †
-
-   MAKE_INSTR(0x9E, SHX, ABY, 5, false);
-
-// SHY (A11, SYA, SAY)
-// Stores Y AND (high-byte of addr. + 1) at addr.
-//
-// unstable: sometimes 'AND (H+1)' is dropped, page boundary
-// crossings may not work (with the high-byte of the value used as the high-byte of the address)
-//
-// Y AND (H+1) -> M
-//
-// N    Z       C       I       D       V
-// -    -       -       -       -       -
-// addressing   assembler       opc     bytes   cycles
-// absolute,X   SHY oper,X      9C      3       5       †
-
-   MAKE_INSTR(0x9C, SHY, ABX, 5, false);
-
-// SLO (ASO)
-// ASL oper + ORA oper
-//
-// M = C <- [76543210] <- 0, A OR M -> A
-//
-// N    Z       C       I       D       V
-// +    +       +       -       -       -
-// addressing   assembler       opc     bytes   cycles
-// zeropage     SLO oper        07      2       5
-// zeropage,X   SLO oper,X      17      2       6
-// absolute     SLO oper        0F      3       6
-// absolute,X   SLO oper,X      1F      3       7
-// absolute,Y   SLO oper,Y      1B      3       7
-// (indirect,X) SLO (oper,X)    03      2       8
-// (indirect),Y SLO (oper),Y    13      2       8
-
-   MAKE_INSTR(0x07, SLO, ZER, 5, false);
-   MAKE_INSTR(0x17, SLO, ZEX, 6, false);
-   MAKE_INSTR(0x0F, SLO, ABS, 6, false);
-   MAKE_INSTR(0x1F, SLO, ABX, 7, false);
-   MAKE_INSTR(0x1B, SLO, ABY, 7, false);
-   MAKE_INSTR(0x03, SLO, INX, 8, false);
-   MAKE_INSTR(0x13, SLO, INY, 8, false);
-
-// SRE (LSE)
-// LSR oper + EOR oper
-//
-// M = 0 -> [76543210] -> C, A EOR M -> A
-//
-// N    Z       C       I       D       V
-// +    +       +       -       -       -
-// addressing   assembler       opc     bytes   cycles
-// zeropage     SRE oper        47      2       5
-// zeropage,X   SRE oper,X      57      2       6
-// absolute     SRE oper        4F      3       6
-// absolute,X   SRE oper,X      5F      3       7
-// absolute,Y   SRE oper,Y      5B      3       7
-// (indirect,X) SRE (oper,X)    43      2       8
-// (indirect),Y SRE (oper),Y    53      2       8
-
-   MAKE_INSTR(0x47, SRE, ZER, 5, false);
-   MAKE_INSTR(0x57, SRE, ZEX, 6, false);
-   MAKE_INSTR(0x4F, SRE, ABS, 6, false);
-   MAKE_INSTR(0x5F, SRE, ABX, 7, false);
-   MAKE_INSTR(0x5B, SRE, ABY, 7, false);
-   MAKE_INSTR(0x43, SRE, INX, 8, false);
-   MAKE_INSTR(0x53, SRE, INY, 8, false);
-
-// TAS (XAS, SHS)
-// Puts A AND X in SP and stores A AND X AND (high-byte of addr. + 1) at addr.
-//
-// unstable: sometimes 'AND (H+1)' is dropped, page boundary
-// crossings may not work (with the high-byte of the value used as the high-byte of the address)
-//
-// A AND X -> SP, A AND X AND (H+1) -> M
-//
-// N    Z       C       I       D       V
-// -    -       -       -       -       -
-// addressing   assembler       opc     bytes   cycles
-// absolute,Y   TAS oper,Y      9B      3       5       †
-
-   MAKE_INSTR(0x9B, TAS, ABY, 5, false);
-
-// USBC (SBC)
-// SBC oper + NOP
-//
-// effectively same as normal SBC immediate, instr. E9.
-//
-// A - M - C̅ -> A
-//
-// N    Z       C       I       D       V
-// +    +       +       -       -       +
-// addressing   assembler       opc     bytes   cycles
-// immediate    USBC #oper      EB      2       2
-
-   MAKE_INSTR(0xEB, SBC, IMM, 2, false);
-
-// NOPs (including DOP, TOP)
-// Instructions effecting in 'no operations' in various address modes. Operands are ignored.
-//
-// N    Z       C       I       D       V
-// -    -       -       -       -       -
-// opc  addressing      bytes   cycles
-// 1A   implied         1       2
-// 3A   implied         1       2
-// 5A   implied         1       2
-// 7A   implied         1       2
-// DA   implied         1       2
-// FA   implied         1       2
-
-   MAKE_INSTR(0x1A, NOP, IMP, 2, false);
-   MAKE_INSTR(0x3A, NOP, IMP, 2, false);
-   MAKE_INSTR(0x5A, NOP, IMP, 2, false);
-   MAKE_INSTR(0x7A, NOP, IMP, 2, false);
-   MAKE_INSTR(0xDA, NOP, IMP, 2, false);
-   MAKE_INSTR(0xFA, NOP, IMP, 2, false);
-
-// 80   immediate       2       2
-// 82   immediate       2       2
-// 89   immediate       2       2
-// C2   immediate       2       2
-// E2   immediate       2       2
-
-   MAKE_INSTR(0x80, NOP, IMM, 2, false);
-   MAKE_INSTR(0x82, NOP, IMM, 2, false);
-   MAKE_INSTR(0x89, NOP, IMM, 2, false);
-   MAKE_INSTR(0xC2, NOP, IMM, 2, false);
-   MAKE_INSTR(0xE2, NOP, IMM, 2, false);
-
-// 04   zeropage        2       3
-// 44   zeropage        2       3
-// 64   zeropage        2       3
-
-   MAKE_INSTR(0x04, NOP, ZER, 3, false);
-   MAKE_INSTR(0x44, NOP, ZER, 3, false);
-   MAKE_INSTR(0x64, NOP, ZER, 3, false);
-
-// 14   zeropage,X      2       4
-// 34   zeropage,X      2       4
-// 54   zeropage,X      2       4
-// 74   zeropage,X      2       4
-// D4   zeropage,X      2       4
-// F4   zeropage,X      2       4
-
-   MAKE_INSTR(0x14, NOP, ZEX, 4, false);
-   MAKE_INSTR(0x34, NOP, ZEX, 4, false);
-   MAKE_INSTR(0x54, NOP, ZEX, 4, false);
-   MAKE_INSTR(0x74, NOP, ZEX, 4, false);
-   MAKE_INSTR(0xD4, NOP, ZEX, 4, false);
-   MAKE_INSTR(0xF4, NOP, ZEX, 4, false);
-
-// 0C   absolute        3       4
-
-   MAKE_INSTR(0x0C, NOP, ABS, 4, false);
-
-// 1C   absolute,X      3       4*
-// 3C   absolute,X      3       4*
-// 5C   absolute,X      3       4*
-// 7C   absolute,X      3       4*
-// DC   absolute,X      3       4*
-// FC   absolute,X      3       4*
-
-   MAKE_INSTR(0x1C, NOP, ABX, 4, true);
-   MAKE_INSTR(0x3C, NOP, ABX, 4, true);
-   MAKE_INSTR(0x5C, NOP, ABX, 4, true);
-   MAKE_INSTR(0x7C, NOP, ABX, 4, true);
-   MAKE_INSTR(0xDC, NOP, ABX, 4, true);
-   MAKE_INSTR(0xFC, NOP, ABX, 4, true);
-
-// JAM (KIL, HLT)
-// These instructions freeze the CPU.
-//
-// The processor will be trapped infinitely in T1 phase with $FF on the data bus. — Reset required.
-//
-// Instruction codes: 02, 12, 22, 32, 42, 52, 62, 72, 92, B2, D2, F2
-
-   MAKE_INSTR(0x02, ILLEGAL, IMP, 0, false);
-   MAKE_INSTR(0x12, ILLEGAL, IMP, 0, false);
-   MAKE_INSTR(0x22, ILLEGAL, IMP, 0, false);
-   MAKE_INSTR(0x32, ILLEGAL, IMP, 0, false);
-   MAKE_INSTR(0x42, ILLEGAL, IMP, 0, false);
-   MAKE_INSTR(0x52, ILLEGAL, IMP, 0, false);
-   MAKE_INSTR(0x62, ILLEGAL, IMP, 0, false);
-   MAKE_INSTR(0x72, ILLEGAL, IMP, 0, false);
-   MAKE_INSTR(0x92, ILLEGAL, IMP, 0, false);
-   MAKE_INSTR(0xB2, ILLEGAL, IMP, 0, false);
-   MAKE_INSTR(0xD2, ILLEGAL, IMP, 0, false);
-   MAKE_INSTR(0xF2, ILLEGAL, IMP, 0, false);
+#ifdef BUS_CONTEXT
+mos6502::mos6502(BusRead r, BusWrite w, ClockCycles c)
+   : mos6502(&mos6502::ReadShim, &mos6502::WriteShim, nullptr, c)
+{
+   // the callbacks carry themselves as their context, which keeps the
+   // CPU free of pointers to itself
+   readCtx = (void*)r;
+   writeCtx = (void*)w;
+}
+
+uint8_t mos6502::ReadShim(void* ctx, uint16_t addr)
+{
+   return ((BusRead)ctx)(addr);
+}
+
+void mos6502::WriteShim(void* ctx, uint16_t addr, uint8_t value)
+{
+   ((BusWrite)ctx)(addr, value);
+}
+#endif
 
+#ifndef BUS_HEADER
+mos6502::mos6502(BusRead r, BusWrite w, ClockCycle c)
+   : mos6502(r, w, c ? &mos6502::CycleShim : (ClockCycles)nullptr)
+{
+   Cycle = c;
+}
 #endif
 
-   return;
+// the per-cycle callback on top of the batched one
+void mos6502::CycleShim(mos6502* cpu, uint32_t n, uint64_t /*stamp*/)
+{
+   for(uint32_t i = 0; i < n; i++)
+   {
+      cpu->Cycle(cpu);
+   }
+}
+
+#ifdef BLOCK_CACHE
+mos6502::~mos6502()
+{
+   delete[] blocks;
+#ifdef JIT
+   if (jitCode)
+   {
+      munmap(jitCode, JIT_CODE_SIZE);
+   }
+#endif
+}
+#endif
+
+uint8_t mos6502::ReadBus(uint16_t addr)
+{
+#ifdef IDLE_LOOPS
+   idleClean &= idleSafe[addr >> 8];
+#endif
+#if defined(BUS_HEADER)
+   return bus->Read(addr);
+#elif defined(BUS_CONTEXT)
+   return busRead(readCtx, addr);
+#else
+   return busRead(addr);
+#endif
+}
+
+void mos6502::WriteBus(uint16_t addr, uint8_t value)
+{
+#if defined(BUS_HEADER)
+   bus->Write(addr, value);
+#elif defined(BUS_CONTEXT)
+   busWrite(writeCtx, addr, value);
+#else
+   busWrite(addr, value);
+#endif
+}
+
+uint8_t mos6502::Read(uint16_t addr)
+{
+   uint8_t value;
+#ifdef MEMORY_MAP
+   const uint8_t* page = readPage[addr >> 8];
+   if (page)
+   {
+      value = page[addr & 0xFF];
+   }
+   else
+#endif
+#ifdef BREAKPOINTS
+   // the pages watched for reads are never in readPage
+   if (watchPage[addr >> 8] & WATCH_READ)
+   {
+      value = WatchRead(addr, true);
+   }
+   else
+#endif
+   {
+      value = ReadBus(addr);
+   }
+#ifdef TRACE
+   traceData = value;
+#endif
+   return value;
+}
+
+uint8_t mos6502::ReadCode(uint16_t addr)
+{
+#ifdef BREAKPOINTS
+   // the page table with the watched pages, then the bus
+#ifdef MEMORY_MAP
+   const uint8_t* page = mapRead[addr >> 8];
+   if (page)
+   {
+      return page[addr & 0xFF];
+   }
+#endif
+   return ReadBus(addr);
+#else
+   return Read(addr);
+#endif
+}
+
+void mos6502::Write(uint16_t addr, uint8_t value)
+{
+#ifdef TRACE
+   traceData = value;
+#endif
+#ifdef IDLE_LOOPS
+   idleClean = false;
+#endif
+#ifdef BLOCK_CACHE
+   // blocks decoded from this page are stale now
+   pageGen[addr >> 8]++;
+#endif
+#ifdef MEMORY_MAP
+   uint8_t* page = writePage[addr >> 8];
+   if (page)
+   {
+      page[addr & 0xFF] = value;
+      return;
+   }
+#endif
+#ifdef BREAKPOINTS
+   // nor are the pages watched for writes in writePage
+   if (watchPage[addr >> 8] & WATCH_WRITE)
+   {
+      WatchWrite(addr, value);
+      return;
+   }
+#endif
+   WriteBus(addr, value);
+}
+
+#ifdef MEMORY_MAP
+
+void mos6502::MapPages(uint8_t first, uint8_t last,
+      const uint8_t* read, uint8_t* write)
+{
+   for(int i = first; i <= last; i++)
+   {
+      SetPage(i, read ? read + (i - first) * 256 : nullptr,
+            write ? write + (i - first) * 256 : nullptr);
+#ifdef BLOCK_CACHE
+      // the code behind the page may be different now
+      pageGen[i]++;
+#endif
+   }
+}
+
+void mos6502::SetPage(uint8_t page, const uint8_t* read, uint8_t* write)
+{
+#ifdef BREAKPOINTS
+   mapRead[page] = read;
+   mapWrite[page] = write;
+   MapWatch(page);
+#else
+   readPage[page] = read;
+   writePage[page] = write;
+#endif
+}
+
+void mos6502::SetReadPages(const uint8_t* const* read)
+{
+#ifdef BREAKPOINTS
+   memcpy(mapRead, read, sizeof(mapRead));
+   memset(mapWrite, 0, sizeof(mapWrite));
+   if (WATCHING())
+   {
+      for(int i = 0; i < 256; i++)
+      {
+         MapWatch(i);
+      }
+      return;
+   }
+#endif
+   memcpy(readPage, read, sizeof(readPage));
+   memset(writePage, 0, sizeof(writePage));
+}
+
+void mos6502::MapRAM(uint8_t first, uint8_t last, uint8_t* mem)
+{
+   MapPages(first, last, mem, mem);
+}
+
+void mos6502::MapROM(uint8_t first, uint8_t last, const uint8_t* mem)
+{
+   MapPages(first, last, mem, nullptr);
+}
+
+void mos6502::MapIO(uint8_t first, uint8_t last)
+{
+   MapPages(first, last, nullptr, nullptr);
+}
+#endif
+
+uint8_t mos6502::Fetch()
+{
+#ifdef BLOCK_CACHE
+   pc++;
+   return *fetch++;
+#elif defined(TRACE)
+   // an operand byte is not data
+   uint8_t data = traceData;
+   uint8_t value = ReadCode(pc++);
+   traceData = data;
+   traceOperand = traceOperand << 8 | value;
+   return value;
+#else
+   return ReadCode(pc++);
+#endif
+}
+
+void mos6502::Tick(uint32_t n)
+{
+   if (Cycles)
+   {
+      cycleStamp += n;
+      Cycles(this, n, cycleStamp);
+   }
+}
+
+#ifdef PROFILE
+void mos6502::SetProfile(ProfileEntry* profile)
+{
+   this->profile = profile;
+}
+#endif
+
+#ifdef TRACE
+void mos6502::SetTrace(TraceRecord* buffer, uint32_t size, TraceFlush flush, void* ctx)
+{
+   trace = size ? buffer : nullptr;
+   traceUsed = 0;
+   traceSize = size;
+   traceFlush = flush;
+   traceCtx = ctx;
+}
+
+void mos6502::FlushTrace()
+{
+   if (!trace || !traceUsed) return;
+   trace = traceFlush(traceCtx, trace, traceUsed);
+   traceUsed = 0;
+}
+
+// the opcode was just fetched
+void mos6502::TraceBefore(uint8_t opcode, uint64_t cycleCount)
+{
+   TraceRecord* r = trace + traceUsed;
+   r->cycle = cycleCount;
+   r->pc = pc - 1;
+   r->opcode = opcode;
+   r->A = A;
+   r->X = X;
+   r->Y = Y;
+   r->P = STATUS();
+   r->S = sp;
+   r->reserved[0] = 0;
+   r->reserved[1] = 0;
+   traceAddr = 0;
+   traceData = 0;
+}
+
+void mos6502::TraceAfter(uint8_t elapsed)
+{
+   TraceRecord* r = trace + traceUsed;
+   const Instr& instr = InstrTable[r->opcode];
+#ifdef BLOCK_CACHE
+   // the operands are in the block, right after the opcode
+   const uint8_t* bytes = fetch - instr.bytes + 1;
+   uint16_t operand = instr.bytes == 3 ? bytes[0] << 8 | bytes[1] : bytes[0];
+#else
+   uint16_t operand = traceOperand;
+#endif
+   r->addr = traceAddr;
+   r->operand[0] = 0;
+   r->operand[1] = 0;
+   if (instr.addr == &mos6502::Addr_IMM)
+   {
+      // the operation read it itself
+      r->operand[0] = traceData;
+   }
+   else if (instr.bytes == 3)
+   {
+      r->operand[0] = operand >> 8;
+      r->operand[1] = operand;
+   }
+   else if (instr.bytes == 2)
+   {
+      r->operand[0] = operand;
+   }
+   r->data = traceData;
+   r->cycles = elapsed;
+
+   if (++traceUsed == traceSize)
+   {
+      trace = traceFlush(traceCtx, trace, traceUsed);
+      traceUsed = 0;
+   }
+}
+#endif
+
+#define EVENT_BEFORE(a, b) \
+   ((a).when < (b).when || ((a).when == (b).when && (a).id < (b).id))
+
+int32_t mos6502::ScheduleEvent(uint64_t when, EventCallback callback, void* ctx)
+{
+   if (eventCount == EVENT_MAX)
+   {
+      return -1;
+   }
+
+   Event e;
+   e.when = when;
+   e.callback = callback;
+   e.ctx = ctx;
+   e.id = eventSerial;
+   eventSerial = eventSerial == INT32_MAX ? 0 : eventSerial + 1;
+
+   // sift up from the bottom of the heap
+   int i = eventCount++;
+   while(i > 0 && EVENT_BEFORE(e, events[(i - 1) / 2]))
+   {
+      events[i] = events[(i - 1) / 2];
+      i = (i - 1) / 2;
+   }
+   events[i] = e;
+   eventNext = events[0].when;
+#ifdef BREAKPOINTS
+   if (stopping) eventNext = 0;
+#endif
+
+   return e.id;
+}
+
+bool mos6502::CancelEvent(int32_t id)
+{
+   for(int i = 0; i < eventCount; i++)
+   {
+      if (events[i].id == id)
+      {
+         RemoveEvent(i);
+         return true;
+      }
+   }
+   return false;
+}
+
+void mos6502::RemoveEvent(int i)
+{
+   Event e = events[--eventCount];
+
+   if (i < eventCount)
+   {
+      // the last event takes the hole, up or down from there
+      while(i > 0 && EVENT_BEFORE(e, events[(i - 1) / 2]))
+      {
+         events[i] = events[(i - 1) / 2];
+         i = (i - 1) / 2;
+      }
+      for(;;)
+      {
+         int c = 2 * i + 1;
+         if (c >= eventCount) break;
+         if (c + 1 < eventCount && EVENT_BEFORE(events[c + 1], events[c])) c++;
+         if (!EVENT_BEFORE(events[c], e)) break;
+         events[i] = events[c];
+         i = c;
+      }
+      events[i] = e;
+   }
+
+   eventNext = eventCount ? events[0].when : UINT64_MAX;
+#ifdef BREAKPOINTS
+   if (stopping) eventNext = 0;
+#endif
+}
+
+void mos6502::RunEvents(uint64_t now)
+{
+   while(eventCount && events[0].when <= now)
+   {
+      // off the heap first: the callback may schedule it again
+      Event e = events[0];
+      RemoveEvent(0);
+      e.callback(this, e.ctx, e.when, now);
+   }
+
+#ifdef IDLE_LOOPS
+   // the callbacks may have changed what an idle loop reads
+   idleArmed = false;
+#endif
 }
 
+#undef EVENT_BEFORE
+
 uint16_t mos6502::Addr_ACC()
 {
    return 0; // not used
@@ -1389,6 +743,9 @@ uint16_t mos6502::Addr_ACC()
 
 uint16_t mos6502::Addr_IMM()
 {
+#ifdef BLOCK_CACHE
+   fetch++; // in step with pc, the op reads the operand itself
+#endif
    return pc++;
 }
 
@@ -1398,8 +755,8 @@ uint16_t mos6502::Addr_ABS()
    uint16_t addrH;
    uint16_t addr;
 
-   addrL = Read(pc++);
-   addrH = Read(pc++);
+   addrL = Fetch();
+   addrH = Fetch();
 
    addr = addrL + (addrH << 8);
 
@@ -1408,7 +765,7 @@ uint16_t mos6502::Addr_ABS()
 
 uint16_t mos6502::Addr_ZER()
 {
-   return Read(pc++);
+   return Fetch();
 }
 
 uint16_t mos6502::Addr_IMP()
@@ -1421,7 +778,7 @@ uint16_t mos6502::Addr_REL()
    uint16_t offset;
    uint16_t addr;
 
-   offset = (uint16_t)Read(pc++);
+   offset = (uint16_t)Fetch();
    if (offset & 0x80) offset |= 0xFF00;
    addr = pc + (int16_t)offset;
    crossed = (addr & 0xFF00) != (pc & 0xFF00);
@@ -1438,8 +795,8 @@ uint16_t mos6502::Addr_ABI()
    uint16_t abs;
    uint16_t addr;
 
-   addrL = Read(pc++);
-   addrH = Read(pc++);
+   addrL = Fetch();
+   addrH = Fetch();
 
    abs = (addrH << 8) | addrL;
 
@@ -1458,13 +815,13 @@ uint16_t mos6502::Addr_ABI()
 
 uint16_t mos6502::Addr_ZEX()
 {
-   uint16_t addr = (Read(pc++) + X) & 0xFF;
+   uint16_t addr = (Fetch() + X) & 0xFF;
    return addr;
 }
 
 uint16_t mos6502::Addr_ZEY()
 {
-   uint16_t addr = (Read(pc++) + Y) & 0xFF;
+   uint16_t addr = (Fetch() + Y) & 0xFF;
    return addr;
 }
 
@@ -1474,8 +831,8 @@ uint16_t mos6502::Addr_ABX()
    uint16_t addrL;
    uint16_t addrH;
 
-   addrL = Read(pc++);
-   addrH = Read(pc++);
+   addrL = Fetch();
+   addrH = Fetch();
 
    addr = addrL + (addrH << 8) + X;
    crossed = (addrL + X) > 255;
@@ -1488,8 +845,8 @@ uint16_t mos6502::Addr_ABY()
    uint16_t addrL;
    uint16_t addrH;
 
-   addrL = Read(pc++);
-   addrH = Read(pc++);
+   addrL = Fetch();
+   addrH = Fetch();
 
    addr = addrL + (addrH << 8) + Y;
    crossed = (addrL + Y) > 255;
@@ -1502,7 +859,7 @@ uint16_t mos6502::Addr_INX()
    uint16_t zeroH;
    uint16_t addr;
 
-   zeroL = (Read(pc++) + X) & 0xFF;
+   zeroL = (Fetch() + X) & 0xFF;
    zeroH = (zeroL + 1) & 0xFF;
    addr = Read(zeroL) + (Read(zeroH) << 8);
 
@@ -1516,7 +873,7 @@ uint16_t mos6502::Addr_INY()
    uint16_t zeroH;
    uint16_t addr;
 
-   zeroL = Read(pc++);
+   zeroL = Fetch();
    zeroH = (zeroL + 1) & 0xFF;
    addr = (baseL = /* ASSIGN */ Read(zeroL)) + (Read(zeroH) << 8) + Y;
    crossed = (baseL + Y) > 255;
@@ -1558,15 +915,22 @@ void mos6502::Reset()
 
    sp = reset_sp;
 
-   status = reset_status | CONSTANT | BREAK;
+   SET_STATUS(reset_status | CONSTANT | BREAK);
 
    illegalOpcode = false;
 
+#ifdef BLOCK_CACHE
+   FlushBlockCache();
+#endif
+
    return;
 }
 
 void mos6502::StackPush(uint8_t byte)
 {
+#ifdef PERF_COUNTERS
+   perf.pushes++;
+#endif
    Write(0x0100 + sp, byte);
    if(sp == 0x00) sp = 0xFF;
    else sp--;
@@ -1574,6 +938,9 @@ void mos6502::StackPush(uint8_t byte)
 
 uint8_t mos6502::StackPop()
 {
+#ifdef PERF_COUNTERS
+   perf.pops++;
+#endif
    if(sp == 0xFF) sp = 0x00;
    else sp++;
    return Read(0x0100 + sp);
@@ -1581,10 +948,13 @@ uint8_t mos6502::StackPop()
 
 void mos6502::Svc_IRQ()
 {
+#ifdef PERF_COUNTERS
+   perf.irqs++;
+#endif
    //SET_BREAK(0);
    StackPush((pc >> 8) & 0xFF);
    StackPush(pc & 0xFF);
-   StackPush((status & ~BREAK) | CONSTANT);
+   StackPush((STATUS() & ~BREAK) | CONSTANT);
    SET_INTERRUPT(1);
 
    // load PC from interrupt request vector
@@ -1596,10 +966,13 @@ void mos6502::Svc_IRQ()
 
 void mos6502::Svc_NMI()
 {
+#ifdef PERF_COUNTERS
+   perf.nmis++;
+#endif
    //SET_BREAK(0);
    StackPush((pc >> 8) & 0xFF);
    StackPush(pc & 0xFF);
-   StackPush((status & ~BREAK) | CONSTANT);
+   StackPush((STATUS() & ~BREAK) | CONSTANT);
    SET_INTERRUPT(1);
 
    // load PC from non-maskable interrupt vector
@@ -1631,80 +1004,1233 @@ bool mos6502::CheckInterrupts() {
    return false;
 }
 
+// branches and JMP, the ends of the loops IdleCheck() looks at and of
+// the traps RunUntil() stops on
+#define JUMP_OP(op) (((op) & 0x1F) == 0x10 || (op) == 0x4C || (op) == 0x6C)
+
+#ifdef IDLE_LOOPS
+// called by Run after a jump back to pc. If the previous iteration of the
+// same loop made no write, only read idle-safe pages and left everything
+// as it found it, every following iteration does exactly the same: skip
+// as many as fit in the budget, charging their cycles. Only a cycle
+// callback or a pending interrupt could break the loop, none is allowed.
+void mos6502::IdleCheck(int32_t& cyclesRemaining, uint64_t& cycleCount)
+{
+   uint8_t p = STATUS();
+
+   if (idleArmed && idleClean && pc == idleHead &&
+       A == idleA && X == idleX && Y == idleY && sp == idleS && p == idleP &&
+       !Cycles && !INSTRUMENTED() && !COUNTING() && !nmi_request &&
+       (irq_line || IF_INTERRUPT()))
+   {
+      int32_t cost = idleRemaining - cyclesRemaining;
+      uint64_t cycles = cycleCount - idleCycles;
+
+      // keep at least one unit of budget: the loop goes on
+      // running normally until the budget is over
+      if (cost > 0 && cyclesRemaining > cost)
+      {
+         int32_t skip = (cyclesRemaining - 1) / cost;
+
+         // stop short of the next event, it may change what the loop reads
+         if (eventNext != UINT64_MAX)
+         {
+            uint64_t room = eventNext > cycleCount ?
+               (eventNext - cycleCount - 1) / cycles : 0;
+            if ((uint64_t)skip > room) skip = (int32_t)room;
+         }
+
+         cyclesRemaining -= skip * cost;
+         cycleCount += skip * cycles;
+      }
+   }
+
+   idleArmed = true;
+   idleClean = true;
+   idleHead = pc;
+   idleA = A;
+   idleX = X;
+   idleY = Y;
+   idleS = sp;
+   idleP = p;
+   idleRemaining = cyclesRemaining;
+   idleCycles = cycleCount;
+}
+
+void mos6502::SetIdleSafe(uint8_t first, uint8_t last, bool safe)
+{
+   for(int i = first; i <= last; i++)
+   {
+      idleSafe[i] = safe;
+   }
+}
+#endif
+
+template<mos6502::AddrExec ADDR, mos6502::CodeExec CODE, uint8_t CYCLES, bool PENALTY>
+inline uint8_t mos6502::Fused()
+{
+   uint16_t src;
+
+   if (ADDR == &mos6502::Addr_REL)
+   {
+      // branches: one more cycle if taken, another one if the
+      // taken branch crosses a page
+      branched = false;
+      src = (this->*ADDR)();
+#ifdef TRACE
+      traceAddr = src;
+#endif
+      (this->*CODE)(src);
+      return CYCLES + branched + crossed;
+   }
+
+   // only the indexed modes flagged with a penalty look at crossed,
+   // and they have just set it
+   src = (this->*ADDR)();
+   uint8_t cycles = (PENALTY && crossed) ? CYCLES + 1 : CYCLES;
+#ifdef TRACE
+   traceAddr = src;
+#endif
+   (this->*CODE)(src);
+   return cycles;
+}
+
+// anything not in the opcode table
+template<uint8_t OP>
+uint8_t mos6502::Step()
+{
+   return Fused<&mos6502::Addr_IMP, &mos6502::Op_ILLEGAL, 0, false>();
+}
+
+#define MAKE_INSTR(HEX, CODE, MODE, CYCLES, PENALTY) \
+template<> uint8_t mos6502::Step<HEX>() \
+{ \
+   uint8_t elapsed = Fused<&mos6502::Addr_ ## MODE, &mos6502::Op_ ## CODE, CYCLES, PENALTY>(); \
+   PERF_COUNT(HEX, MODE, CYCLES, elapsed); \
+   return elapsed; \
+}
+#include "mos6502_opcodes.h"
+#undef MAKE_INSTR
+#undef PERF_COUNT
+
+#define STEP4(F, N)  &mos6502::F<(N)>, &mos6502::F<(N) + 1>, \
+                     &mos6502::F<(N) + 2>, &mos6502::F<(N) + 3>
+#define STEP16(F, N) STEP4(F, N), STEP4(F, (N) + 4), \
+                     STEP4(F, (N) + 8), STEP4(F, (N) + 12)
+#define STEP64(F, N) STEP16(F, N), STEP16(F, (N) + 16), \
+                     STEP16(F, (N) + 32), STEP16(F, (N) + 48)
+
+const mos6502::StepExec mos6502::StepTable[256] =
+{
+   STEP64(Step, 0x00), STEP64(Step, 0x40), STEP64(Step, 0x80), STEP64(Step, 0xC0)
+};
+
+#ifdef SUPERINSTRUCTIONS
+template<uint8_t FIRST, uint8_t SECOND>
+uint8_t mos6502::Pair()
+{
+   uint32_t seen = flushes;
+   uint8_t cycles = Step<FIRST>();
+
+   // what the interpreter checks between two instructions, only a bus
+   // read callback can have changed it
+   if (nmi_request || !irq_line || flushes != seen || STOPPING())
+   {
+      pairSplit = true;
+      return cycles;
+   }
+
+   // skip the opcode of the second one, fetched at decode time
+   fetch++;
+   pc++;
+   return cycles + Step<SECOND>();
+}
+
+const mos6502::PairInfo mos6502::PairTable[PAIR_COUNT] =
+{
+#define MAKE_PAIR(FIRST, SECOND, NAME) \
+   { FIRST, SECOND, &mos6502::Pair<FIRST, SECOND>, NAME },
+#include "mos6502_pairs.h"
+#undef MAKE_PAIR
+};
+#endif
+
+#ifdef JIT
+// plain functions translated code can call, with the CPU in rdi
+template<uint8_t OP>
+uint8_t mos6502::JitThunk(mos6502* cpu)
+{
+   return cpu->Step<OP>();
+}
+
+const mos6502::JitCall mos6502::JitThunkTable[256] =
+{
+   STEP64(JitThunk, 0x00), STEP64(JitThunk, 0x40),
+   STEP64(JitThunk, 0x80), STEP64(JitThunk, 0xC0)
+};
+#endif
+
+#undef STEP64
+#undef STEP16
+#undef STEP4
+
+// remember where an instruction started, for the jumps back to it
+#if defined(IDLE_LOOPS) || defined(BREAKPOINTS)
+#define JUMP_FROM() from = pc
+#else
+#define JUMP_FROM()
+#endif
+
+// idle loop detection: look for a loop after a jump back to where the
+// instruction started or before it
+#ifdef IDLE_LOOPS
+#define IDLE_RESET() idleArmed = false
+#define IDLE_AFTER(OP) \
+   if (JUMP_OP(OP) && pc <= from) \
+      IdleCheck(cyclesRemaining, cycleCount)
+#else
+#define IDLE_RESET()
+#define IDLE_AFTER(OP)
+#endif
+
+// breakpoints before the opcode fetch, and a return after the events of
+// an instruction that hit a watchpoint
+#ifdef BREAKPOINTS
+#define STOP_RESET() \
+   if (stopping) StopTaken(); \
+   stopReason = STOP_NONE; \
+   if (pc != breakResume) breakResume = -1
+#define BREAK_CHECK() if (ADDR_BIT(breakBits, pc) && Break()) return
+#define STOP_RETURN() if (stopping) { StopTaken(); return; }
+#else
+#define STOP_RESET()
+#define BREAK_CHECK()
+#define STOP_RETURN()
+#endif
+
+// RunUntil() traps: a jump to where it started, after its events. Only
+// the jump opcodes test anything
+#ifdef BREAKPOINTS
+#define TRAP_AFTER(OP) \
+   if (JUMP_OP(OP) && stopTrap && pc == from) { \
+      stopReason = STOP_TRAP; \
+      stopAddr = pc; \
+      return; \
+   }
+#else
+#define TRAP_AFTER(OP)
+#endif
+
+// instruction trace, around each instruction outside the pairs and the
+// translated blocks
+#ifdef TRACE
+#define TRACE_BEFORE(OP) if (trace) TraceBefore(OP, cycleCount)
+#define TRACE_AFTER(ELAPSED) if (trace) TraceAfter(ELAPSED)
+#else
+#define TRACE_BEFORE(OP)
+#define TRACE_AFTER(ELAPSED)
+#endif
+
+// per-PC profile: remember where the instruction started, then charge it
+#ifdef PROFILE
+#define PROFILE_FROM() at = pc
+#define PROFILE_AFTER(ELAPSED, BASE) \
+   if (profile) { \
+      ProfileEntry& e = profile[at]; \
+      e.count++; \
+      e.cycles += ELAPSED; \
+      e.penalty += (ELAPSED) - (BASE); \
+   }
+#else
+#define PROFILE_FROM()
+#define PROFILE_AFTER(ELAPSED, BASE)
+#endif
+
+#ifdef THREADED_DISPATCH
+
+#ifndef __GNUC__
+#error "THREADED_DISPATCH needs the GCC/Clang labels-as-values extension"
+#endif
+#ifdef BLOCK_CACHE
+#error "THREADED_DISPATCH and BLOCK_CACHE are two different engines, pick one"
+#endif
+
+// base cost of every opcode for the labels of Run(), 0 for those not in
+// the opcode table, which the Step<> fallback stops on as illegal
+template<uint8_t OP> struct ThreadedCycles { static constexpr uint8_t value = 0; };
+#define MAKE_INSTR(HEX, CODE, MODE, CYCLES, PENALTY) \
+template<> struct ThreadedCycles<HEX> { static constexpr uint8_t value = CYCLES; }
+#include "mos6502_opcodes.h"
+#undef MAKE_INSTR
+
+// the 16 labels of a row of the opcode map, L_0x<ROW>0 to L_0x<ROW>F
+#define ROW16(X, ROW) X(0x ## ROW ## 0) X(0x ## ROW ## 1) X(0x ## ROW ## 2) \
+   X(0x ## ROW ## 3) X(0x ## ROW ## 4) X(0x ## ROW ## 5) X(0x ## ROW ## 6) \
+   X(0x ## ROW ## 7) X(0x ## ROW ## 8) X(0x ## ROW ## 9) X(0x ## ROW ## A) \
+   X(0x ## ROW ## B) X(0x ## ROW ## C) X(0x ## ROW ## D) X(0x ## ROW ## E) \
+   X(0x ## ROW ## F)
+#define ROW256(X) ROW16(X, 0) ROW16(X, 1) ROW16(X, 2) ROW16(X, 3) \
+   ROW16(X, 4) ROW16(X, 5) ROW16(X, 6) ROW16(X, 7) ROW16(X, 8) \
+   ROW16(X, 9) ROW16(X, A) ROW16(X, B) ROW16(X, C) ROW16(X, D) \
+   ROW16(X, E) ROW16(X, F)
+
+// threaded dispatch: every opcode gets its own label running its fused
+// Step<> handler, with the cycle cost folded into a constant. Each handler
+// ends by fetching the next opcode and jumping straight to its label, so
+// there is no table lookup and no call through a member function pointer.
+void mos6502::Run(
+      int32_t cyclesRemaining,
+      uint64_t& cycleCount,
+      CycleMethod cycleMethod)
+{
+   // constant, so that CPUs on several threads share it without a race
+#define LABEL_ADDR(HEX) &&L_ ## HEX,
+   static void* const dispatch[256] = { ROW256(LABEL_ADDR) };
+#undef LABEL_ADDR
+   uint8_t opcode;
+   uint8_t elapsed;
+#if defined(IDLE_LOOPS) || defined(BREAKPOINTS)
+   uint16_t from = 0;
+#endif
+#ifdef PROFILE
+   uint16_t at = 0;
+#endif
+
+   IDLE_RESET();
+   STOP_RESET();
+
+   // events that fell due between two calls
+   if (cycleCount >= eventNext) RunEvents(cycleCount);
+
+// CheckInterrupts() is only called when one of the lines is active,
+// keeping the common path of every handler free of calls
+#define DISPATCH() \
+   if (cyclesRemaining <= 0 || illegalOpcode) return; \
+   if ((nmi_request || !irq_line) && CheckInterrupts()) { \
+      cycleCount += 6; \
+      Tick(6); \
+   } \
+   BREAK_CHECK(); \
+   JUMP_FROM(); \
+   PROFILE_FROM(); \
+   opcode = ReadCode(pc++); \
+   TRACE_BEFORE(opcode); \
+   goto *dispatch[opcode];
+
+#define NEXT_INSTR(OP, CYCLES) \
+   elapsed = Step<OP>(); \
+   TRACE_AFTER(elapsed); \
+   PROFILE_AFTER(elapsed, CYCLES); \
+   cycleCount += elapsed; \
+   cyclesRemaining -= cycleMethod == CYCLE_COUNT ? CYCLES : 1; \
+   Tick(elapsed); \
+   if (cycleCount >= eventNext) { RunEvents(cycleCount); STOP_RETURN(); } \
+   TRAP_AFTER(OP); \
+   IDLE_AFTER(OP); \
+   DISPATCH()
+
+   DISPATCH();
+
+#define LABEL(HEX) \
+L_ ## HEX: \
+   NEXT_INSTR(HEX, ThreadedCycles<HEX>::value);
+   ROW256(LABEL)
+#undef LABEL
+
+#undef NEXT_INSTR
+#undef DISPATCH
+}
+
+#undef ROW256
+#undef ROW16
+
+#elif defined(BLOCK_CACHE)
+
+void mos6502::FlushBlockCache()
+{
+   for(int i = 0; i < 256; i++)
+   {
+      pageGen[i]++;
+   }
+   flushes++;
+}
+
+void mos6502::DecodeBlock(Block* b, uint16_t addr)
+{
+   uint8_t n = 0;
+   uint8_t offset = 0;
+   uint16_t last = addr;
+
+   b->start = addr;
+   b->cycles = 0;
+#ifdef JIT
+   b->hits = 0;
+   b->code = nullptr;
+#endif
+
+   while(n < BLOCK_MAX_INSTR)
+   {
+#ifdef BREAKPOINTS
+      // a breakpoint starts a block, Run() checks it before the block
+      if (n > 0 && ADDR_BIT(breakBits, addr)) break;
+#endif
+      uint8_t opcode = ReadCode(addr);
+      const Instr& instr = InstrTable[opcode];
+
+      b->instr[n].step = StepTable[opcode];
+      b->instr[n].cycles = instr.cycles;
+      b->instr[n].offset = offset;
+      b->cycles += instr.cycles;
+      n++;
+
+      b->bytes[offset++] = opcode;
+      for(int i = 1; i < instr.bytes; i++)
+      {
+         b->bytes[offset++] = ReadCode(addr + i);
+      }
+      last = addr + instr.bytes - 1;
+      addr += instr.bytes;
+
+      // stop at anything that may not fall through
+      if (instr.addr == &mos6502::Addr_REL ||
+          instr.code == &mos6502::Op_JMP ||
+          instr.code == &mos6502::Op_JSR ||
+          instr.code == &mos6502::Op_RTS ||
+          instr.code == &mos6502::Op_RTI ||
+          instr.code == &mos6502::Op_BRK ||
+          instr.code == &mos6502::Op_ILLEGAL)
+      {
+         break;
+      }
+   }
+
+   b->count = n;
+
+#ifdef SUPERINSTRUCTIONS
+   for(uint8_t i = 0; i < n; i++)
+   {
+      b->instr[i].pair = nullptr;
+   }
+   for(uint8_t i = 0; i + 1 < n; i++)
+   {
+      uint8_t first = b->bytes[b->instr[i].offset];
+      uint8_t second = b->bytes[b->instr[i + 1].offset];
+
+      for(int j = 0; j < PAIR_COUNT; j++)
+      {
+         if (PairTable[j].first == first && PairTable[j].second == second)
+         {
+            b->instr[i].pair = PairTable[j].step;
+            b->instr[i].pairIndex = j;
+            i++; // pairs do not overlap
+            break;
+         }
+      }
+   }
+#endif
+
+   b->page[0] = b->start >> 8;
+   b->page[1] = last >> 8;
+   b->gen[0] = pageGen[b->page[0]];
+   b->gen[1] = pageGen[b->page[1]];
+}
+
+mos6502::Block* mos6502::FindBlock(uint16_t addr)
+{
+   Block* b = &blocks[addr & (BLOCK_CACHE_SIZE - 1)];
+
+   if (b->count == 0 || b->start != addr ||
+       b->gen[0] != pageGen[b->page[0]] ||
+       b->gen[1] != pageGen[b->page[1]])
+   {
+      DecodeBlock(b, addr);
+   }
+   return b;
+}
+
+#ifdef JIT
+
+// x86-64 registers
+#define RAX 0
+#define RCX 1
+#define RDX 2
+#define RBX 3
+#define RBP 5
+#define R12 12
+#define R13 13
+#define R14 14
+#define R15 15
+
+// where translated code keeps the CPU and its registers
+#define HOST_CPU RBX
+#define HOST_A   R12
+#define HOST_X   R13
+#define HOST_Y   R14
+#define HOST_S   RBP
+#define HOST_P   R15
+
+// x86 condition codes
+#define CC_B  0x2
+#define CC_AE 0x3
+#define CC_E  0x4
+#define CC_NE 0x5
+
+// x86 group 1 and group 2 opcode extensions
+#define ALU_ADD 0
+#define ALU_OR  1
+#define ALU_AND 4
+#define ALU_SUB 5
+#define ALU_XOR 6
+#define ALU_CMP 7
+#define SHIFT_SHL 4
+#define SHIFT_SHR 5
+
+// 6502 registers cached in host registers, for the dirty mask
+#define DIRTY_A 0x01
+#define DIRTY_X 0x02
+#define DIRTY_Y 0x04
+#define DIRTY_S 0x08
+#define DIRTY_P 0x10
+
+// minimal x86-64 encoder, 32 bit operations on zero extended bytes. A REX
+// prefix is always emitted so that byte registers are never AH..BH, and
+// every memory operand is [rbx + disp32], rbx being the CPU
+struct JitEmitter
+{
+   uint8_t* p;
+
+   void Byte(uint8_t b) { *p++ = b; }
+   void Dword(uint32_t d) { memcpy(p, &d, 4); p += 4; }
+   void Qword(uint64_t q) { memcpy(p, &q, 8); p += 8; }
+
+   void Rex(bool w, int reg, int rm)
+   {
+      Byte(0x40 | (w ? 8 : 0) | ((reg & 8) ? 4 : 0) | ((rm & 8) ? 1 : 0));
+   }
+   void ModReg(int reg, int rm) { Byte(0xC0 | (reg & 7) << 3 | (rm & 7)); }
+   void ModMem(int reg, int32_t disp) { Byte(0x80 | (reg & 7) << 3 | RBX); Dword(disp); }
+
+   // mov dst, src
+   void Mov(int dst, int src) { Rex(false, src, dst); Byte(0x89); ModReg(src, dst); }
+   // movzx dst, src8
+   void Movzx(int dst, int src) { Rex(false, dst, src); Byte(0x0F); Byte(0xB6); ModReg(dst, src); }
+   // mov dst, imm32
+   void MovImm(int dst, uint32_t imm) { Rex(false, 0, dst); Byte(0xB8 | (dst & 7)); Dword(imm); }
+   // or/and/add dst, src
+   void Or(int dst, int src) { Rex(false, src, dst); Byte(0x09); ModReg(src, dst); }
+   void Add(int dst, int src) { Rex(false, src, dst); Byte(0x01); ModReg(src, dst); }
+   // group 1 op dst, imm32
+   void Alu(int ext, int dst, uint32_t imm) { Rex(false, 0, dst); Byte(0x81); ModReg(ext, dst); Dword(imm); }
+   // inc/dec dst
+   void Inc(int dst) { Rex(false, 0, dst); Byte(0xFF); ModReg(0, dst); }
+   void Dec(int dst) { Rex(false, 0, dst); Byte(0xFF); ModReg(1, dst); }
+   // shl/shr dst, n
+   void Shift(int ext, int dst, uint8_t n) { Rex(false, 0, dst); Byte(0xC1); ModReg(ext, dst); Byte(n); }
+   // test r8, r8
+   void Test(int r) { Rex(false, r, r); Byte(0x84); ModReg(r, r); }
+   // setcc dst8
+   void Set(int cc, int dst) { Rex(false, 0, dst); Byte(0x0F); Byte(0x90 | cc); ModReg(0, dst); }
+
+   // movzx dst, byte [cpu + disp]
+   void Load8(int dst, int32_t disp) { Rex(false, dst, RBX); Byte(0x0F); Byte(0xB6); ModMem(dst, disp); }
+   // mov byte [cpu + disp], src8
+   void Store8(int32_t disp, int src) { Rex(false, src, RBX); Byte(0x88); ModMem(src, disp); }
+   // mov byte [cpu + disp], imm8
+   void Store8Imm(int32_t disp, uint8_t imm) { Byte(0xC6); ModMem(0, disp); Byte(imm); }
+   // mov word [cpu + disp], imm16
+   void Store16Imm(int32_t disp, uint16_t imm) { Byte(0x66); Byte(0xC7); ModMem(0, disp); Byte(imm); Byte(imm >> 8); }
+   // mov rax, imm64 ; mov qword [cpu + disp], rax
+   void Store64Imm(int32_t disp, uint64_t imm) { Byte(0x48); Byte(0xB8); Qword(imm); Byte(0x48); Byte(0x89); ModMem(RAX, disp); }
+   // cmp byte [cpu + disp], imm8
+   void Cmp8Imm(int32_t disp, uint8_t imm) { Byte(0x80); ModMem(ALU_CMP, disp); Byte(imm); }
+   // cmp dword [cpu + disp], imm32
+   void Cmp32Imm(int32_t disp, uint32_t imm) { Byte(0x81); ModMem(ALU_CMP, disp); Dword(imm); }
+
+   // jcc rel32, returns the displacement to patch
+   uint8_t* Jcc(int cc) { Byte(0x0F); Byte(0x80 | cc); Dword(0); return p - 4; }
+   uint8_t* Jmp() { Byte(0xE9); Dword(0); return p - 4; }
+   void Patch(uint8_t* rel) { uint32_t d = (uint32_t)(p - (rel + 4)); memcpy(rel, &d, 4); }
+
+   // fn(cpu), then add the cycles returned to the counter at [rsp]
+   void Call(void* fn)
+   {
+      Byte(0x48); Byte(0x89); Byte(0xDF);                   // mov rdi, rbx
+      Byte(0x48); Byte(0xB8); Qword((uint64_t)fn);          // mov rax, fn
+      Byte(0xFF); Byte(0xD0);                               // call rax
+      Byte(0x0F); Byte(0xB6); Byte(0xC0);                   // movzx eax, al
+      Byte(0x48); Byte(0x01); Byte(0x04); Byte(0x24);       // add [rsp], rax
+   }
+};
+
+// opcodes translated inline, all of them register-only with a fixed cost
+static bool JitInline(uint8_t opcode)
+{
+#ifdef PERF_COUNTERS
+   // the counters are kept by the handlers
+   return false;
+#endif
+   switch(opcode)
+   {
+      case 0xAA: case 0xA8: case 0x8A: case 0x98: case 0xBA: case 0x9A:
+      case 0xE8: case 0xC8: case 0xCA: case 0x88:
+      case 0xA9: case 0xA2: case 0xA0:
+      case 0x29: case 0x09: case 0x49:
+      case 0xC9: case 0xE0: case 0xC0:
+      case 0x18: case 0x38: case 0xD8: case 0xF8:
+      case 0x58: case 0x78: case 0xB8:
+      case 0xEA: case 0x0A: case 0x4A:
+         return true;
+      default:
+         return false;
+   }
+}
+
+mos6502::JitCode mos6502::JitTranslate(Block* b)
+{
+   // generous upper bound of the code size of a block
+   const uint32_t worst = 64 + BLOCK_MAX_INSTR * 128;
+
+   if (jitUsed + worst > JIT_CODE_SIZE)
+   {
+      // out of room: throw every translation away and start over. The
+      // blocks count their runs again, or they would never be translated
+      for(int i = 0; i < BLOCK_CACHE_SIZE; i++)
+      {
+         blocks[i].code = nullptr;
+         blocks[i].hits = 0;
+      }
+      jitUsed = 0;
+   }
+
+   const int32_t offA = (uint8_t*)&A - (uint8_t*)this;
+   const int32_t offX = (uint8_t*)&X - (uint8_t*)this;
+   const int32_t offY = (uint8_t*)&Y - (uint8_t*)this;
+   const int32_t offS = (uint8_t*)&sp - (uint8_t*)this;
+   const int32_t offP = (uint8_t*)&status - (uint8_t*)this;
+   const int32_t offPC = (uint8_t*)&pc - (uint8_t*)this;
+   const int32_t offFetch = (uint8_t*)&fetch - (uint8_t*)this;
+   const int32_t offNmi = (uint8_t*)&nmi_request - (uint8_t*)this;
+   const int32_t offIrq = (uint8_t*)&irq_line - (uint8_t*)this;
+   const int32_t offGen = (uint8_t*)&pageGen[0] - (uint8_t*)this;
+#ifdef LAZY_FLAGS
+   const int32_t offN = (uint8_t*)&flag_n - (uint8_t*)this;
+   const int32_t offZ = (uint8_t*)&flag_z - (uint8_t*)this;
+#endif
+
+   JitEmitter e;
+   e.p = jitCode + jitUsed;
+   uint8_t* entry = e.p;
+
+   // prologue: save the callee-saved registers, 16 byte aligned frame
+   // with the handler cycles at [rsp] and the counter pointer at [rsp+8]
+   e.Byte(0x53);                                            // push rbx
+   e.Byte(0x55);                                            // push rbp
+   e.Byte(0x41); e.Byte(0x54);                              // push r12
+   e.Byte(0x41); e.Byte(0x55);                              // push r13
+   e.Byte(0x41); e.Byte(0x56);                              // push r14
+   e.Byte(0x41); e.Byte(0x57);                              // push r15
+   e.Byte(0x48); e.Byte(0x83); e.Byte(0xEC); e.Byte(0x18);  // sub rsp, 24
+   e.Byte(0x48); e.Byte(0x89); e.Byte(0xFB);                // mov rbx, rdi
+   e.Byte(0x48); e.Byte(0x89); e.Byte(0x74);
+   e.Byte(0x24); e.Byte(0x08);                              // mov [rsp+8], rsi
+   e.Byte(0x48); e.Byte(0xC7); e.Byte(0x04);
+   e.Byte(0x24); e.Dword(0);                                // mov qword [rsp], 0
+
+   // N and Z from the byte in r
+#ifdef LAZY_FLAGS
+#define JIT_NZ(r) \
+   (e.Store8(offN, r), e.Store8(offZ, r))
+#define JIT_NZ_IMM(v) \
+   (e.Store8Imm(offN, v), e.Store8Imm(offZ, v))
+#else
+#define JIT_NZ(r) \
+   (e.Alu(ALU_AND, HOST_P, ~(uint32_t)(NEGATIVE | ZERO)), \
+    e.Mov(RCX, r), e.Alu(ALU_AND, RCX, NEGATIVE), e.Or(HOST_P, RCX), \
+    e.Test(r), e.Set(CC_E, RCX), e.Movzx(RCX, RCX), e.Add(RCX, RCX), \
+    e.Or(HOST_P, RCX), dirty |= DIRTY_P)
+#define JIT_NZ_IMM(v) \
+   (e.Alu(ALU_AND, HOST_P, ~(uint32_t)(NEGATIVE | ZERO)), \
+    e.Alu(ALU_OR, HOST_P, ((v) & NEGATIVE) | ((v) ? 0 : ZERO)), \
+    dirty |= DIRTY_P)
+#endif
+   // carry from the 0/1 value in rcx
+#define JIT_CARRY() \
+   (e.Alu(ALU_AND, HOST_P, ~(uint32_t)CARRY), e.Or(HOST_P, RCX), \
+    dirty |= DIRTY_P)
+
+   struct Exit
+   {
+      uint8_t* patch[4];
+      int patches;
+      uint32_t count;
+      uint32_t cycles;
+   };
+   Exit exits[BLOCK_MAX_INSTR];
+   int nexits = 0;
+
+   bool loaded = false;   // registers in the host registers?
+   uint8_t dirty = 0;     // host registers newer than the CPU
+   uint32_t inlineCycles = 0;
+   uint16_t next = b->start;
+
+   for(int i = 0; i < b->count; i++)
+   {
+      const BlockInstr& instr = b->instr[i];
+      const uint8_t* bytes = b->bytes + instr.offset;
+      const uint8_t opcode = bytes[0];
+      const uint8_t imm = bytes[1];
+      const uint16_t addr = b->start + instr.offset;
+
+      next = addr + InstrTable[opcode].bytes;
+
+      if (JitInline(opcode))
+      {
+         if (!loaded)
+         {
+            e.Load8(HOST_A, offA);
+            e.Load8(HOST_X, offX);
+            e.Load8(HOST_Y, offY);
+            e.Load8(HOST_S, offS);
+            e.Load8(HOST_P, offP);
+            loaded = true;
+         }
+
+         switch(opcode)
+         {
+            case 0xAA: e.Mov(HOST_X, HOST_A); JIT_NZ(HOST_X); dirty |= DIRTY_X; break; // TAX
+            case 0xA8: e.Mov(HOST_Y, HOST_A); JIT_NZ(HOST_Y); dirty |= DIRTY_Y; break; // TAY
+            case 0x8A: e.Mov(HOST_A, HOST_X); JIT_NZ(HOST_A); dirty |= DIRTY_A; break; // TXA
+            case 0x98: e.Mov(HOST_A, HOST_Y); JIT_NZ(HOST_A); dirty |= DIRTY_A; break; // TYA
+            case 0xBA: e.Mov(HOST_X, HOST_S); JIT_NZ(HOST_X); dirty |= DIRTY_X; break; // TSX
+            case 0x9A: e.Mov(HOST_S, HOST_X); dirty |= DIRTY_S; break;                 // TXS
+
+            case 0xE8: e.Inc(HOST_X); e.Movzx(HOST_X, HOST_X); JIT_NZ(HOST_X); dirty |= DIRTY_X; break; // INX
+            case 0xC8: e.Inc(HOST_Y); e.Movzx(HOST_Y, HOST_Y); JIT_NZ(HOST_Y); dirty |= DIRTY_Y; break; // INY
+            case 0xCA: e.Dec(HOST_X); e.Movzx(HOST_X, HOST_X); JIT_NZ(HOST_X); dirty |= DIRTY_X; break; // DEX
+            case 0x88: e.Dec(HOST_Y); e.Movzx(HOST_Y, HOST_Y); JIT_NZ(HOST_Y); dirty |= DIRTY_Y; break; // DEY
+
+            case 0xA9: e.MovImm(HOST_A, imm); JIT_NZ_IMM(imm); dirty |= DIRTY_A; break; // LDA #
+            case 0xA2: e.MovImm(HOST_X, imm); JIT_NZ_IMM(imm); dirty |= DIRTY_X; break; // LDX #
+            case 0xA0: e.MovImm(HOST_Y, imm); JIT_NZ_IMM(imm); dirty |= DIRTY_Y; break; // LDY #
+
+            case 0x29: e.Alu(ALU_AND, HOST_A, imm); JIT_NZ(HOST_A); dirty |= DIRTY_A; break; // AND #
+            case 0x09: e.Alu(ALU_OR, HOST_A, imm); JIT_NZ(HOST_A); dirty |= DIRTY_A; break;  // ORA #
+            case 0x49: e.Alu(ALU_XOR, HOST_A, imm); JIT_NZ(HOST_A); dirty |= DIRTY_A; break; // EOR #
+
+            case 0xC9: // CMP #
+            case 0xE0: // CPX #
+            case 0xC0: // CPY #
+               e.Mov(RAX, opcode == 0xC9 ? HOST_A : opcode == 0xE0 ? HOST_X : HOST_Y);
+               e.Alu(ALU_SUB, RAX, imm);
+               e.Set(CC_AE, RCX);
+               e.Movzx(RCX, RCX);
+               JIT_CARRY();
+               e.Movzx(RAX, RAX);
+               JIT_NZ(RAX);
+               break;
+
+            case 0x18: e.Alu(ALU_AND, HOST_P, ~(uint32_t)CARRY); dirty |= DIRTY_P; break;     // CLC
+            case 0x38: e.Alu(ALU_OR, HOST_P, CARRY); dirty |= DIRTY_P; break;                 // SEC
+            case 0xD8: e.Alu(ALU_AND, HOST_P, ~(uint32_t)DECIMAL); dirty |= DIRTY_P; break;   // CLD
+            case 0xF8: e.Alu(ALU_OR, HOST_P, DECIMAL); dirty |= DIRTY_P; break;               // SED
+            case 0x58: e.Alu(ALU_AND, HOST_P, ~(uint32_t)INTERRUPT); dirty |= DIRTY_P; break; // CLI
+            case 0x78: e.Alu(ALU_OR, HOST_P, INTERRUPT); dirty |= DIRTY_P; break;             // SEI
+            case 0xB8: e.Alu(ALU_AND, HOST_P, ~(uint32_t)OVERFLOW); dirty |= DIRTY_P; break;  // CLV
+
+            case 0xEA: break; // NOP
+
+            case 0x0A: // ASL A
+               e.Mov(RCX, HOST_A);
+               e.Shift(SHIFT_SHR, RCX, 7);
+               JIT_CARRY();
+               e.Shift(SHIFT_SHL, HOST_A, 1);
+               e.Movzx(HOST_A, HOST_A);
+               JIT_NZ(HOST_A);
+               dirty |= DIRTY_A;
+               break;
+
+            case 0x4A: // LSR A
+               e.Mov(RCX, HOST_A);
+               e.Alu(ALU_AND, RCX, 1);
+               JIT_CARRY();
+               e.Shift(SHIFT_SHR, HOST_A, 1);
+               JIT_NZ(HOST_A);
+               dirty |= DIRTY_A;
+               break;
+         }
+
+         inlineCycles += instr.cycles;
+
+         if (i == b->count - 1)
+         {
+            // the block ends here, leave pc past the last instruction
+            e.Store16Imm(offPC, next);
+         }
+         continue;
+      }
+
+      // the handler works on the CPU, write back what changed
+      if (dirty & DIRTY_A) e.Store8(offA, HOST_A);
+      if (dirty & DIRTY_X) e.Store8(offX, HOST_X);
+      if (dirty & DIRTY_Y) e.Store8(offY, HOST_Y);
+      if (dirty & DIRTY_S) e.Store8(offS, HOST_S);
+      if (dirty & DIRTY_P) e.Store8(offP, HOST_P);
+      dirty = 0;
+      loaded = false;
+
+      // same state the interpreter sets up before calling the handler
+      e.Store16Imm(offPC, addr + 1);
+      if (InstrTable[opcode].bytes > 1)
+      {
+         e.Store64Imm(offFetch, (uint64_t)(bytes + 1));
+      }
+      e.Call((void*)JitThunkTable[opcode]);
+
+      if (i == b->count - 1)
+      {
+         break;
+      }
+
+      // leave when the handler raised an interrupt line (from a bus
+      // callback) or wrote to the code of this block
+      Exit& exit = exits[nexits++];
+      exit.count = i + 1;
+      exit.cycles = inlineCycles;
+      exit.patches = 0;
+      e.Cmp8Imm(offNmi, 0);
+      exit.patch[exit.patches++] = e.Jcc(CC_NE);
+      e.Cmp8Imm(offIrq, 0);
+      exit.patch[exit.patches++] = e.Jcc(CC_E);
+      e.Cmp32Imm(offGen + 4 * b->page[0], b->gen[0]);
+      exit.patch[exit.patches++] = e.Jcc(CC_NE);
+      if (b->page[1] != b->page[0])
+      {
+         e.Cmp32Imm(offGen + 4 * b->page[1], b->gen[1]);
+         exit.patch[exit.patches++] = e.Jcc(CC_NE);
+      }
+   }
+
+   // the last instruction was inline: write back what changed
+   if (dirty & DIRTY_A) e.Store8(offA, HOST_A);
+   if (dirty & DIRTY_X) e.Store8(offX, HOST_X);
+   if (dirty & DIRTY_Y) e.Store8(offY, HOST_Y);
+   if (dirty & DIRTY_S) e.Store8(offS, HOST_S);
+   if (dirty & DIRTY_P) e.Store8(offP, HOST_P);
+
+   // ecx = cycles of the inline instructions, eax = instructions run
+   e.MovImm(RCX, inlineCycles);
+   e.MovImm(RAX, b->count);
+   uint8_t* done = e.Jmp();
+
+   for(int i = 0; i < nexits; i++)
+   {
+      for(int j = 0; j < exits[i].patches; j++)
+      {
+         e.Patch(exits[i].patch[j]);
+      }
+      e.MovImm(RCX, exits[i].cycles);
+      e.MovImm(RAX, exits[i].count);
+      exits[i].patch[0] = e.Jmp();
+   }
+
+   // epilogue: add all the cycles to the counter and return
+   e.Patch(done);
+   for(int i = 0; i < nexits; i++)
+   {
+      e.Patch(exits[i].patch[0]);
+   }
+   e.Byte(0x48); e.Byte(0x03); e.Byte(0x0C); e.Byte(0x24);  // add rcx, [rsp]
+   e.Byte(0x48); e.Byte(0x8B); e.Byte(0x54);
+   e.Byte(0x24); e.Byte(0x08);                              // mov rdx, [rsp+8]
+   e.Byte(0x48); e.Byte(0x01); e.Byte(0x0A);                // add [rdx], rcx
+   e.Byte(0x48); e.Byte(0x83); e.Byte(0xC4); e.Byte(0x18);  // add rsp, 24
+   e.Byte(0x41); e.Byte(0x5F);                              // pop r15
+   e.Byte(0x41); e.Byte(0x5E);                              // pop r14
+   e.Byte(0x41); e.Byte(0x5D);                              // pop r13
+   e.Byte(0x41); e.Byte(0x5C);                              // pop r12
+   e.Byte(0x5D);                                            // pop rbp
+   e.Byte(0x5B);                                            // pop rbx
+   e.Byte(0xC3);                                            // ret
+
+#undef JIT_CARRY
+#undef JIT_NZ_IMM
+#undef JIT_NZ
+
+   jitUsed = e.p - jitCode;
+   jitBlocks++;
+   return (JitCode)entry;
+}
+
+void mos6502::EnableJit(bool enable)
+{
+   jitEnabled = enable && jitCode != nullptr;
+}
+
+uint64_t mos6502::GetJitBlocks()
+{
+   return jitBlocks;
+}
+
+#endif
+
+#ifdef IDLE_LOOPS
+// the block ended with a jump back to it or before it
+#define IDLE_BLOCK_END(b) \
+   if (JUMP_OP(b->bytes[b->instr[b->count - 1].offset]) && \
+       pc <= (uint16_t)(b->start + b->instr[b->count - 1].offset)) \
+      IdleCheck(cyclesRemaining, cycleCount)
+#else
+#define IDLE_BLOCK_END(b)
+#endif
+
+// the block ended with a jump to itself, a RunUntil() trap
+#ifdef BREAKPOINTS
+#define TRAP_BLOCK_END(b) \
+   if (JUMP_OP(b->bytes[b->instr[b->count - 1].offset]) && stopTrap && \
+       pc == (uint16_t)(b->start + b->instr[b->count - 1].offset)) { \
+      stopReason = STOP_TRAP; \
+      stopAddr = pc; \
+      return; \
+   }
+#else
+#define TRAP_BLOCK_END(b)
+#endif
+
+// block cache: opcodes and operands come from the decoded block instead of
+// the bus, and the per-instruction budget check is skipped when the whole
+// block fits in what is left. A block is left early when an interrupt is
+// taken or a write hits the code it was decoded from.
+void mos6502::Run(
+      int32_t cyclesRemaining,
+      uint64_t& cycleCount,
+      CycleMethod cycleMethod)
+{
+   bool check = true;
+#ifdef PROFILE
+   uint16_t at;
+#endif
+
+   IDLE_RESET();
+   STOP_RESET();
+
+   // events that fell due between two calls
+   if (cycleCount >= eventNext) RunEvents(cycleCount);
+
+   while(cyclesRemaining > 0 && !illegalOpcode)
+   {
+      if (check && (nmi_request || !irq_line) && CheckInterrupts()) {
+         cycleCount += 6;
+         Tick(6);
+      }
+      check = true;
+      BREAK_CHECK();
+
+      Block* b = FindBlock(pc);
+      // no instruction takes more than twice its base cycles, so a block
+      // that fits also ends before the next event
+      bool fits = cyclesRemaining >
+         (cycleMethod == CYCLE_COUNT ? b->cycles : b->count) &&
+         eventNext > cycleCount + 2 * b->cycles;
+
+#ifdef JIT
+      // translated code runs whole blocks, so it needs the block to fit
+      // in the budget, no cycle callback and no pending interrupt
+      if (fits && !Cycles && !INSTRUMENTED() && !WATCHING() && !nmi_request && irq_line &&
+          jitEnabled)
+      {
+         if (b->code)
+         {
+            uint32_t n = b->code(this, &cycleCount);
+
+            if (cycleMethod == CYCLE_COUNT)
+               for(uint32_t i = 0; i < n; i++)
+                  cyclesRemaining -= b->instr[i].cycles;
+            else
+               cyclesRemaining -= n;
+            if (cycleCount >= eventNext)
+            {
+               RunEvents(cycleCount);
+               STOP_RETURN();
+            }
+            if (n == b->count)
+            {
+               TRAP_BLOCK_END(b);
+               IDLE_BLOCK_END(b);
+            }
+            continue;
+         }
+         if (++b->hits == JIT_THRESHOLD)
+         {
+            b->code = JitTranslate(b);
+         }
+      }
+#endif
+
+      for(uint8_t i = 0; ; )
+      {
+         const BlockInstr& instr = b->instr[i];
+         uint8_t cycles = instr.cycles;
+         uint8_t ran = 1;
+
+         // the opcode was fetched at decode time
+         fetch = b->bytes + instr.offset + 1;
+         PROFILE_FROM();
+         pc++;
+         TRACE_BEFORE(b->bytes[instr.offset]);
+#ifdef SUPERINSTRUCTIONS
+         // a pair skips the budget check and the cycle callbacks between
+         // its two halves, so it needs none of them to matter
+         if (instr.pair && fits && !Cycles && !INSTRUMENTED() && !nmi_request && irq_line)
+         {
+            cycleCount += (this->*instr.pair)();
+            if (!pairSplit)
+            {
+#ifdef SUPERINSTRUCTIONS_STATS
+               pairRuns[instr.pairIndex]++;
+#endif
+               cycles += b->instr[++i].cycles;
+               ran = 2;
+            }
+            pairSplit = false;
+         }
+         else
+#endif
+         {
+            uint8_t elapsed = (this->*instr.step)();
+            TRACE_AFTER(elapsed);
+            PROFILE_AFTER(elapsed, cycles);
+            cycleCount += elapsed;
+
+            // run clock cycle callback
+            Tick(elapsed);
+         }
+
+         cyclesRemaining -=
+            cycleMethod == CYCLE_COUNT        ? cycles
+            /* cycleMethod == INST_COUNT */   : ran;
+
+         if (cycleCount >= eventNext)
+         {
+            RunEvents(cycleCount);
+            STOP_RETURN();
+         }
+
+         if (++i == b->count)
+         {
+            TRAP_BLOCK_END(b);
+            IDLE_BLOCK_END(b);
+            break;
+         }
+         if (!fits && cyclesRemaining <= 0) break;
+         if (b->gen[0] != pageGen[b->page[0]] ||
+             b->gen[1] != pageGen[b->page[1]]) break;
+         if ((nmi_request || !irq_line) && CheckInterrupts()) {
+            cycleCount += 6;
+            Tick(6);
+            check = false;
+            break;
+         }
+      }
+   }
+}
+
+#undef TRAP_BLOCK_END
+#undef IDLE_BLOCK_END
+
+#else
+
 void mos6502::Run(
       int32_t cyclesRemaining,
       uint64_t& cycleCount,
       CycleMethod cycleMethod)
 {
    uint8_t opcode;
-   Instr instr;
+   uint8_t cycles;
+   uint8_t elapsed;
+#if defined(IDLE_LOOPS) || defined(BREAKPOINTS)
+   uint16_t from;
+#endif
+#ifdef PROFILE
+   uint16_t at;
+#endif
+
+   IDLE_RESET();
+   STOP_RESET();
+
+   // events that fell due between two calls
+   if (cycleCount >= eventNext) RunEvents(cycleCount);
 
    while(cyclesRemaining > 0 && !illegalOpcode)
    {
       if (CheckInterrupts()) {
          cycleCount += 6; // TODO FIX verify this is correct
+         Tick(6);
       }
+      BREAK_CHECK();
 
       // fetch
-      opcode = Read(pc++);
-
-      // decode
-      instr = InstrTable[opcode];
-
-      // execute
-      Exec(instr);
-
-      cycleCount += instr.cycles;
-      if (branched) {
-         cycleCount++;
-      }
-      if (instr.penalty && crossed) {
-         cycleCount++;
-      }
+      JUMP_FROM();
+      PROFILE_FROM();
+      opcode = ReadCode(pc++);
+      TRACE_BEFORE(opcode);
+
+      // decode and execute
+      elapsed = (this->*StepTable[opcode])();
+      TRACE_AFTER(elapsed);
+      cycleCount += elapsed;
+
+      cycles = InstrTable[opcode].cycles;
+      PROFILE_AFTER(elapsed, cycles);
       cyclesRemaining -=
-         cycleMethod == CYCLE_COUNT        ? instr.cycles
+         cycleMethod == CYCLE_COUNT        ? cycles
          /* cycleMethod == INST_COUNT */   : 1;
 
-      // run clock cycle callback
-      if (Cycle)
-         for(int i = 0; i < instr.cycles; i++)
-            Cycle(this);
+      // run clock cycle callback and due events
+      Tick(elapsed);
+      if (cycleCount >= eventNext)
+      {
+         RunEvents(cycleCount);
+         STOP_RETURN();
+      }
+
+      TRAP_AFTER(opcode);
+      IDLE_AFTER(opcode);
    }
 }
 
+#endif
+
+#undef PROFILE_AFTER
+#undef PROFILE_FROM
+#undef STOP_RETURN
+#undef BREAK_CHECK
+#undef STOP_RESET
+#undef TRACE_AFTER
+#undef TRACE_BEFORE
+#undef IDLE_AFTER
+#undef TRAP_AFTER
+#undef JUMP_FROM
+#undef IDLE_RESET
+
 void mos6502::RunEternally()
 {
-   uint8_t opcode;
-   Instr instr;
+   uint64_t cycleCount = 0;
 
    while(!illegalOpcode)
    {
-      CheckInterrupts();
+      Run(INT32_MAX, cycleCount, INST_COUNT);
+   }
+}
 
-      // fetch
-      opcode = Read(pc++);
+#ifdef BUS_CONTEXT
+void* mos6502::GetContext()
+{
+   return busRead == &mos6502::ReadShim ? nullptr : readCtx;
+}
+#endif
+
+bool mos6502::IsHalted()
+{
+   return illegalOpcode;
+}
+
+void mos6502::SaveState(State& state)
+{
+   state.cycleStamp = cycleStamp;
+   state.pc = pc;
+   state.A = A;
+   state.X = X;
+   state.Y = Y;
+   state.sp = sp;
+   state.status = STATUS();
+   state.illegalOpcode = illegalOpcode;
+   state.irq_line = irq_line;
+   state.nmi_request = nmi_request;
+   state.nmi_inhibit = nmi_inhibit;
+   state.nmi_line = nmi_line;
+}
+
+void mos6502::LoadState(const State& state)
+{
+   cycleStamp = state.cycleStamp;
+   pc = state.pc;
+   A = state.A;
+   X = state.X;
+   Y = state.Y;
+   sp = state.sp;
+   SET_STATUS(state.status);
+   illegalOpcode = state.illegalOpcode;
+   irq_line = state.irq_line;
+   nmi_request = state.nmi_request;
+   nmi_inhibit = state.nmi_inhibit;
+   nmi_line = state.nmi_line;
+
+#ifdef IDLE_LOOPS
+   // the loop seen last is not the one we are in any more
+   idleArmed = false;
+#endif
+}
 
-      // decode
-      instr = InstrTable[opcode];
+uint64_t mos6502::GetCycleStamp()
+{
+   return cycleStamp;
+}
 
-      // execute
-      Exec(instr);
+#ifdef MEMORY_MAP
+// the RAM of the page table, the watched pages included
+#ifdef BREAKPOINTS
+#define RAM_PAGE(i) mapWrite[i]
+#else
+#define RAM_PAGE(i) writePage[i]
+#endif
 
-      // run clock cycle callback
-      if (Cycle)
-         for(int i = 0; i < instr.cycles; i++)
-            Cycle(this);
+int mos6502::SaveRAM(uint8_t* ram)
+{
+   int pages = 0;
+   for(int i = 0; i < 256; )
+   {
+      if (!RAM_PAGE(i))
+      {
+         i++;
+         continue;
+      }
+      int n = 1;
+      while(i + n < 256 && RAM_PAGE(i + n) == RAM_PAGE(i) + n * 256) n++;
+      memcpy(ram + i * 256, RAM_PAGE(i), n * 256);
+      pages += n;
+      i += n;
    }
+   return pages;
 }
 
-void mos6502::Exec(Instr i)
+int mos6502::LoadRAM(const uint8_t* ram)
 {
-   crossed = false;
-   branched = false;
-   uint16_t src = (this->*i.addr)();
-   (this->*i.code)(src);
+   int pages = 0;
+   for(int i = 0; i < 256; )
+   {
+      if (!RAM_PAGE(i))
+      {
+         i++;
+         continue;
+      }
+      int n = 1;
+      while(i + n < 256 && RAM_PAGE(i + n) == RAM_PAGE(i) + n * 256) n++;
+      memcpy(RAM_PAGE(i), ram + i * 256, n * 256);
+#ifdef BLOCK_CACHE
+      for(int j = i; j < i + n; j++) pageGen[j]++;
+#endif
+      pages += n;
+      i += n;
+   }
+#ifdef IDLE_LOOPS
+   idleArmed = false;
+#endif
+   return pages;
 }
 
+#undef RAM_PAGE
+#endif
+
 uint16_t mos6502::GetPC()
 {
    return pc;
@@ -1717,7 +2243,7 @@ uint8_t mos6502::GetS()
 
 uint8_t mos6502::GetP()
 {
-   return status;
+   return STATUS();
 }
 
 uint8_t mos6502::GetA()
@@ -1747,7 +2273,7 @@ void mos6502::SetS (uint8_t n)
 
 void mos6502::SetP (uint8_t n)
 {
-   status = n;
+   SET_STATUS(n);
 }
 
 void mos6502::SetA (uint8_t n)
@@ -1815,41 +2341,384 @@ uint8_t mos6502::GetResetY()
    return reset_Y;
 }
 
+#ifdef LAZY_FLAGS_STATS
+void mos6502::GetFlagStats(uint64_t& updates, uint64_t& reads)
+{
+   updates = nz_updates;
+   reads = nz_reads;
+}
+#endif
+
+#ifdef PERF_COUNTERS
+const mos6502::PerfCounters& mos6502::GetPerfCounters()
+{
+   return perf;
+}
+
+void mos6502::ClearPerfCounters()
+{
+   memset(&perf, 0, sizeof(perf));
+}
+#endif
+
+#ifdef BREAKPOINTS
+void mos6502::SetBreakpoint(uint16_t addr, bool on)
+{
+   uint64_t bit = (uint64_t)1 << (addr & 63);
+   if (on) breakBits[addr >> 6] |= bit;
+   else breakBits[addr >> 6] &= ~bit;
+#ifdef BLOCK_CACHE
+   // the blocks around it are decoded again, ending before it
+   pageGen[addr >> 8]++;
+#endif
+}
+
+void mos6502::SetWatchpoint(uint16_t addr, uint8_t flags)
+{
+   uint64_t bit = (uint64_t)1 << (addr & 63);
+   if (flags & WATCH_READ) readBits[addr >> 6] |= bit;
+   else readBits[addr >> 6] &= ~bit;
+   if (flags & WATCH_WRITE) writeBits[addr >> 6] |= bit;
+   else writeBits[addr >> 6] &= ~bit;
+
+   // the page is watched for whatever any of its 256 bits asks
+   uint8_t page = addr >> 8;
+   uint8_t watch = 0;
+   for(int i = page * 4; i < page * 4 + 4; i++)
+   {
+      if (readBits[i]) watch |= WATCH_READ;
+      if (writeBits[i]) watch |= WATCH_WRITE;
+   }
+   watchPages += (watch != 0) - (watchPage[page] != 0);
+   watchPage[page] = watch;
+#ifdef MEMORY_MAP
+   MapWatch(page);
+#endif
+}
+
+void mos6502::ClearBreakpoints()
+{
+   memset(breakBits, 0, sizeof(breakBits));
+   memset(readBits, 0, sizeof(readBits));
+   memset(writeBits, 0, sizeof(writeBits));
+   memset(untilBits, 0, sizeof(untilBits));
+   memset(watchPage, 0, sizeof(watchPage));
+   watchPages = 0;
+#ifdef MEMORY_MAP
+   for(int i = 0; i < 256; i++)
+   {
+      MapWatch(i);
+   }
+#endif
+#ifdef BLOCK_CACHE
+   FlushBlockCache();
+#endif
+}
+
+mos6502::StopReason mos6502::GetStopReason()
+{
+   return stopReason;
+}
+
+uint16_t mos6502::GetStopAddress()
+{
+   return stopAddr;
+}
+
+// the most cycles one step of Run() takes: an interrupt entry and the
+// longest instruction
+#define UNTIL_STEP_CYCLES 14
+
+mos6502::RunResult mos6502::RunUntil(const StopConditions& until, uint64_t& cycleCount)
+{
+   uint64_t start = cycleCount;
+   uint64_t deadline = until.cycles < UINT64_MAX - start ? start + until.cycles : UINT64_MAX;
+   uint64_t left = until.instructions;
+
+   for(int i = 0; i < until.pcCount; i++)
+   {
+      uint16_t addr = until.pcs[i];
+      if (!ADDR_BIT(breakBits, addr))
+      {
+         SetBreakpoint(addr, true);
+         untilBits[addr >> 6] |= (uint64_t)1 << (addr & 63);
+      }
+   }
+   stopBrk = until.brk;
+   stopTrap = until.trap;
+
+   for(;;)
+   {
+      if (illegalOpcode)
+      {
+         stopReason = STOP_JAM;
+         stopAddr = pc - 1;
+         break;
+      }
+      if (cycleCount >= deadline)
+      {
+         stopReason = STOP_CYCLES;
+         stopAddr = pc;
+         break;
+      }
+      if (left == 0)
+      {
+         stopReason = STOP_INSTRUCTIONS;
+         stopAddr = pc;
+         break;
+      }
+
+      // as many instructions as cannot go past the deadline, at least one
+      uint64_t n = (deadline - cycleCount) / UNTIL_STEP_CYCLES;
+      if (n == 0) n = 1;
+      if (n > left) n = left;
+      if (n > INT32_MAX) n = INT32_MAX;
+      Run((int32_t)n, cycleCount, INST_COUNT);
+      if (stopReason != STOP_NONE) break;
+      left -= n;
+   }
+
+   // a target that was a breakpoint already stops as a target too
+   if (stopReason == STOP_BREAKPOINT)
+   {
+      for(int i = 0; i < until.pcCount; i++)
+      {
+         if (until.pcs[i] == stopAddr) stopReason = STOP_TARGET;
+      }
+   }
+
+   // the call ran past the breakpoint it may have started on, whether
+   // it was checked or not
+   if (stopReason != STOP_BREAKPOINT && stopReason != STOP_TARGET && cycleCount != start)
+   {
+      breakResume = -1;
+   }
+
+   for(int i = 0; i < until.pcCount; i++)
+   {
+      uint16_t addr = until.pcs[i];
+      if (ADDR_BIT(untilBits, addr))
+      {
+         SetBreakpoint(addr, false);
+         untilBits[addr >> 6] &= ~((uint64_t)1 << (addr & 63));
+      }
+   }
+   stopBrk = false;
+   stopTrap = false;
+
+   RunResult result;
+   result.reason = stopReason;
+   result.cycles = cycleCount - start;
+   result.addr = stopAddr;
+   return result;
+}
+
+#undef UNTIL_STEP_CYCLES
+
+mos6502::RunResult mos6502::RunUntil(const StopConditions& until)
+{
+   uint64_t cycleCount = 0;
+   return RunUntil(until, cycleCount);
+}
+
+#ifdef MEMORY_MAP
+void mos6502::MapWatch(uint8_t page)
+{
+   readPage[page] = watchPage[page] & WATCH_READ ? nullptr : mapRead[page];
+   writePage[page] = watchPage[page] & WATCH_WRITE ? nullptr : mapWrite[page];
+}
+#endif
+
+// a breakpoint at pc: stop, unless this Run() started on it
+bool mos6502::Break()
+{
+   if (pc == breakResume)
+   {
+      breakResume = -1;
+      return false;
+   }
+   breakResume = pc;
+   stopReason = STOP_BREAKPOINT;
+   stopAddr = pc;
+   return true;
+}
+
+// the instruction goes on, Run() stops at the events right after it. The
+// first hit is the one reported
+void mos6502::Hit(StopReason reason, uint16_t addr)
+{
+   if (stopping) return;
+   stopping = true;
+   stopReason = reason;
+   stopAddr = addr;
+   eventNext = 0;
+}
+
+void mos6502::StopTaken()
+{
+   stopping = false;
+   eventNext = eventCount ? events[0].when : UINT64_MAX;
+}
+
+uint8_t mos6502::WatchRead(uint16_t addr, bool data)
+{
+   if (data && ADDR_BIT(readBits, addr)) Hit(STOP_READ, addr);
+#ifdef MEMORY_MAP
+   const uint8_t* page = mapRead[addr >> 8];
+   if (page) return page[addr & 0xFF];
+#endif
+   return ReadBus(addr);
+}
+
+void mos6502::WatchWrite(uint16_t addr, uint8_t value)
+{
+   if (ADDR_BIT(writeBits, addr)) Hit(STOP_WRITE, addr);
+#ifdef MEMORY_MAP
+   uint8_t* page = mapWrite[addr >> 8];
+   if (page)
+   {
+      page[addr & 0xFF] = value;
+      return;
+   }
+#endif
+   WriteBus(addr, value);
+}
+#endif
+
+#ifdef SUPERINSTRUCTIONS_STATS
+int mos6502::GetPairCount()
+{
+   return PAIR_COUNT;
+}
+
+void mos6502::GetPairStats(int index, const char*& name, uint64_t& runs)
+{
+   name = PairTable[index].name;
+   runs = pairRuns[index];
+}
+#endif
+
 void mos6502::Op_ILLEGAL(uint16_t src)
 {
    illegalOpcode = true;
 }
 
-void mos6502::Op_ADC(uint16_t src)
+// decimal mode ADC and SBC, see http://www.6502.org/tutorials/decimal_mode.html
+// Both return the result in the low byte and N V Z C, at their place in
+// the status register, in the high byte. N and V come from the result
+// before the final adjustment, Z from the binary result.
+static constexpr uint16_t DecimalAdc(uint8_t a, uint8_t m, bool carry)
 {
-   uint8_t m = Read(src);
-   unsigned int tmp = m + A + (IF_CARRY() ? 1 : 0);
+   unsigned int bin = a + m + carry;
+   int al = (a & 0xF) + (m & 0xF) + carry;
+   if (al >= 0xA) {
+      al = ((al + 6) & 0xF) + 0x10;
+   }
+   unsigned int tmp = (m & 0xF0) + (a & 0xF0) + al;
+   uint8_t flags = 0;
 
-   // N V Z computed *BEFORE* adjustment
-   SET_OVERFLOW(!((A ^ m) & 0x80) && ((A ^ tmp) & 0x80));
-   SET_NEGATIVE(tmp & 0x80);
-   SET_ZERO(!(tmp & 0xFF));
+   if (!((a ^ m) & 0x80) && ((a ^ tmp) & 0x80)) flags |= OVERFLOW;
+   if (tmp & 0x80) flags |= NEGATIVE;
+   if (!(bin & 0xFF)) flags |= ZERO;
 
-   if (IF_DECIMAL())
+   if (tmp >= 0xA0) tmp += 0x60;
+   if (tmp > 0xFF) flags |= CARRY;
+
+   return (flags << 8) | (tmp & 0xFF);
+}
+
+static constexpr uint16_t DecimalSbc(uint8_t a, uint8_t m, bool carry)
+{
+   int bin = a - m - !carry;
+   int al = (a & 0x0F) - (m & 0x0F) - !carry;
+   if (al < 0) {
+      al = ((al - 6) & 0x0F) - 0x10;
+   }
+   int tmp = (a & 0xF0) - (m & 0xF0) + al;
+   uint8_t flags = 0;
+
+   if ((a ^ m) & (a ^ tmp) & 0x80) flags |= OVERFLOW;
+   if (tmp & 0x80) flags |= NEGATIVE;
+   if (!(bin & 0xFF)) flags |= ZERO;
+
+   if (tmp < 0) tmp -= 0x60;
+   if (tmp >= 0) flags |= CARRY;
+
+   return (flags << 8) | (tmp & 0xFF);
+}
+
+#ifdef DECIMAL_TABLES
+// every decimal ADC and SBC precomputed by the compiler, indexed by
+// carry << 16 | A << 8 | M
+struct DecimalTable
+{
+   uint16_t result[0x20000];
+
+   constexpr DecimalTable(bool subtract) : result()
    {
-      // see http://www.6502.org/tutorials/decimal_mode.html
-      int AL = ((A & 0xF) + (m & 0xF) + (IF_CARRY() ? 1 : 0));
-      if (AL >= 0xA) {
-         AL = ((AL + 6) & 0xF) + 0x10;
+      for(int i = 0; i < 0x20000; i++)
+      {
+         result[i] = subtract ?
+            DecimalSbc((i >> 8) & 0xFF, i & 0xFF, i >> 16) :
+            DecimalAdc((i >> 8) & 0xFF, i & 0xFF, i >> 16);
       }
-      tmp = (m & 0xF0) + (A & 0xF0) + AL;
+   }
+};
+
+static constexpr DecimalTable DecimalAdcTable(false);
+static constexpr DecimalTable DecimalSbcTable(true);
+
+#define DECIMAL_ADC(a, m, c) (DecimalAdcTable.result[(c) << 16 | (a) << 8 | (m)])
+#define DECIMAL_SBC(a, m, c) (DecimalSbcTable.result[(c) << 16 | (a) << 8 | (m)])
+#else
+#define DECIMAL_ADC(a, m, c) DecimalAdc(a, m, c)
+#define DECIMAL_SBC(a, m, c) DecimalSbc(a, m, c)
+#endif
 
-      // N V recomputed
-      SET_OVERFLOW(!((A ^ m) & 0x80) && ((A ^ tmp) & 0x80));
-      SET_NEGATIVE(tmp & 0x80);
+// flags as returned by DecimalAdc() and DecimalSbc()
+#define SET_DECIMAL_FLAGS(f) \
+   (SET_NEGATIVE((f) & NEGATIVE), SET_OVERFLOW((f) & OVERFLOW), \
+    SET_ZERO((f) & ZERO), SET_CARRY((f) & CARRY))
 
-      if (tmp >= 0xA0) tmp += 0x60;
+// the adder behind ADC and RRA
+void mos6502::Adc(uint8_t m)
+{
+   if (IF_DECIMAL())
+   {
+      uint16_t r = DECIMAL_ADC(A, m, IF_CARRY());
+      SET_DECIMAL_FLAGS(r >> 8);
+      A = r & 0xFF;
+      return;
    }
 
-   // C computed *AFTER* adjustment
+   unsigned int tmp = m + A + (IF_CARRY() ? 1 : 0);
+   SET_OVERFLOW(!((A ^ m) & 0x80) && ((A ^ tmp) & 0x80));
+   SET_NZ(tmp & 0xFF);
    SET_CARRY(tmp > 0xFF);
    A = tmp & 0xFF;
-   return;
+}
+
+// the subtractor behind SBC and ISC
+void mos6502::Sbc(uint8_t m)
+{
+   if (IF_DECIMAL())
+   {
+      uint16_t r = DECIMAL_SBC(A, m, IF_CARRY());
+      SET_DECIMAL_FLAGS(r >> 8);
+      A = r & 0xFF;
+      return;
+   }
+
+   int tmp = A - m - (IF_CARRY() ? 0 : 1);
+   SET_OVERFLOW(((A ^ m) & (A ^ tmp) & 0x80) != 0);
+   SET_NZ(tmp & 0xFF);
+   SET_CARRY(tmp >= 0);
+   A = tmp & 0xFF;
+}
+
+void mos6502::Op_ADC(uint16_t src)
+{
+   Adc(Read(src));
 }
 
 
@@ -1858,8 +2727,7 @@ void mos6502::Op_AND(uint16_t src)
 {
    uint8_t m = Read(src);
    uint8_t res = m & A;
-   SET_NEGATIVE(res & 0x80);
-   SET_ZERO(!res);
+   SET_NZ(res);
    A = res;
    return;
 }
@@ -1871,8 +2739,7 @@ void mos6502::Op_ASL(uint16_t src)
    SET_CARRY(m & 0x80);
    m <<= 1;
    m &= 0xFF;
-   SET_NEGATIVE(m & 0x80);
-   SET_ZERO(!m);
+   SET_NZ(m);
    Write(src, m);
    return;
 }
@@ -1883,8 +2750,7 @@ void mos6502::Op_ASL_ACC(uint16_t src)
    SET_CARRY(m & 0x80);
    m <<= 1;
    m &= 0xFF;
-   SET_NEGATIVE(m & 0x80);
-   SET_ZERO(!m);
+   SET_NZ(m);
    A = m;
    return;
 }
@@ -1932,7 +2798,8 @@ void mos6502::Op_BIT(uint16_t src)
 {
    uint8_t m = Read(src);
    uint8_t res = m & A;
-   status = (status & 0x3F) | (uint8_t)(m & 0xC0);
+   SET_NEGATIVE(m & 0x80);
+   SET_OVERFLOW(m & 0x40);
    SET_ZERO(!res);
    return;
 }
@@ -1978,10 +2845,13 @@ void mos6502::Op_BPL(uint16_t src)
 
 void mos6502::Op_BRK(uint16_t src)
 {
+#ifdef BREAKPOINTS
+   if (stopBrk) Hit(STOP_BRK, pc - 1);
+#endif
    pc++;
    StackPush((pc >> 8) & 0xFF);
    StackPush(pc & 0xFF);
-   StackPush(status | CONSTANT | BREAK);
+   StackPush(STATUS() | CONSTANT | BREAK);
    SET_INTERRUPT(1);
    pc = (Read(irqVectorH) << 8) + Read(irqVectorL);
    return;
@@ -2041,8 +2911,7 @@ void mos6502::Op_CMP(uint16_t src)
 {
    unsigned int tmp = A - Read(src);
    SET_CARRY(tmp < 0x100);
-   SET_NEGATIVE(tmp & 0x80);
-   SET_ZERO(!(tmp & 0xFF));
+   SET_NZ(tmp & 0xFF);
    return;
 }
 
@@ -2050,8 +2919,7 @@ void mos6502::Op_CPX(uint16_t src)
 {
    unsigned int tmp = X - Read(src);
    SET_CARRY(tmp < 0x100);
-   SET_NEGATIVE(tmp & 0x80);
-   SET_ZERO(!(tmp & 0xFF));
+   SET_NZ(tmp & 0xFF);
    return;
 }
 
@@ -2059,8 +2927,7 @@ void mos6502::Op_CPY(uint16_t src)
 {
    unsigned int tmp = Y - Read(src);
    SET_CARRY(tmp < 0x100);
-   SET_NEGATIVE(tmp & 0x80);
-   SET_ZERO(!(tmp & 0xFF));
+   SET_NZ(tmp & 0xFF);
    return;
 }
 
@@ -2068,8 +2935,7 @@ void mos6502::Op_DEC(uint16_t src)
 {
    uint8_t m = Read(src);
    m = (m - 1) & 0xFF;
-   SET_NEGATIVE(m & 0x80);
-   SET_ZERO(!m);
+   SET_NZ(m);
    Write(src, m);
    return;
 }
@@ -2078,8 +2944,7 @@ void mos6502::Op_DEX(uint16_t src)
 {
    uint8_t m = X;
    m = (m - 1) & 0xFF;
-   SET_NEGATIVE(m & 0x80);
-   SET_ZERO(!m);
+   SET_NZ(m);
    X = m;
    return;
 }
@@ -2088,8 +2953,7 @@ void mos6502::Op_DEY(uint16_t src)
 {
    uint8_t m = Y;
    m = (m - 1) & 0xFF;
-   SET_NEGATIVE(m & 0x80);
-   SET_ZERO(!m);
+   SET_NZ(m);
    Y = m;
    return;
 }
@@ -2098,8 +2962,7 @@ void mos6502::Op_EOR(uint16_t src)
 {
    uint8_t m = Read(src);
    m = A ^ m;
-   SET_NEGATIVE(m & 0x80);
-   SET_ZERO(!m);
+   SET_NZ(m);
    A = m;
 }
 
@@ -2107,8 +2970,7 @@ void mos6502::Op_INC(uint16_t src)
 {
    uint8_t m = Read(src);
    m = (m + 1) & 0xFF;
-   SET_NEGATIVE(m & 0x80);
-   SET_ZERO(!m);
+   SET_NZ(m);
    Write(src, m);
 }
 
@@ -2116,8 +2978,7 @@ void mos6502::Op_INX(uint16_t src)
 {
    uint8_t m = X;
    m = (m + 1) & 0xFF;
-   SET_NEGATIVE(m & 0x80);
-   SET_ZERO(!m);
+   SET_NZ(m);
    X = m;
 }
 
@@ -2125,8 +2986,7 @@ void mos6502::Op_INY(uint16_t src)
 {
    uint8_t m = Y;
    m = (m + 1) & 0xFF;
-   SET_NEGATIVE(m & 0x80);
-   SET_ZERO(!m);
+   SET_NZ(m);
    Y = m;
 }
 
@@ -2144,32 +3004,32 @@ void mos6502::Op_JSR(uint16_t src)
    // this fixes an obscure problem that only happens when
    // the operand and the processor stack are at the same
    // place...
-   src = (src & 0xFF) | (Read(pc) << 8);
+   src = (src & 0xFF) | (ReadCode(pc) << 8);
 
+#ifdef PROFILE
+   if (profile) profile[src].calls++;
+#endif
    pc = src;
 }
 
 void mos6502::Op_LDA(uint16_t src)
 {
    uint8_t m = Read(src);
-   SET_NEGATIVE(m & 0x80);
-   SET_ZERO(!m);
+   SET_NZ(m);
    A = m;
 }
 
 void mos6502::Op_LDX(uint16_t src)
 {
    uint8_t m = Read(src);
-   SET_NEGATIVE(m & 0x80);
-   SET_ZERO(!m);
+   SET_NZ(m);
    X = m;
 }
 
 void mos6502::Op_LDY(uint16_t src)
 {
    uint8_t m = Read(src);
-   SET_NEGATIVE(m & 0x80);
-   SET_ZERO(!m);
+   SET_NZ(m);
    Y = m;
 }
 
@@ -2178,8 +3038,7 @@ void mos6502::Op_LSR(uint16_t src)
    uint8_t m = Read(src);
    SET_CARRY(m & 0x01);
    m >>= 1;
-   SET_NEGATIVE(0);
-   SET_ZERO(!m);
+   SET_NZ(m);
    Write(src, m);
 }
 
@@ -2188,8 +3047,7 @@ void mos6502::Op_LSR_ACC(uint16_t src)
    uint8_t m = A;
    SET_CARRY(m & 0x01);
    m >>= 1;
-   SET_NEGATIVE(0);
-   SET_ZERO(!m);
+   SET_NZ(m);
    A = m;
 }
 
@@ -2202,8 +3060,7 @@ void mos6502::Op_ORA(uint16_t src)
 {
    uint8_t m = Read(src);
    m = A | m;
-   SET_NEGATIVE(m & 0x80);
-   SET_ZERO(!m);
+   SET_NZ(m);
    A = m;
 }
 
@@ -2215,21 +3072,20 @@ void mos6502::Op_PHA(uint16_t src)
 
 void mos6502::Op_PHP(uint16_t src)
 {
-   StackPush(status | CONSTANT | BREAK);
+   StackPush(STATUS() | CONSTANT | BREAK);
    return;
 }
 
 void mos6502::Op_PLA(uint16_t src)
 {
    A = StackPop();
-   SET_NEGATIVE(A & 0x80);
-   SET_ZERO(!A);
+   SET_NZ(A);
    return;
 }
 
 void mos6502::Op_PLP(uint16_t src)
 {
-   status = (status & (CONSTANT | BREAK)) | (StackPop() & ~(CONSTANT | BREAK));
+   SET_STATUS((status & (CONSTANT | BREAK)) | (StackPop() & ~(CONSTANT | BREAK)));
    return;
 }
 
@@ -2240,8 +3096,7 @@ void mos6502::Op_ROL(uint16_t src)
    if (IF_CARRY()) m |= 0x01;
    SET_CARRY(m > 0xFF);
    m &= 0xFF;
-   SET_NEGATIVE(m & 0x80);
-   SET_ZERO(!m);
+   SET_NZ(m);
    Write(src, m);
    return;
 }
@@ -2253,8 +3108,7 @@ void mos6502::Op_ROL_ACC(uint16_t src)
    if (IF_CARRY()) m |= 0x01;
    SET_CARRY(m > 0xFF);
    m &= 0xFF;
-   SET_NEGATIVE(m & 0x80);
-   SET_ZERO(!m);
+   SET_NZ(m);
    A = m;
    return;
 }
@@ -2266,8 +3120,7 @@ void mos6502::Op_ROR(uint16_t src)
    SET_CARRY(m & 0x01);
    m >>= 1;
    m &= 0xFF;
-   SET_NEGATIVE(m & 0x80);
-   SET_ZERO(!m);
+   SET_NZ(m);
    Write(src, m);
    return;
 }
@@ -2279,8 +3132,7 @@ void mos6502::Op_ROR_ACC(uint16_t src)
    SET_CARRY(m & 0x01);
    m >>= 1;
    m &= 0xFF;
-   SET_NEGATIVE(m & 0x80);
-   SET_ZERO(!m);
+   SET_NZ(m);
    A = m;
    return;
 }
@@ -2289,7 +3141,7 @@ void mos6502::Op_RTI(uint16_t src)
 {
    uint8_t lo, hi;
 
-   status = (status & (CONSTANT | BREAK)) | (StackPop() & ~(CONSTANT | BREAK));
+   SET_STATUS((status & (CONSTANT | BREAK)) | (StackPop() & ~(CONSTANT | BREAK)));
 
    lo = StackPop();
    hi = StackPop();
@@ -2314,35 +3166,7 @@ void mos6502::Op_RTS(uint16_t src)
 
 void mos6502::Op_SBC(uint16_t src)
 {
-   uint8_t m   = Read(src);
-   int tmp     = A - m - (IF_CARRY() ? 0 : 1);
-
-   // N V Z computed *BEFORE* adjustment (binary semantics)
-   SET_OVERFLOW(((A ^ m) & (A ^ tmp) & 0x80) != 0);
-   SET_NEGATIVE(tmp & 0x80 );
-   SET_ZERO(!(tmp & 0xFF));
-
-   if (IF_DECIMAL())
-   {
-      // see http://www.6502.org/tutorials/decimal_mode.html
-      int AL = (A & 0x0F) - (m & 0x0F) - (IF_CARRY() ? 0 : 1);
-      if (AL < 0) {
-         AL = ((AL - 6) & 0x0F) - 0x10;
-      }
-      tmp = (A & 0xF0) - (m & 0xF0) + AL;
-
-      // N V recompute
-      SET_OVERFLOW(((A ^ m) & (A ^ tmp) & 0x80) != 0);
-      SET_NEGATIVE(tmp & 0x80 );
-
-      if (tmp < 0) tmp -= 0x60; // ???? huh ????
-   }
-
-   // C computed *AFTER* adjustment
-   SET_CARRY( tmp >= 0 );
-
-   A = tmp & 0xFF;
-   return;
+   Sbc(Read(src));
 }
 
 void mos6502::Op_SEC(uint16_t src)
@@ -2384,8 +3208,7 @@ void mos6502::Op_STY(uint16_t src)
 void mos6502::Op_TAX(uint16_t src)
 {
    uint8_t m = A;
-   SET_NEGATIVE(m & 0x80);
-   SET_ZERO(!m);
+   SET_NZ(m);
    X = m;
    return;
 }
@@ -2393,8 +3216,7 @@ void mos6502::Op_TAX(uint16_t src)
 void mos6502::Op_TAY(uint16_t src)
 {
    uint8_t m = A;
-   SET_NEGATIVE(m & 0x80);
-   SET_ZERO(!m);
+   SET_NZ(m);
    Y = m;
    return;
 }
@@ -2402,8 +3224,7 @@ void mos6502::Op_TAY(uint16_t src)
 void mos6502::Op_TSX(uint16_t src)
 {
    uint8_t m = sp;
-   SET_NEGATIVE(m & 0x80);
-   SET_ZERO(!m);
+   SET_NZ(m);
    X = m;
    return;
 }
@@ -2411,8 +3232,7 @@ void mos6502::Op_TSX(uint16_t src)
 void mos6502::Op_TXA(uint16_t src)
 {
    uint8_t m = X;
-   SET_NEGATIVE(m & 0x80);
-   SET_ZERO(!m);
+   SET_NZ(m);
    A = m;
    return;
 }
@@ -2426,8 +3246,7 @@ void mos6502::Op_TXS(uint16_t src)
 void mos6502::Op_TYA(uint16_t src)
 {
    uint8_t m = Y;
-   SET_NEGATIVE(m & 0x80);
-   SET_ZERO(!m);
+   SET_NZ(m);
    A = m;
    return;
 }
@@ -2440,8 +3259,7 @@ void mos6502::Op_ALR(uint16_t src)
    uint8_t res = m & A;
    SET_CARRY(res & 1);
    res >>= 1;
-   SET_NEGATIVE(res & 0x80);
-   SET_ZERO(!res);
+   SET_NZ(res);
    A = res;
    return;
 }
@@ -2451,8 +3269,7 @@ void mos6502::Op_ANC(uint16_t src)
    uint8_t m = Read(src);
    uint8_t res = m & A;
    SET_CARRY(res & 0x80);
-   SET_NEGATIVE(res & 0x80);
-   SET_ZERO(!res);
+   SET_NZ(res);
    A = res;
    return;
 }
@@ -2466,8 +3283,7 @@ void mos6502::Op_ANE(uint16_t src)
 
    uint8_t m = Read(src);
    uint8_t res = ((A | constant) & X & m);
-   SET_NEGATIVE(res & 0x80);
-   SET_ZERO(!res);
+   SET_NZ(res);
    A = res;
    return;
 }
@@ -2483,8 +3299,7 @@ void mos6502::Op_ARR(uint16_t src)
    }
    SET_CARRY((res >> 6) & 1);
    SET_OVERFLOW(((res >> 6) ^ (res >> 5)) & 1);
-   SET_NEGATIVE(res & 0x80);
-   SET_ZERO(!res);
+   SET_NZ(res);
 
    if (IF_DECIMAL())
    {
@@ -2512,8 +3327,7 @@ void mos6502::Op_DCP(uint16_t src)
 
    unsigned int tmp = A - m;
    SET_CARRY(tmp < 0x100);
-   SET_NEGATIVE(tmp & 0x80);
-   SET_ZERO(!(tmp & 0xFF));
+   SET_NZ(tmp & 0xFF);
    return;
 }
 
@@ -2526,34 +3340,7 @@ void mos6502::Op_ISC(uint16_t src)
    Write(src, m);
 
    // from here on is Op_SBC
-   int tmp     = A - m - (IF_CARRY() ? 0 : 1);
-
-   // N V Z computed *BEFORE* adjustment (binary semantics)
-   SET_OVERFLOW(((A ^ m) & (A ^ tmp) & 0x80) != 0);
-   SET_NEGATIVE(tmp & 0x80 );
-   SET_ZERO(!(tmp & 0xFF));
-
-   if (IF_DECIMAL())
-   {
-      // see http://www.6502.org/tutorials/decimal_mode.html
-      int AL = (A & 0x0F) - (m & 0x0F) - (IF_CARRY() ? 0 : 1);
-      if (AL < 0) {
-         AL = ((AL - 6) & 0x0F) - 0x10;
-      }
-      tmp = (A & 0xF0) - (m & 0xF0) + AL;
-
-      // N V recompute
-      SET_OVERFLOW(((A ^ m) & (A ^ tmp) & 0x80) != 0);
-      SET_NEGATIVE(tmp & 0x80 );
-
-      if (tmp < 0) tmp -= 0x60; // ???? huh ????
-   }
-
-   // C computed *AFTER* adjustment
-   SET_CARRY( tmp >= 0 );
-
-   A = tmp & 0xFF;
-   return;
+   Sbc(m);
 }
 
 void mos6502::Op_LAS(uint16_t src)
@@ -2561,16 +3348,14 @@ void mos6502::Op_LAS(uint16_t src)
    uint8_t tmp = Read(src);
    tmp &= sp;
    A = X = sp = tmp;
-   SET_NEGATIVE(tmp & 0x80);
-   SET_ZERO(tmp == 0);
+   SET_NZ(tmp);
    return;
 }
 
 void mos6502::Op_LAX(uint16_t src)
 {
    uint8_t m = Read(src);
-   SET_NEGATIVE(m & 0x80);
-   SET_ZERO(!m);
+   SET_NZ(m);
    A = X = m;
 }
 
@@ -2579,8 +3364,7 @@ void mos6502::Op_LXA(uint16_t src)
    uint8_t m = Read(src);
    A = (A | 0xee) & m;  // like ANE, unstable mystery constant
    X = A;
-   SET_NEGATIVE(A & 0x80);
-   SET_ZERO(!A);
+   SET_NZ(A);
 }
 
 void mos6502::Op_RLA(uint16_t src)
@@ -2594,8 +3378,7 @@ void mos6502::Op_RLA(uint16_t src)
 
    A &= m;
 
-   SET_NEGATIVE(A & 0x80);
-   SET_ZERO(!A);
+   SET_NZ(A);
 
    return;
 }
@@ -2611,35 +3394,8 @@ void mos6502::Op_RRA(uint16_t src)
    m &= 0xFF;
    Write(src, m);
 
-   // TODO FIX, the rest of this is just Op_ADC
-   // combine common code into a helper function
-   unsigned int tmp = m + A + (IF_CARRY() ? 1 : 0);
-
-   // N V Z computed *BEFORE* adjustment
-   SET_OVERFLOW(!((A ^ m) & 0x80) && ((A ^ tmp) & 0x80));
-   SET_NEGATIVE(tmp & 0x80);
-   SET_ZERO(!(tmp & 0xFF));
-
-   if (IF_DECIMAL())
-   {
-      // see http://www.6502.org/tutorials/decimal_mode.html
-      int AL = ((A & 0xF) + (m & 0xF) + (IF_CARRY() ? 1 : 0));
-      if (AL >= 0xA) {
-         AL = ((AL + 6) & 0xF) + 0x10;
-      }
-      tmp = (m & 0xF0) + (A & 0xF0) + AL;
-
-      // N V recomputed
-      SET_OVERFLOW(!((A ^ m) & 0x80) && ((A ^ tmp) & 0x80));
-      SET_NEGATIVE(tmp & 0x80);
-
-      if (tmp >= 0xA0) tmp += 0x60;
-   }
-
-   // C computed *AFTER* adjustment
-   SET_CARRY(tmp > 0xFF);
-   A = tmp & 0xFF;
-   return;
+   // from here on is Op_ADC
+   Adc(m);
 }
 
 void mos6502::Op_SAX(uint16_t src)
@@ -2691,8 +3447,7 @@ void mos6502::Op_SLO(uint16_t src)
 
    A |= m;
 
-   SET_NEGATIVE(A & 0x80);
-   SET_ZERO(!A);
+   SET_NZ(A);
    return;
 }
 
@@ -2705,8 +3460,7 @@ void mos6502::Op_SRE(uint16_t src)
 
    A ^= m;
 
-   SET_NEGATIVE(A & 0x80);
-   SET_ZERO(!A);
+   SET_NZ(A);
    return;
 }
 
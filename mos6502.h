@@ -10,8 +10,59 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#if defined(LAZY_FLAGS_STATS) && !defined(LAZY_FLAGS)
+#define LAZY_FLAGS
+#endif
+
+#if defined(SUPERINSTRUCTIONS_STATS) && !defined(SUPERINSTRUCTIONS)
+#define SUPERINSTRUCTIONS
+#endif
+
+#if (defined(JIT) || defined(SUPERINSTRUCTIONS)) && !defined(BLOCK_CACHE)
+#define BLOCK_CACHE
+#endif
+
+#ifdef BUS_HEADER
+#ifdef BUS_CONTEXT
+#error "BUS_HEADER and BUS_CONTEXT are two different buses, pick one"
+#endif
+// defines class mos6502_bus, with the Read(addr) and Write(addr, value)
+// methods the core calls inline instead of the bus callbacks
+#include BUS_HEADER
+#endif
+
+#ifndef EVENT_MAX
+#define EVENT_MAX 32          // events pending at the same time
+#endif
+
+#ifdef BLOCK_CACHE
+#ifndef BLOCK_CACHE_SIZE
+#define BLOCK_CACHE_SIZE 1024 // decoded blocks, must be a power of two
+#endif
+#ifndef BLOCK_MAX_INSTR
+#define BLOCK_MAX_INSTR 16    // instructions per block
+#endif
+#endif
+
+#ifdef JIT
+#ifndef JIT_THRESHOLD
+#define JIT_THRESHOLD 32      // runs of a block before it is translated
+#endif
+#ifndef JIT_CODE_SIZE
+#define JIT_CODE_SIZE (1 << 20) // bytes of host code
+#endif
+#endif
+
 class mos6502
 {
+   // runs the opcodes its lane kernels do not cover through StepTable
+   friend class mos6502_lanes;
+   // copies the page table of the parent when forking
+   friend class mos6502_cow;
+   // maps the RAM read-only after each snapshot, to save pages on their
+   // first write
+   friend class mos6502_rewind;
+
    private:
       // register reset values
       uint8_t reset_A;
@@ -34,6 +85,17 @@ class mos6502
       // status register
       uint8_t status;
 
+#ifdef LAZY_FLAGS
+      // N and Z evaluated on demand, see SET_NZ()
+      uint8_t flag_n;
+      uint8_t flag_z;
+#endif
+
+#ifdef LAZY_FLAGS_STATS
+      uint64_t nz_updates;
+      uint64_t nz_reads;
+#endif
+
       typedef void (mos6502::*CodeExec)(uint16_t);
       typedef uint16_t (mos6502::*AddrExec)();
 
@@ -45,11 +107,20 @@ class mos6502
          const char * scode;
          uint8_t cycles;
          bool penalty;
+         uint8_t bytes;
       };
 
       static Instr InstrTable[256];
 
-      void Exec(Instr i);
+      // fused handlers, one instantiation per opcode of mos6502_opcodes.h:
+      // addressing mode, operation and cycle cost inlined into a single
+      // function returning the cycles taken (penalties included)
+      template<uint8_t OP> uint8_t Step();
+      template<AddrExec ADDR, CodeExec CODE, uint8_t CYCLES, bool PENALTY>
+      inline uint8_t Fused();
+
+      typedef uint8_t (mos6502::*StepExec)();
+      static const StepExec StepTable[256];
 
       bool illegalOpcode;
 
@@ -171,6 +242,10 @@ class mos6502
 
       void Op_ILLEGAL(uint16_t src);
 
+      // ADC/SBC arithmetic, shared with RRA/ISC
+      inline void Adc(uint8_t m);
+      inline void Sbc(uint8_t m);
+
       void Svc_NMI();
       void Svc_IRQ();
 
@@ -185,10 +260,197 @@ class mos6502
       // read/write/clock-cycle callbacks
       typedef void (*BusWrite)(uint16_t, uint8_t);
       typedef uint8_t (*BusRead)(uint16_t);
+#ifdef BUS_CONTEXT
+      // the same, given the context passed to the constructor
+      typedef void (*BusWriteCtx)(void* ctx, uint16_t, uint8_t);
+      typedef uint8_t (*BusReadCtx)(void* ctx, uint16_t);
+#endif
       typedef void (*ClockCycle)(mos6502*);
-      BusRead Read;
-      BusWrite Write;
-      ClockCycle Cycle;
+      // n cycles have elapsed, stamp is the cycle count after them
+      typedef void (*ClockCycles)(mos6502*, uint32_t n, uint64_t stamp);
+      // an event scheduled at cycle when, run at cycle now (when <= now)
+      typedef void (*EventCallback)(mos6502*, void* ctx, uint64_t when, uint64_t now);
+#if defined(BUS_HEADER)
+      mos6502_bus* bus;
+#elif defined(BUS_CONTEXT)
+      BusReadCtx busRead;
+      BusWriteCtx busWrite;
+      void* readCtx;           // the function itself for BusRead callers
+      void* writeCtx;          // the same for BusWrite
+#else
+      BusRead busRead;
+      BusWrite busWrite;
+#endif
+      ClockCycles Cycles;
+      ClockCycle Cycle;        // per-cycle callback run by CycleShim()
+      uint64_t cycleStamp;     // cycles reported to Cycles so far
+
+      static void CycleShim(mos6502* cpu, uint32_t n, uint64_t stamp);
+
+#ifdef BUS_CONTEXT
+      // the context-free callbacks on top of the context ones
+      static uint8_t ReadShim(void* ctx, uint16_t addr);
+      static void WriteShim(void* ctx, uint16_t addr, uint8_t value);
+#endif
+
+      // report n elapsed cycles to the clock cycle callback, if any
+      inline void Tick(uint32_t n);
+
+      // pending events, a binary min-heap ordered by time, then by id so
+      // that events due at the same cycle run in the order they were set
+      struct Event
+      {
+         uint64_t when;
+         EventCallback callback;
+         void* ctx;
+         int32_t id;
+      };
+      Event events[EVENT_MAX];
+      int eventCount;
+      int32_t eventSerial;
+      uint64_t eventNext;      // when of events[0], UINT64_MAX if none
+
+      // run every event due at cycle now, Run() calls it between
+      // instructions as soon as cycleCount reaches eventNext
+      void RunEvents(uint64_t now);
+      void RemoveEvent(int i);
+
+#ifdef MEMORY_MAP
+      // host memory behind each page, see MapRAM() and MapROM(). A null
+      // entry sends the access to busRead/busWrite
+      const uint8_t* readPage[256];
+      uint8_t* writePage[256];
+
+      // remap pages first..last, dropping blocks decoded from them
+      void MapPages(uint8_t first, uint8_t last,
+            const uint8_t* read, uint8_t* write);
+      // remap one page, keeping its blocks. The friends rewriting the
+      // page table go through it, so that the watched pages stay watched
+      void SetPage(uint8_t page, const uint8_t* read, uint8_t* write);
+      // every page read from read[page] and written through the bus, in
+      // one pass, keeping the blocks. Forks map the shared pages with it
+      void SetReadPages(const uint8_t* const* read);
+#endif
+
+      // every memory access of the core goes through these
+      inline uint8_t Read(uint16_t addr);
+      inline void Write(uint16_t addr, uint8_t value);
+      // the accesses the page table does not serve
+      inline uint8_t ReadBus(uint16_t addr);
+      inline void WriteBus(uint16_t addr, uint8_t value);
+      // opcodes and address operands: Read(), but never watched
+      inline uint8_t ReadCode(uint16_t addr);
+
+      // operand fetch: Read(pc++), unless the block cache has the bytes
+      inline uint8_t Fetch();
+
+#ifdef BLOCK_CACHE
+      // straight-line code decoded once, up to the first instruction that
+      // may not fall through, and reused until a write hits one of the (at
+      // most two) pages it was decoded from
+      struct BlockInstr
+      {
+         StepExec step;
+         uint8_t cycles;   // base cost
+         uint8_t offset;   // of the opcode in bytes[]
+#ifdef SUPERINSTRUCTIONS
+         StepExec pair;    // this and the next instruction fused, or nullptr
+         uint8_t pairIndex;
+#endif
+      };
+
+#ifdef JIT
+      // translated block: runs the block from its first instruction, adds
+      // the cycles taken to the counter and returns the number of
+      // instructions executed
+      typedef uint32_t (*JitCode)(mos6502*, uint64_t*);
+#endif
+
+      struct Block
+      {
+         uint16_t start;
+         uint8_t count;    // 0 for an empty slot
+         uint8_t cycles;   // static cost, sum of the base costs
+         uint8_t page[2];
+         uint32_t gen[2];
+         BlockInstr instr[BLOCK_MAX_INSTR];
+         uint8_t bytes[BLOCK_MAX_INSTR * 3];
+#ifdef JIT
+         uint16_t hits;
+         JitCode code;
+#endif
+      };
+
+      Block* blocks;
+      uint32_t pageGen[256];   // bumped by every write to the page
+      uint32_t flushes;        // bumped by FlushBlockCache()
+      const uint8_t* fetch;    // next operand byte of the running block
+
+      Block* FindBlock(uint16_t addr);
+      void DecodeBlock(Block* b, uint16_t addr);
+#endif
+
+#ifdef SUPERINSTRUCTIONS
+      // pairs of mos6502_pairs.h found at decode time and run by a single
+      // handler: both Step<> bodies inlined into one function
+      template<uint8_t FIRST, uint8_t SECOND> uint8_t Pair();
+
+      enum
+      {
+#define MAKE_PAIR(FIRST, SECOND, NAME) PAIR_ ## FIRST ## _ ## SECOND,
+#include "mos6502_pairs.h"
+#undef MAKE_PAIR
+         PAIR_COUNT
+      };
+
+      struct PairInfo
+      {
+         uint8_t first;
+         uint8_t second;
+         StepExec step;
+         const char* name;
+      };
+      static const PairInfo PairTable[PAIR_COUNT];
+
+      bool pairSplit;          // the last pair only ran its first half
+#endif
+
+#ifdef SUPERINSTRUCTIONS_STATS
+      uint64_t pairRuns[PAIR_COUNT];
+#endif
+
+#ifdef JIT
+      // x86-64 translation of hot blocks. Simple register-only opcodes are
+      // emitted inline with A, X, Y, S and P held in host registers, every
+      // other opcode becomes a call to its Step<> handler
+      typedef uint8_t (*JitCall)(mos6502*);
+      template<uint8_t OP> static uint8_t JitThunk(mos6502* cpu);
+      static const JitCall JitThunkTable[256];
+
+      uint8_t* jitCode;        // executable buffer
+      uint32_t jitUsed;
+      uint64_t jitBlocks;      // translations, again after a full buffer
+      bool jitEnabled;
+
+      JitCode JitTranslate(Block* b);
+#endif
+
+#ifdef IDLE_LOOPS
+      // state at the head of the last loop seen, see IdleCheck()
+      bool idleSafe[256];      // pages declared by SetIdleSafe()
+      bool idleArmed;
+      bool idleClean;          // no write nor unsafe read since armed
+      uint16_t idleHead;
+      uint8_t idleA;
+      uint8_t idleX;
+      uint8_t idleY;
+      uint8_t idleS;
+      uint8_t idleP;
+      int32_t idleRemaining;
+      uint64_t idleCycles;
+
+      void IdleCheck(int32_t& cyclesRemaining, uint64_t& cycleCount);
+#endif
 
       // stack operations
       inline void StackPush(uint8_t byte);
@@ -199,7 +461,24 @@ class mos6502
          INST_COUNT,
          CYCLE_COUNT,
       };
+#ifdef BUS_HEADER
+      // every access goes straight to bus, which must outlive the CPU
+      mos6502(mos6502_bus* bus, ClockCycles c = nullptr);
+#else
       mos6502(BusRead r, BusWrite w, ClockCycle c = nullptr);
+      mos6502(BusRead r, BusWrite w, ClockCycles c);
+#endif
+#ifdef BUS_CONTEXT
+      // the bus callbacks get ctx back as their first argument, so that
+      // each CPU can have its own machine without any global state. The
+      // constructors above still work, through one more call per access
+      mos6502(BusReadCtx r, BusWriteCtx w, void* ctx, ClockCycles c = nullptr);
+#endif
+#ifdef BLOCK_CACHE
+      ~mos6502();
+      mos6502(const mos6502&) = delete;
+      mos6502& operator=(const mos6502&) = delete;
+#endif
 
       // set or clear the NMI line.  this is an input to the processor.
       // a high to low edge transition will trigger an interrupt.
@@ -212,6 +491,61 @@ class mos6502
       void IRQ(bool line);
 
       void Reset();
+
+#ifdef BLOCK_CACHE
+      // drop every decoded block. Call it after changing code behind the
+      // back of the CPU (loading a program, switching banks...), Reset()
+      // does it too
+      void FlushBlockCache();
+#endif
+
+#ifdef MEMORY_MAP
+      // back pages first..last with host memory, mem holds 256 bytes per
+      // page. The core reads and writes RAM pages directly. ROM pages are
+      // read directly, writes to them still go to the bus write callback,
+      // which may drop them or treat them as bank switch registers.
+      // MapIO() gives pages back to the callbacks, which serve every page
+      // by default. Pages may be remapped at any time, even from a bus
+      // callback
+      void MapRAM(uint8_t first, uint8_t last, uint8_t* mem);
+      void MapROM(uint8_t first, uint8_t last, const uint8_t* mem);
+      void MapIO(uint8_t first, uint8_t last);
+#endif
+
+#ifdef IDLE_LOOPS
+      // declare pages first..last idle-safe: reading them has no side
+      // effects and their contents only change through CPU writes or
+      // between calls to Run(). A loop that only reads idle-safe pages and
+      // comes back to the same state is fast-forwarded to the end of the
+      // budget. No page is idle-safe by default, except the RAM and ROM
+      // pages of MEMORY_MAP
+      void SetIdleSafe(uint8_t first, uint8_t last, bool safe);
+#endif
+
+#ifdef SUPERINSTRUCTIONS_STATS
+      // fused pairs known to the core: name (e.g. "DEX BNE") and how many
+      // times the pair ran as one handler
+      int GetPairCount();
+      void GetPairStats(int index, const char*& name, uint64_t& runs);
+#endif
+
+#ifdef JIT
+      // turn the translation of hot blocks on or off (on by default); with
+      // the JIT off the core is the BLOCK_CACHE interpreter
+      void EnableJit(bool enable);
+
+      // blocks translated so far, counting again those translated anew
+      // after the code buffer filled up and was thrown away
+      uint64_t GetJitBlocks();
+#endif
+
+      // call callback(cpu, ctx, when, now) between the two instructions
+      // where the cycleCount passed to Run() reaches when. Returns an id
+      // for CancelEvent(), or -1 if EVENT_MAX events are already pending.
+      // Callbacks may schedule and cancel events themselves
+      int32_t ScheduleEvent(uint64_t when, EventCallback callback, void* ctx = nullptr);
+      bool CancelEvent(int32_t id);
+
       void Run(
             int32_t cycles,
             uint64_t& cycleCount,
@@ -219,10 +553,56 @@ class mos6502
       void RunEternally(); // until it encounters a illegal opcode
                            // useful when running e.g. WOZ Monitor
                            // no need to worry about cycle exhaus-
-                           // tion
+                           // tion. Event times count from 0 at
+                           // the call
 
       // Various getter/setters
 
+#ifdef BUS_CONTEXT
+      // the ctx given to the constructor, nullptr for BusRead/BusWrite
+      // callbacks. Handy in the clock cycle and event callbacks
+      void* GetContext();
+#endif
+
+      // Run() stopped on an illegal opcode, until the next Reset()
+      bool IsHalted();
+
+      // everything the core needs to carry on from where it was: the
+      // registers, the interrupt lines and requests, the halt. Plain data,
+      // copy it around freely. The reset values, the bus, the memory map
+      // and the pending events are not part of it
+      struct State
+      {
+         uint64_t cycleStamp;  // as last passed to the ClockCycles callback
+         uint16_t pc;
+         uint8_t A;
+         uint8_t X;
+         uint8_t Y;
+         uint8_t sp;
+         uint8_t status;
+         bool illegalOpcode;
+         bool irq_line;
+         bool nmi_request;
+         bool nmi_inhibit;
+         bool nmi_line;
+      };
+
+      void SaveState(State& state);
+      // memory is not touched, so the decoded blocks are kept
+      void LoadState(const State& state);
+      // State::cycleStamp alone, without the copy
+      uint64_t GetCycleStamp();
+
+#ifdef MEMORY_MAP
+      // copy the RAM pages of the page table to ram, or back from it, page
+      // p at ram + p * 256 (64K in all, the other pages are left alone).
+      // Pages mapped back to back in host memory go in one memcpy().
+      // LoadRAM() drops the blocks decoded from the pages. Both return the
+      // number of pages copied
+      int SaveRAM(uint8_t* ram);
+      int LoadRAM(const uint8_t* ram);
+#endif
+
       uint16_t GetPC();
       uint8_t GetS();
       uint8_t GetP();
@@ -248,4 +628,203 @@ class mos6502
       uint8_t GetResetA();
       uint8_t GetResetX();
       uint8_t GetResetY();
+
+#ifdef LAZY_FLAGS_STATS
+      // N/Z flag updates recorded and N/Z flag evaluations done so far;
+      // every update beyond the evaluations is a status write avoided
+      void GetFlagStats(uint64_t& updates, uint64_t& reads);
+#endif
+
+#ifdef BREAKPOINTS
+      enum StopReason {
+         STOP_NONE,            // Run() used its budget, or halted
+         STOP_BREAKPOINT,      // before the instruction at the address
+         STOP_READ,            // after the instruction reading the address
+         STOP_WRITE,           // after the instruction writing the address
+         STOP_TARGET,          // RunUntil(): before the instruction at a target
+         STOP_CYCLES,          // RunUntil(): the cycles run, stopped at pc
+         STOP_INSTRUCTIONS,    // RunUntil(): the instructions run, stopped at pc
+         STOP_BRK,             // RunUntil(): after the BRK at the address
+         STOP_TRAP,            // RunUntil(): after the jump to itself at the address
+         STOP_JAM,             // RunUntil(): halted on the opcode at the address
+      };
+
+      enum WatchFlags {
+         WATCH_READ = 1,
+         WATCH_WRITE = 2,
+      };
+
+      // Run() stops before the instruction at addr, with cycleCount up to
+      // it. The next Run() starting there runs the instruction
+      void SetBreakpoint(uint16_t addr, bool on);
+      // Run() stops after the instruction reading or writing addr (flags
+      // of WatchFlags, 0 removes it), with cycleCount including it. The
+      // pages with a watchpoint leave the page table, the others keep
+      // their speed. The fetches of opcodes and address operands are not
+      // watched, and the JIT is off while any watchpoint is set
+      void SetWatchpoint(uint16_t addr, uint8_t flags);
+      void ClearBreakpoints();   // and the watchpoints
+
+      // why the last Run() returned, and the address it stopped on
+      StopReason GetStopReason();
+      uint16_t GetStopAddress();
+
+      // what RunUntil() stops on besides the breakpoints, the watchpoints
+      // and a halt; each one is off at its default
+      struct StopConditions
+      {
+         const uint16_t* pcs = nullptr;        // before an instruction at
+         int pcCount = 0;                      // any of these
+         uint64_t cycles = UINT64_MAX;         // at least this many run
+         uint64_t instructions = UINT64_MAX;   // exactly this many run
+         bool brk = false;                     // after a BRK
+         bool trap = false;                    // after a jump or branch to itself
+      };
+
+      struct RunResult
+      {
+         StopReason reason;
+         uint64_t cycles;      // run by the call, interrupt entries included
+         uint16_t addr;        // as GetStopAddress()
+      };
+
+      // Run() until one of the conditions. The targets are breakpoints
+      // for the call, the budgets are run in slices that cannot go past
+      // them, and BRK and the traps cost a test in BRK and after the
+      // jumps only. cycleCount goes on as in Run(), or from 0 without it
+      RunResult RunUntil(const StopConditions& until, uint64_t& cycleCount);
+      RunResult RunUntil(const StopConditions& until);
+#endif
+
+#ifdef PERF_COUNTERS
+      // addressing modes, the index of PerfCounters::modes
+      enum AddrMode {
+         MODE_ACC, MODE_IMM, MODE_ABS, MODE_ZER, MODE_ZEX, MODE_ZEY,
+         MODE_ABX, MODE_ABY, MODE_IMP, MODE_REL, MODE_INX, MODE_INY,
+         MODE_ABI, MODE_COUNT,
+      };
+
+      // what ran since the last ClearPerfCounters()
+      struct PerfCounters
+      {
+         uint64_t instructions;        // retired
+         uint64_t cycles;              // they took, penalties included
+         uint64_t opcodes[256];        // instructions by opcode
+         uint64_t modes[MODE_COUNT];   // instructions by addressing mode
+         uint64_t crossings;           // penalty cycles for page crossings
+         uint64_t branchesTaken;
+         uint64_t branchesNotTaken;
+         uint64_t irqs;                // serviced, their entry cycles are
+         uint64_t nmis;                // not in cycles
+         uint64_t pushes;              // stack bytes, interrupts included
+         uint64_t pops;
+      };
+
+      // kept by the opcode handlers on every engine. The JIT calls the
+      // handler of every opcode instead of translating some inline, and
+      // idle loops are not fast-forwarded
+      const PerfCounters& GetPerfCounters();
+      void ClearPerfCounters();
+#endif
+
+#ifdef PROFILE
+      // what ran from one address
+      struct ProfileEntry
+      {
+         uint64_t count;       // instructions
+         uint64_t cycles;      // they took, penalties included
+         uint64_t penalty;     // of those, for taken branches and page crossings
+         uint64_t calls;       // JSRs to the address
+      };
+
+      // add every instruction run to profile[pc], 65536 entries the caller
+      // clears and keeps; nullptr stops. The JIT, the fused pairs and the
+      // idle loop skipping stay off while profiling. Interrupt entry
+      // cycles are not charged to any address
+      void SetProfile(ProfileEntry* profile);
+#endif
+
+#ifdef TRACE
+      // one instruction run, 24 bytes
+      struct TraceRecord
+      {
+         uint64_t cycle;       // cycleCount when it started
+         uint16_t pc;
+         uint16_t addr;        // effective address, the target of a branch
+         uint8_t opcode;
+         uint8_t operand[2];   // as fetched, the value of an immediate
+         uint8_t data;         // last byte read or written, 0 if none
+         uint8_t A;            // the registers before it ran
+         uint8_t X;
+         uint8_t Y;
+         uint8_t P;
+         uint8_t S;
+         uint8_t cycles;       // taken, penalties included
+         uint8_t reserved[2];
+      };
+
+      // gets a full buffer of count records, returns the next one to fill
+      typedef TraceRecord* (*TraceFlush)(void* ctx, TraceRecord* full, uint32_t count);
+
+      // record every instruction into buffer, size records long, then
+      // into the ones flush gives back; a null buffer stops the trace.
+      // The JIT, the fused pairs and the idle loop skipping stay off while
+      // tracing, so that no instruction is left out
+      void SetTrace(TraceRecord* buffer, uint32_t size, TraceFlush flush, void* ctx = nullptr);
+      // hands the records so far to flush, if any
+      void FlushTrace();
+#endif
+
+#if defined(BREAKPOINTS) || defined(PERF_COUNTERS) || defined(PROFILE) || defined(TRACE)
+   private:
+#endif
+#ifdef BREAKPOINTS
+      uint64_t breakBits[1024];   // one bit per address
+      uint64_t readBits[1024];
+      uint64_t writeBits[1024];
+      uint64_t untilBits[1024];   // the targets RunUntil() added to breakBits
+      uint8_t watchPage[256];     // WatchFlags of the addresses of the page
+      int watchPages;             // with any flag
+#ifdef MEMORY_MAP
+      // the page table as mapped, readPage and writePage leave the
+      // watched pages to the bus path
+      const uint8_t* mapRead[256];
+      uint8_t* mapWrite[256];
+      void MapWatch(uint8_t page);
+#endif
+      int32_t breakResume;        // the breakpoint Run() may run, or -1
+      bool stopping;              // a watchpoint hit, eventNext is 0
+      bool stopBrk;               // the StopConditions of RunUntil()
+      bool stopTrap;
+      StopReason stopReason;
+      uint16_t stopAddr;
+
+      bool Break();
+      void Hit(StopReason reason, uint16_t addr);
+      void StopTaken();
+      uint8_t WatchRead(uint16_t addr, bool data);
+      void WatchWrite(uint16_t addr, uint8_t value);
+#endif
+#ifdef PERF_COUNTERS
+      PerfCounters perf;
+#endif
+#ifdef PROFILE
+      ProfileEntry* profile;   // nullptr when off
+#endif
+#ifdef TRACE
+      // filled in by the running instruction whether tracing or not, so
+      // that Read(), Write() and Fetch() store without a test
+      uint16_t traceAddr;      // from its addressing mode
+      uint16_t traceOperand;   // fetched bytes, the last one lowest
+      uint8_t traceData;       // last byte read or written
+
+      TraceRecord* trace;      // buffer being filled, nullptr when off
+      uint32_t traceUsed;
+      uint32_t traceSize;
+      TraceFlush traceFlush;
+      void* traceCtx;
+
+      inline void TraceBefore(uint8_t opcode, uint64_t cycleCount);
+      inline void TraceAfter(uint8_t elapsed);
+#endif
 };
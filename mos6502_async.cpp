@@ -0,0 +1,118 @@
+#include "mos6502_async.h"
+
+mos6502_async::mos6502_async(
+      mos6502* cpu,
+      int32_t quantum,
+      mos6502::CycleMethod cycleMethod,
+      uint32_t size)
+{
+   this->cpu = cpu;
+   this->quantum = quantum > 0 ? quantum : 1;
+   this->cycleMethod = cycleMethod;
+
+   // a power of two, so that the indexes wrap with a mask
+   uint32_t n = 1;
+   while(n < size)
+   {
+      n <<= 1;
+   }
+   commands = new uint8_t[n];
+   mask = n - 1;
+   head = 0;
+   tail = 0;
+   cycles = 0;
+   running = false;
+}
+
+mos6502_async::~mos6502_async()
+{
+   while(running && !Stop())
+   {
+      std::this_thread::yield();
+   }
+   Join();
+   delete[] commands;
+}
+
+bool mos6502_async::Start(uint64_t cycleCount)
+{
+   if (running) return false;
+   Join();
+   cycles = cycleCount;
+   running = true;
+   thread = std::thread(&mos6502_async::Loop, this, cycleCount);
+   return true;
+}
+
+bool mos6502_async::IRQ(bool line)
+{
+   return Push(line ? CMD_IRQ_HIGH : CMD_IRQ_LOW);
+}
+
+bool mos6502_async::NMI(bool line)
+{
+   return Push(line ? CMD_NMI_HIGH : CMD_NMI_LOW);
+}
+
+bool mos6502_async::Stop()
+{
+   return Push(CMD_STOP);
+}
+
+void mos6502_async::Join()
+{
+   if (thread.joinable()) thread.join();
+}
+
+bool mos6502_async::IsRunning()
+{
+   return running;
+}
+
+uint64_t mos6502_async::GetCycles()
+{
+   return cycles.load(std::memory_order_acquire);
+}
+
+// on the producer thread: the command is written before head moves past it
+bool mos6502_async::Push(uint8_t command)
+{
+   uint32_t h = head.load(std::memory_order_relaxed);
+   if (h - tail.load(std::memory_order_acquire) > mask) return false;
+   commands[h & mask] = command;
+   head.store(h + 1, std::memory_order_release);
+   return true;
+}
+
+// on the CPU thread, between two quanta: everything queued so far, up to
+// a stop. false on the stop
+bool mos6502_async::Drain()
+{
+   uint32_t t = tail.load(std::memory_order_relaxed);
+   uint32_t h = head.load(std::memory_order_acquire);
+   bool go = true;
+   while(t != h && go)
+   {
+      switch(commands[t & mask])
+      {
+         case CMD_IRQ_LOW:  cpu->IRQ(false); break;
+         case CMD_IRQ_HIGH: cpu->IRQ(true); break;
+         case CMD_NMI_LOW:  cpu->NMI(false); break;
+         case CMD_NMI_HIGH: cpu->NMI(true); break;
+         case CMD_STOP:     go = false; break;
+      }
+      t++;
+   }
+   tail.store(t, std::memory_order_release);
+   return go;
+}
+
+void mos6502_async::Loop(uint64_t cycleCount)
+{
+   while(Drain() && !cpu->IsHalted())
+   {
+      cpu->Run(quantum, cycleCount, cycleMethod);
+      cycles.store(cycleCount, std::memory_order_release);
+   }
+   running = false;
+}
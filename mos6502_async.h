@@ -0,0 +1,76 @@
+//============================================================================
+// Name        : mos6502_async
+// Description : Runs a mos6502 on a thread of its own, driven from another
+//               thread through a lock-free command queue
+//============================================================================
+
+#pragma once
+#include "mos6502.h"
+
+#include <stdint.h>
+#include <atomic>
+#include <thread>
+
+class mos6502_async
+{
+   public:
+      // cpu runs on a thread of its own from Start() to a stop or a halt,
+      // in quanta of quantum cycles or instructions, and takes the
+      // commands queued since between two quanta. The queue holds size
+      // commands, rounded up to a power of two
+      mos6502_async(
+            mos6502* cpu,
+            int32_t quantum = 1000,
+            mos6502::CycleMethod cycleMethod = mos6502::CYCLE_COUNT,
+            uint32_t size = 256);
+      ~mos6502_async();   // stops the thread and waits for it
+      mos6502_async(const mos6502_async&) = delete;
+      mos6502_async& operator=(const mos6502_async&) = delete;
+
+      // starts the thread with cycleCount as the Run() count, false if it
+      // is running. Nothing else may touch the CPU until it has ended
+      bool Start(uint64_t cycleCount = 0);
+
+      // from one thread at a time: queue a change of the lines as IRQ()
+      // and NMI() of the CPU take it, or a stop after the commands before
+      // it. Never blocks, false when the queue is full. Commands left
+      // when the thread ends wait for the next Start()
+      bool IRQ(bool line);
+      bool NMI(bool line);
+      bool Stop();
+
+      // waits for the thread to end, on a stop or a halt
+      void Join();
+      bool IsRunning();
+
+      // the Run() count as of the last quantum, final once it has ended
+      uint64_t GetCycles();
+
+   private:
+      enum Command {
+         CMD_IRQ_LOW,
+         CMD_IRQ_HIGH,
+         CMD_NMI_LOW,
+         CMD_NMI_HIGH,
+         CMD_STOP,
+      };
+
+      mos6502* cpu;
+      int32_t quantum;
+      mos6502::CycleMethod cycleMethod;
+
+      // single producer, single consumer: head is written by the one
+      // queueing, tail by the CPU thread, each on a cache line of its own
+      uint8_t* commands;
+      uint32_t mask;
+      alignas(64) std::atomic<uint32_t> head;
+      alignas(64) std::atomic<uint32_t> tail;
+
+      alignas(64) std::atomic<uint64_t> cycles;
+      std::atomic<bool> running;
+      std::thread thread;
+
+      bool Push(uint8_t command);
+      bool Drain();
+      void Loop(uint64_t cycleCount);
+};
@@ -0,0 +1,215 @@
+#include "mos6502_cow.h"
+
+#include <string.h>
+
+mos6502_cow::mos6502_cow(IORead ioRead, IOWrite ioWrite, void* ctx)
+{
+   this->ioRead = ioRead;
+   this->ioWrite = ioWrite;
+   this->ctx = ctx;
+   free = nullptr;
+   copies = 0;
+
+   cpu = new mos6502(&BusRead, &BusWrite, this);
+   for(int i = 0; i < 256; i++)
+   {
+      pages[i] = NewPage();
+      memset(pages[i]->data, 0, 256);
+      cpu->MapRAM(i, i, pages[i]->data);
+   }
+}
+
+mos6502_cow::~mos6502_cow()
+{
+   for(int i = 0; i < 256; i++)
+   {
+      Release(i);
+   }
+   while(free)
+   {
+      Page* p = free;
+      free = p->next;
+      delete p;
+   }
+   delete cpu;
+}
+
+mos6502* mos6502_cow::GetCpu()
+{
+   return cpu;
+}
+
+void* mos6502_cow::GetContext()
+{
+   return ctx;
+}
+
+void mos6502_cow::SetContext(void* ctx)
+{
+   this->ctx = ctx;
+}
+
+mos6502_cow::Page* mos6502_cow::NewPage()
+{
+   Page* p = free;
+   if (p)
+   {
+      free = p->next;
+   }
+   else
+   {
+      p = new Page;
+   }
+   p->refs = 1;
+   return p;
+}
+
+void mos6502_cow::Release(int page)
+{
+   Page* p = pages[page];
+   pages[page] = nullptr;
+   if (p && --p->refs == 0)
+   {
+      p->next = free;
+      free = p;
+   }
+}
+
+uint8_t* mos6502_cow::Own(int page)
+{
+   Page* p = pages[page];
+   if (p->refs > 1)
+   {
+      Page* copy = NewPage();
+      memcpy(copy->data, p->data, 256);
+      p->refs--;
+      pages[page] = p = copy;
+      copies++;
+      // the same bytes, the blocks decoded from the page stay valid
+      cpu->SetPage(page, p->data, p->data);
+   }
+   return p->data;
+}
+
+void mos6502_cow::Touch(int page)
+{
+#ifdef BLOCK_CACHE
+   cpu->pageGen[page]++;
+#endif
+}
+
+void mos6502_cow::MapIO(uint8_t first, uint8_t last)
+{
+   for(int i = first; i <= last; i++)
+   {
+      Release(i);
+   }
+   cpu->MapIO(first, last);
+}
+
+uint8_t mos6502_cow::Peek(uint16_t addr)
+{
+   Page* p = pages[addr >> 8];
+   return p ? p->data[addr & 0xFF] : 0x00;
+}
+
+void mos6502_cow::Poke(uint16_t addr, uint8_t value)
+{
+   if (pages[addr >> 8])
+   {
+      Own(addr >> 8)[addr & 0xFF] = value;
+      Touch(addr >> 8);
+   }
+}
+
+void mos6502_cow::Load(uint16_t addr, const uint8_t* data, uint32_t size)
+{
+   while(size)
+   {
+      uint32_t n = 256 - (addr & 0xFF);
+      if (n > size) n = size;
+      if (pages[addr >> 8])
+      {
+         memcpy(Own(addr >> 8) + (addr & 0xFF), data, n);
+         Touch(addr >> 8);
+      }
+      addr += n;
+      data += n;
+      size -= n;
+   }
+}
+
+void mos6502_cow::Fork(mos6502_cow& child)
+{
+   if (&child == this) return;
+
+   mos6502::State state;
+   cpu->SaveState(state);
+   child.cpu->LoadState(state);
+
+   const uint8_t* read[256];
+   for(int i = 0; i < 256; i++)
+   {
+      Page* p = pages[i];
+      read[i] = p ? p->data : nullptr;
+      if (child.pages[i] == p) continue;
+      if (p) p->refs++;
+      child.Release(i);
+      child.pages[i] = p;
+   }
+
+   // both page tables read from the shared pages and write through the
+   // bus, which copies the page first. The parent reads the same bytes as
+   // before, its blocks stay valid; the child reads new ones
+   cpu->SetReadPages(read);
+   child.cpu->SetReadPages(read);
+#ifdef BLOCK_CACHE
+   child.cpu->FlushBlockCache();
+#endif
+
+   child.ioRead = ioRead;
+   child.ioWrite = ioWrite;
+}
+
+int mos6502_cow::GetSharedPages()
+{
+   int n = 0;
+   for(int i = 0; i < 256; i++)
+   {
+      n += pages[i] && pages[i]->refs > 1;
+   }
+   return n;
+}
+
+uint64_t mos6502_cow::GetCopies()
+{
+   return copies;
+}
+
+// only I/O pages and the first write to a shared page come here, RAM is
+// mapped
+uint8_t mos6502_cow::BusRead(void* ctx, uint16_t addr)
+{
+   mos6502_cow* m = (mos6502_cow*)ctx;
+   return m->ioRead ? m->ioRead(m, addr) : 0x00;
+}
+
+void mos6502_cow::BusWrite(void* ctx, uint16_t addr, uint8_t value)
+{
+   mos6502_cow* m = (mos6502_cow*)ctx;
+   if (m->pages[addr >> 8])
+   {
+      uint8_t* data = m->Own(addr >> 8);
+      data[addr & 0xFF] = value;
+      // not copied: shared when forked, the others have copied it since
+      // and it is ours alone, still mapped read-only
+      if (m->cpu->writePage[addr >> 8] != data)
+      {
+         m->cpu->SetPage(addr >> 8, data, data);
+      }
+   }
+   else if (m->ioWrite)
+   {
+      m->ioWrite(m, addr, value);
+   }
+}
@@ -0,0 +1,91 @@
+//============================================================================
+// Name        : mos6502_cow
+// Description : A mos6502 with copy-on-write RAM, forked in place of a
+//               full copy of its state
+//============================================================================
+
+#pragma once
+#include "mos6502.h"
+
+#include <stdint.h>
+
+#ifdef BUS_HEADER
+#error "mos6502_cow owns the memory of its CPU, it does not work with BUS_HEADER"
+#endif
+#if !defined(BUS_CONTEXT) || !defined(MEMORY_MAP)
+#error "mos6502_cow needs BUS_CONTEXT and MEMORY_MAP: shared pages are mapped read-only and their first write comes back through the bus"
+#endif
+
+class mos6502_cow
+{
+   public:
+      // the I/O pages, see MapIO()
+      typedef uint8_t (*IORead)(mos6502_cow* machine, uint16_t addr);
+      typedef void (*IOWrite)(mos6502_cow* machine, uint16_t addr, uint8_t value);
+
+      // a CPU with 64K of zeroed RAM. ctx is for the I/O callbacks, see
+      // GetContext()
+      mos6502_cow(IORead ioRead = nullptr, IOWrite ioWrite = nullptr, void* ctx = nullptr);
+      ~mos6502_cow();
+      mos6502_cow(const mos6502_cow&) = delete;
+      mos6502_cow& operator=(const mos6502_cow&) = delete;
+
+      mos6502* GetCpu();
+
+      // the device state behind the I/O pages, which Fork() does not copy
+      void* GetContext();
+      void SetContext(void* ctx);
+
+      // pages first..last are I/O: no RAM behind them, the CPU reads and
+      // writes them through ioRead/ioWrite (reads give 0 without them)
+      void MapIO(uint8_t first, uint8_t last);
+
+      // RAM as the CPU sees it, 0 for I/O. Poke() and Load() copy the pages
+      // they write to if they are shared
+      uint8_t Peek(uint16_t addr);
+      void Poke(uint16_t addr, uint8_t value);
+      void Load(uint16_t addr, const uint8_t* data, uint32_t size);
+
+      // make child a copy of this machine: the CPU state (mos6502::State),
+      // the I/O map and callbacks, and the RAM, whose pages both share
+      // until one of them writes to one. The cost is that of copying the
+      // page table; the first write to a shared page copies its 256 bytes.
+      // The old memory of child is let go of, its context and pending
+      // events stay as they were. Machines sharing pages must be run by
+      // one thread at a time
+      void Fork(mos6502_cow& child);
+
+      // pages shared with other machines right now, and pages copied on a
+      // write so far
+      int GetSharedPages();
+      uint64_t GetCopies();
+
+   private:
+      struct Page
+      {
+         uint32_t refs;        // machines mapping it
+         Page* next;           // in the free list
+         uint8_t data[256];
+      };
+
+      mos6502* cpu;
+      Page* pages[256];        // nullptr for I/O
+      Page* free;              // pages let go of, for the next copies
+
+      IORead ioRead;
+      IOWrite ioWrite;
+      void* ctx;
+
+      uint64_t copies;
+
+      Page* NewPage();
+      void Release(int page);
+      // a page of our own: a shared page is copied, and the copy mapped
+      // as RAM in its place
+      uint8_t* Own(int page);
+      // the host wrote to the page behind the back of the CPU
+      void Touch(int page);
+
+      static uint8_t BusRead(void* ctx, uint16_t addr);
+      static void BusWrite(void* ctx, uint16_t addr, uint8_t value);
+};
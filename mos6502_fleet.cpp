@@ -0,0 +1,257 @@
+#include "mos6502_fleet.h"
+
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// CPUs waiting for a quantum. The owner pops from the front, thieves take
+// from the back. A quantum is long enough for a lock to cost nothing
+struct mos6502_fleet::Worker
+{
+   std::mutex lock;
+   std::deque<int> queue;
+   uint64_t cycles;
+};
+
+mos6502_fleet::mos6502_fleet(int count, int threads)
+{
+   if (threads <= 0)
+   {
+      threads = (int)std::thread::hardware_concurrency();
+      if (threads <= 0) threads = 1;
+   }
+   this->count = count;
+   this->threads = threads;
+   seconds = 0;
+   totalCycles = 0;
+   live = 0;
+
+   instances = new Instance[count];
+   for(int i = 0; i < count; i++)
+   {
+      Instance& in = instances[i];
+      in.memory = new uint8_t[65536]();
+#ifdef BUS_CONTEXT
+      in.cpu = new mos6502(&BusRead, &BusWrite, in.memory);
+#else
+      in.cpu = new mos6502(&BusRead, &BusWrite);
+#endif
+#ifdef MEMORY_MAP
+      in.cpu->MapRAM(0x00, 0xFF, in.memory);
+#endif
+      in.cycles = 0;
+      in.left = 0;
+      in.reason = RUNNING;
+   }
+   workers = new Worker[threads];
+}
+
+mos6502_fleet::~mos6502_fleet()
+{
+   for(int i = 0; i < count; i++)
+   {
+      delete instances[i].cpu;
+      delete[] instances[i].memory;
+   }
+   delete[] instances;
+   delete[] workers;
+}
+
+#ifdef BUS_CONTEXT
+uint8_t mos6502_fleet::BusRead(void* ctx, uint16_t addr)
+{
+   return ((uint8_t*)ctx)[addr];
+}
+
+void mos6502_fleet::BusWrite(void* ctx, uint16_t addr, uint8_t value)
+{
+   ((uint8_t*)ctx)[addr] = value;
+}
+#else
+// every page is mapped, the bus is never called
+uint8_t mos6502_fleet::BusRead(uint16_t addr)
+{
+   return 0;
+}
+
+void mos6502_fleet::BusWrite(uint16_t addr, uint8_t value)
+{
+}
+#endif
+
+int mos6502_fleet::GetCount()
+{
+   return count;
+}
+
+int mos6502_fleet::GetThreads()
+{
+   return threads;
+}
+
+mos6502* mos6502_fleet::GetCpu(int index)
+{
+   return instances[index].cpu;
+}
+
+uint8_t* mos6502_fleet::GetMemory(int index)
+{
+   return instances[index].memory;
+}
+
+mos6502_fleet::StopReason mos6502_fleet::GetStopReason(int index)
+{
+   return instances[index].reason;
+}
+
+uint64_t mos6502_fleet::GetCycles(int index)
+{
+   return instances[index].cycles;
+}
+
+double mos6502_fleet::GetSeconds()
+{
+   return seconds;
+}
+
+uint64_t mos6502_fleet::GetTotalCycles()
+{
+   return totalCycles;
+}
+
+double mos6502_fleet::GetMHz()
+{
+   return seconds > 0 ? totalCycles / seconds / 1e6 : 0;
+}
+
+void mos6502_fleet::Run(
+      uint64_t amount,
+      mos6502::CycleMethod cycleMethod,
+      int32_t quantum,
+      Check check,
+      void* ctx)
+{
+   if (quantum <= 0) quantum = 1;
+
+   // deal the CPUs out in contiguous runs, stealing evens out the rest
+   live = 0;
+   for(int i = 0; i < count; i++)
+   {
+      Instance& in = instances[i];
+      in.left = amount;
+      if (in.cpu->IsHalted())
+      {
+         in.reason = ILLEGAL_OPCODE;
+      }
+      else if (amount == 0)
+      {
+         in.reason = BUDGET;
+      }
+      else
+      {
+         in.reason = RUNNING;
+         workers[(int64_t)i * threads / count].queue.push_back(i);
+         live++;
+      }
+   }
+
+   auto t0 = std::chrono::steady_clock::now();
+
+   std::vector<std::thread> pool;
+   for(int w = 1; w < threads; w++)
+   {
+      pool.emplace_back(&mos6502_fleet::Work, this, w,
+            cycleMethod, quantum, check, ctx);
+   }
+   Work(0, cycleMethod, quantum, check, ctx);
+   for(auto& t : pool)
+   {
+      t.join();
+   }
+
+   auto t1 = std::chrono::steady_clock::now();
+   seconds = std::chrono::duration<double>(t1 - t0).count();
+
+   totalCycles = 0;
+   for(int w = 0; w < threads; w++)
+   {
+      totalCycles += workers[w].cycles;
+   }
+}
+
+bool mos6502_fleet::Take(int w, int& index)
+{
+   {
+      std::lock_guard<std::mutex> guard(workers[w].lock);
+      if (!workers[w].queue.empty())
+      {
+         index = workers[w].queue.front();
+         workers[w].queue.pop_front();
+         return true;
+      }
+   }
+
+   for(int i = 1; i < threads; i++)
+   {
+      Worker& victim = workers[(w + i) % threads];
+      std::lock_guard<std::mutex> guard(victim.lock);
+      if (!victim.queue.empty())
+      {
+         index = victim.queue.back();
+         victim.queue.pop_back();
+         return true;
+      }
+   }
+   return false;
+}
+
+void mos6502_fleet::Work(int w, mos6502::CycleMethod cycleMethod,
+      int32_t quantum, Check check, void* ctx)
+{
+   uint64_t done = 0;
+   int index;
+
+   // a CPU is in at most one queue, or held by the worker running it.
+   // Every queue can be empty while the others still hold CPUs they will
+   // put back, so the worker only leaves once every CPU is done
+   while(live > 0)
+   {
+      if (!Take(w, index))
+      {
+         std::this_thread::yield();
+         continue;
+      }
+
+      Instance& in = instances[index];
+      int32_t slice = in.left < (uint64_t)quantum ? (int32_t)in.left : quantum;
+      uint64_t before = in.cycles;
+
+      in.cpu->Run(slice, in.cycles, cycleMethod);
+      in.left -= slice;
+      done += in.cycles - before;
+
+      if (in.cpu->IsHalted())
+      {
+         in.reason = ILLEGAL_OPCODE;
+      }
+      else if (check && check(this, index, ctx))
+      {
+         in.reason = STOPPED;
+      }
+      else if (in.left == 0)
+      {
+         in.reason = BUDGET;
+      }
+      else
+      {
+         std::lock_guard<std::mutex> guard(workers[w].lock);
+         workers[w].queue.push_back(index);
+         continue;
+      }
+      live--;
+   }
+
+   workers[w].cycles = done;
+}
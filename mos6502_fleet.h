@@ -0,0 +1,102 @@
+//============================================================================
+// Name        : mos6502_fleet
+// Description : Many independent mos6502 instances run on a thread pool
+//============================================================================
+
+#pragma once
+#include "mos6502.h"
+
+#include <stdint.h>
+#include <atomic>
+
+#ifdef BUS_HEADER
+#error "mos6502_fleet owns the memory of its CPUs, it does not work with BUS_HEADER"
+#endif
+#if !defined(BUS_CONTEXT) && !defined(MEMORY_MAP)
+#error "mos6502_fleet needs BUS_CONTEXT or MEMORY_MAP to give each CPU its own memory"
+#endif
+
+class mos6502_fleet
+{
+   public:
+      enum StopReason {
+         RUNNING,          // not run yet
+         BUDGET,           // ran everything it was given
+         ILLEGAL_OPCODE,   // stopped on an illegal opcode
+         STOPPED,          // stopped by the check callback
+      };
+
+      // called by a worker thread after every quantum of CPU index,
+      // returning true stops it. It may run on several threads at a
+      // time, for different CPUs
+      typedef bool (*Check)(mos6502_fleet* fleet, int index, void* ctx);
+
+      // count CPUs, each with 64K of RAM of its own, run by threads
+      // workers (0: one per core). With MEMORY_MAP all of the RAM is
+      // mapped, with BUS_CONTEXT the bus callbacks read and write it.
+      // Load the memory, then Reset() the CPU before the first Run()
+      mos6502_fleet(int count, int threads = 0);
+      ~mos6502_fleet();
+      mos6502_fleet(const mos6502_fleet&) = delete;
+      mos6502_fleet& operator=(const mos6502_fleet&) = delete;
+
+      int GetCount();
+      int GetThreads();
+      mos6502* GetCpu(int index);
+      uint8_t* GetMemory(int index);
+
+      // run every CPU that has not halted for amount more cycles or
+      // instructions, in quanta of at most quantum. The workers take
+      // CPUs from their own queue and steal from the others when it runs
+      // dry, one quantum at a time. Each CPU gets the same quanta
+      // whatever the number of threads, so the results are too
+      void Run(
+            uint64_t amount,
+            mos6502::CycleMethod cycleMethod = mos6502::CYCLE_COUNT,
+            int32_t quantum = 100000,
+            Check check = nullptr,
+            void* ctx = nullptr);
+
+      // how the last Run() ended for CPU index, and its cycle count so far
+      StopReason GetStopReason(int index);
+      uint64_t GetCycles(int index);
+
+      // the last Run(): wall time, cycles run by all the CPUs whatever
+      // its cycleMethod, and their millions per second
+      double GetSeconds();
+      uint64_t GetTotalCycles();
+      double GetMHz();
+
+   private:
+      struct Instance
+      {
+         mos6502* cpu;
+         uint8_t* memory;
+         uint64_t cycles;
+         uint64_t left;       // of the current Run()
+         StopReason reason;
+      };
+
+      struct Worker;
+
+      Instance* instances;
+      int count;
+      int threads;
+      Worker* workers;
+
+      double seconds;
+      uint64_t totalCycles;
+      std::atomic<int> live;   // CPUs of the current Run() not done yet
+
+      void Work(int w, mos6502::CycleMethod cycleMethod, int32_t quantum,
+            Check check, void* ctx);
+      bool Take(int w, int& index);
+
+#ifdef BUS_CONTEXT
+      static uint8_t BusRead(void* ctx, uint16_t addr);
+      static void BusWrite(void* ctx, uint16_t addr, uint8_t value);
+#else
+      static uint8_t BusRead(uint16_t addr);
+      static void BusWrite(uint16_t addr, uint8_t value);
+#endif
+};
@@ -0,0 +1,833 @@
+#include "mos6502_lanes.h"
+
+#include <stddef.h>
+
+#define NEGATIVE  0x80
+#define OVERFLOW  0x40
+#define CONSTANT  0x20
+#define BREAK     0x10
+#define DECIMAL   0x08
+#define INTERRUPT 0x04
+#define ZERO      0x02
+#define CARRY     0x01
+
+// key bit of the lanes not running
+#define STOP 0x10000u
+
+// lanes are allocated by whole AVX2 vectors of bytes
+#define LANE_ALIGN 32
+
+// a step with fewer than stride / LIST_RATIO lanes runs them one by one,
+// below that the full width loops cost more than they save
+#define LIST_RATIO 16
+
+enum
+{
+   MODE_ACC,
+   MODE_IMM,
+   MODE_ABS,
+   MODE_ZER,
+   MODE_ZEX,
+   MODE_ZEY,
+   MODE_ABX,
+   MODE_ABY,
+   MODE_IMP,
+   MODE_REL,
+   MODE_INX,
+   MODE_INY,
+   MODE_ABI,
+};
+
+static constexpr uint16_t Length(int mode)
+{
+   return mode == MODE_ACC || mode == MODE_IMP ? 1 :
+      mode == MODE_ABS || mode == MODE_ABX || mode == MODE_ABY ||
+      mode == MODE_ABI ? 3 : 2;
+}
+
+static constexpr bool Indexed(int mode)
+{
+   return mode == MODE_ZEX || mode == MODE_ZEY || mode == MODE_ABX ||
+      mode == MODE_ABY || mode == MODE_INX || mode == MODE_INY;
+}
+
+static inline uint8_t NZ(uint8_t p, uint8_t v)
+{
+   return (p & ~(NEGATIVE | ZERO)) | (v & NEGATIVE) | (v ? 0 : ZERO);
+}
+
+// what an opcode does to one lane, as the Op_* of the core do: registers,
+// and m, the operand byte, loaded before READ ops and stored back after
+// WRITE ones. No branches, so that a loop over the lanes is vector code
+struct LaneOp
+{
+   static const bool SCALAR = false;   // no kernel, the core runs it
+   static const bool READ = false;
+   static const bool WRITE = false;
+   static const bool BCD = false;      // the core runs it when D is set
+   static const bool JUMP = false;     // PC = the operand address
+   static inline void Do(uint8_t& a, uint8_t& x, uint8_t& y, uint8_t& s,
+         uint8_t& p, uint8_t& m) {}
+   static inline uint8_t Taken(uint8_t p) { return 0; }
+};
+
+struct LaneScalar : LaneOp
+{
+   static const bool SCALAR = true;
+};
+
+#define LANE_OP(CODE, R, W, ...) \
+struct Lane_ ## CODE : LaneOp \
+{ \
+   static const bool READ = R; \
+   static const bool WRITE = W; \
+   static inline void Do(uint8_t& a, uint8_t& x, uint8_t& y, uint8_t& s, \
+         uint8_t& p, uint8_t& m) \
+   { \
+      __VA_ARGS__ \
+   } \
+};
+
+#define LANE_BRANCH(CODE, COND) \
+struct Lane_ ## CODE : LaneOp \
+{ \
+   static inline uint8_t Taken(uint8_t p) { return (COND) ? 1 : 0; } \
+};
+
+#define LANE_SCALAR(CODE) \
+struct Lane_ ## CODE : LaneScalar {};
+
+LANE_OP(LDA, true, false, a = m; p = NZ(p, a);)
+LANE_OP(LDX, true, false, x = m; p = NZ(p, x);)
+LANE_OP(LDY, true, false, y = m; p = NZ(p, y);)
+LANE_OP(STA, false, true, m = a;)
+LANE_OP(STX, false, true, m = x;)
+LANE_OP(STY, false, true, m = y;)
+
+LANE_OP(AND, true, false, a &= m; p = NZ(p, a);)
+LANE_OP(ORA, true, false, a |= m; p = NZ(p, a);)
+LANE_OP(EOR, true, false, a ^= m; p = NZ(p, a);)
+LANE_OP(CMP, true, false, p = (NZ(p, a - m) & ~CARRY) | (a >= m);)
+LANE_OP(CPX, true, false, p = (NZ(p, x - m) & ~CARRY) | (x >= m);)
+LANE_OP(CPY, true, false, p = (NZ(p, y - m) & ~CARRY) | (y >= m);)
+LANE_OP(BIT, true, false,
+   p = (p & ~(NEGATIVE | OVERFLOW | ZERO)) | (m & (NEGATIVE | OVERFLOW)) |
+      ((m & a) ? 0 : ZERO);)
+
+LANE_OP(INC, true, true, m++; p = NZ(p, m);)
+LANE_OP(DEC, true, true, m--; p = NZ(p, m);)
+LANE_OP(ASL, true, true, p = (p & ~CARRY) | (m >> 7); m <<= 1; p = NZ(p, m);)
+LANE_OP(LSR, true, true, p = (p & ~CARRY) | (m & 1); m >>= 1; p = NZ(p, m);)
+LANE_OP(ROL, true, true,
+   uint8_t c = p & CARRY;
+   p = (p & ~CARRY) | (m >> 7);
+   m = (m << 1) | c;
+   p = NZ(p, m);)
+LANE_OP(ROR, true, true,
+   uint8_t c = p & CARRY;
+   p = (p & ~CARRY) | (m & 1);
+   m = (m >> 1) | (c << 7);
+   p = NZ(p, m);)
+
+// the accumulator mode hands A over as m
+struct Lane_ASL_ACC : Lane_ASL {};
+struct Lane_LSR_ACC : Lane_LSR {};
+struct Lane_ROL_ACC : Lane_ROL {};
+struct Lane_ROR_ACC : Lane_ROR {};
+
+LANE_OP(TAX, false, false, x = a; p = NZ(p, x);)
+LANE_OP(TAY, false, false, y = a; p = NZ(p, y);)
+LANE_OP(TXA, false, false, a = x; p = NZ(p, a);)
+LANE_OP(TYA, false, false, a = y; p = NZ(p, a);)
+LANE_OP(TSX, false, false, x = s; p = NZ(p, x);)
+LANE_OP(TXS, false, false, s = x;)
+LANE_OP(INX, false, false, x++; p = NZ(p, x);)
+LANE_OP(INY, false, false, y++; p = NZ(p, y);)
+LANE_OP(DEX, false, false, x--; p = NZ(p, x);)
+LANE_OP(DEY, false, false, y--; p = NZ(p, y);)
+
+LANE_OP(CLC, false, false, p &= ~CARRY;)
+LANE_OP(SEC, false, false, p |= CARRY;)
+LANE_OP(CLI, false, false, p &= ~INTERRUPT;)
+LANE_OP(SEI, false, false, p |= INTERRUPT;)
+LANE_OP(CLD, false, false, p &= ~DECIMAL;)
+LANE_OP(SED, false, false, p |= DECIMAL;)
+LANE_OP(CLV, false, false, p &= ~OVERFLOW;)
+LANE_OP(NOP, false, false, )
+
+struct Lane_ADC : LaneOp
+{
+   static const bool READ = true;
+   static const bool BCD = true;
+   static inline void Do(uint8_t& a, uint8_t& x, uint8_t& y, uint8_t& s,
+         uint8_t& p, uint8_t& m)
+   {
+      uint16_t t = a + m + (p & CARRY);
+      uint8_t r = t;
+      p = (NZ(p, r) & ~(OVERFLOW | CARRY)) |
+         ((~(a ^ m) & (a ^ r) & 0x80) >> 1) | (t >> 8);
+      a = r;
+   }
+};
+
+// A - m - borrow is A + ~m + C, the carry out is the inverted borrow
+struct Lane_SBC : LaneOp
+{
+   static const bool READ = true;
+   static const bool BCD = true;
+   static inline void Do(uint8_t& a, uint8_t& x, uint8_t& y, uint8_t& s,
+         uint8_t& p, uint8_t& m)
+   {
+      uint16_t t = a + (uint8_t)~m + (p & CARRY);
+      uint8_t r = t;
+      p = (NZ(p, r) & ~(OVERFLOW | CARRY)) |
+         (((a ^ m) & (a ^ r) & 0x80) >> 1) | (t >> 8);
+      a = r;
+   }
+};
+
+LANE_BRANCH(BCC, !(p & CARRY))
+LANE_BRANCH(BCS, p & CARRY)
+LANE_BRANCH(BEQ, p & ZERO)
+LANE_BRANCH(BNE, !(p & ZERO))
+LANE_BRANCH(BMI, p & NEGATIVE)
+LANE_BRANCH(BPL, !(p & NEGATIVE))
+LANE_BRANCH(BVS, p & OVERFLOW)
+LANE_BRANCH(BVC, !(p & OVERFLOW))
+
+// JMP (abs) goes to the core as every MODE_ABI does
+struct Lane_JMP : LaneOp
+{
+   static const bool JUMP = true;
+};
+
+// the stack, interrupts and the undocumented opcodes
+LANE_SCALAR(BRK)
+LANE_SCALAR(RTI)
+LANE_SCALAR(JSR)
+LANE_SCALAR(RTS)
+LANE_SCALAR(PHA)
+LANE_SCALAR(PHP)
+LANE_SCALAR(PLA)
+LANE_SCALAR(PLP)
+LANE_SCALAR(ILLEGAL)
+LANE_SCALAR(ALR)
+LANE_SCALAR(ANC)
+LANE_SCALAR(ANE)
+LANE_SCALAR(ARR)
+LANE_SCALAR(DCP)
+LANE_SCALAR(ISC)
+LANE_SCALAR(LAS)
+LANE_SCALAR(LAX)
+LANE_SCALAR(LXA)
+LANE_SCALAR(RLA)
+LANE_SCALAR(RRA)
+LANE_SCALAR(SAX)
+LANE_SCALAR(SBX)
+LANE_SCALAR(SHA)
+LANE_SCALAR(SHX)
+LANE_SCALAR(SHY)
+LANE_SCALAR(SLO)
+LANE_SCALAR(SRE)
+LANE_SCALAR(TAS)
+
+#undef LANE_OP
+#undef LANE_BRANCH
+#undef LANE_SCALAR
+
+mos6502_lanes::mos6502_lanes(int count)
+{
+   this->count = count;
+   stride = (count + LANE_ALIGN - 1) / LANE_ALIGN * LANE_ALIGN;
+   if (stride == 0) stride = LANE_ALIGN;
+
+   mem = new uint8_t[65536 * (size_t)stride]();
+   A = new uint8_t[stride]();
+   X = new uint8_t[stride]();
+   Y = new uint8_t[stride]();
+   S = new uint8_t[stride]();
+   P = new uint8_t[stride]();
+   key = new uint32_t[stride];
+   halted = new uint8_t[stride];
+   left = new int32_t[stride]();
+   spent = new uint32_t[stride]();
+   cycles = new uint64_t[stride]();
+   mask = new uint8_t[stride]();
+   list = new int32_t[stride];
+   operand = new uint8_t[stride]();
+   addr = new uint16_t[stride]();
+   extra = new uint8_t[stride]();
+
+   // the padding lanes never run
+   for(int i = 0; i < stride; i++)
+   {
+      key[i] = STOP;
+      halted[i] = i >= count;
+   }
+
+   groupSize = 0;
+   useList = false;
+   cycleMethod = mos6502::CYCLE_COUNT;
+   steps = 0;
+   instructions = 0;
+   scalar = 0;
+
+#ifdef BUS_CONTEXT
+   cpu = new mos6502(&BusRead, &BusWrite, this);
+#else
+   cpu = new mos6502(&BusRead, &BusWrite);
+#endif
+   current = 0;
+}
+
+mos6502_lanes::~mos6502_lanes()
+{
+   delete cpu;
+   delete[] mem;
+   delete[] A;
+   delete[] X;
+   delete[] Y;
+   delete[] S;
+   delete[] P;
+   delete[] key;
+   delete[] halted;
+   delete[] left;
+   delete[] spent;
+   delete[] cycles;
+   delete[] mask;
+   delete[] list;
+   delete[] operand;
+   delete[] addr;
+   delete[] extra;
+}
+
+#ifdef BUS_CONTEXT
+uint8_t mos6502_lanes::BusRead(void* ctx, uint16_t addr)
+{
+   mos6502_lanes* lanes = (mos6502_lanes*)ctx;
+   return lanes->Row(addr)[lanes->current];
+}
+
+void mos6502_lanes::BusWrite(void* ctx, uint16_t addr, uint8_t value)
+{
+   mos6502_lanes* lanes = (mos6502_lanes*)ctx;
+   lanes->Row(addr)[lanes->current] = value;
+}
+#else
+// without BUS_CONTEXT the bus callbacks of the core cannot tell the lanes
+// apart, Run() leaves its lanes here for them
+static thread_local mos6502_lanes* running;
+
+uint8_t mos6502_lanes::BusRead(uint16_t addr)
+{
+   return running->Row(addr)[running->current];
+}
+
+void mos6502_lanes::BusWrite(uint16_t addr, uint8_t value)
+{
+   running->Row(addr)[running->current] = value;
+}
+#endif
+
+uint8_t* mos6502_lanes::Row(uint16_t addr)
+{
+   return mem + addr * (size_t)stride;
+}
+
+int mos6502_lanes::GetCount()
+{
+   return count;
+}
+
+uint8_t mos6502_lanes::Peek(int lane, uint16_t addr)
+{
+   return Row(addr)[lane];
+}
+
+void mos6502_lanes::Poke(int lane, uint16_t addr, uint8_t value)
+{
+   Row(addr)[lane] = value;
+}
+
+void mos6502_lanes::Load(uint16_t addr, const uint8_t* data, uint32_t size)
+{
+   for(uint32_t n = 0; n < size; n++)
+   {
+      uint8_t* row = Row(addr + n);
+      for(int i = 0; i < count; i++)
+      {
+         row[i] = data[n];
+      }
+   }
+}
+
+void mos6502_lanes::Reset()
+{
+   for(int i = 0; i < count; i++)
+   {
+      A[i] = cpu->GetResetA();
+      X[i] = cpu->GetResetX();
+      Y[i] = cpu->GetResetY();
+      S[i] = cpu->GetResetS();
+      P[i] = cpu->GetResetP() | CONSTANT | BREAK;
+      halted[i] = 0;
+      key[i] = STOP | Peek(i, 0xFFFC) | Peek(i, 0xFFFD) << 8;
+   }
+}
+
+void mos6502_lanes::Run(int32_t cycles, mos6502::CycleMethod cycleMethod)
+{
+   this->cycleMethod = cycleMethod;
+#ifndef BUS_CONTEXT
+   running = this;
+#endif
+
+   for(int i = 0; i < count; i++)
+   {
+      if (halted[i]) continue;
+      left[i] = cycles;
+      key[i] = (key[i] & 0xFFFF) | (cycles > 0 ? 0 : STOP);
+   }
+
+   // a step adds at most 9 cycles to spent[]
+   uint32_t unfolded = 0;
+   for(;;)
+   {
+      uint32_t next = STOP;
+      for(int i = 0; i < stride; i++)
+      {
+         next = key[i] < next ? key[i] : next;
+      }
+      if (next == STOP) break;
+
+      Step(next);
+      if (++unfolded == (1u << 28))
+      {
+         Fold();
+         unfolded = 0;
+      }
+   }
+   Fold();
+}
+
+void mos6502_lanes::Fold()
+{
+   for(int i = 0; i < count; i++)
+   {
+      cycles[i] += spent[i];
+      spent[i] = 0;
+   }
+}
+
+void mos6502_lanes::Step(uint16_t pc)
+{
+   int leader = 0;
+   while(key[leader] != pc) leader++;
+
+   const uint8_t* r0 = Row(pc);
+   const uint8_t* r1 = Row(pc + 1);
+   const uint8_t* r2 = Row(pc + 2);
+   uint8_t b0 = r0[leader];
+   uint8_t b1 = r1[leader];
+   uint8_t b2 = r2[leader];
+   uint8_t length = mos6502::InstrTable[b0].bytes;
+   bool any1 = length < 2;
+   bool any2 = length < 3;
+
+   // the lanes at pc with the same instruction, the others wait for a
+   // later step
+   const uint32_t* k = key;
+   uint8_t* on = mask;
+   int width = stride;
+   int n = 0;
+   for(int i = 0; i < width; i++)
+   {
+      uint8_t same = (k[i] == pc) & (r0[i] == b0) &
+         ((r1[i] == b1) | any1) & ((r2[i] == b2) | any2);
+      on[i] = -same;
+      n += same;
+   }
+
+   groupSize = n;
+   useList = n * LIST_RATIO < stride;
+   if (useList)
+   {
+      for(int i = leader, k = 0; k < n; i++)
+      {
+         list[k] = i;
+         k += mask[i] & 1;
+      }
+   }
+
+   uint8_t bytes[3] = { b0, b1, b2 };
+   (this->*LaneTable[b0])(pc, bytes);
+
+   steps++;
+   instructions += n;
+}
+
+// any lane of the step in decimal mode
+bool mos6502_lanes::Decimal()
+{
+   uint8_t p = 0;
+   for(int i = 0; i < stride; i++)
+   {
+      p |= P[i] & mask[i];
+   }
+   return p & DECIMAL;
+}
+
+// one lane at a time through the Step<> handler of the core, as its Run()
+// does after fetching the opcode
+void mos6502_lanes::Scalar(uint16_t pc, const uint8_t* bytes)
+{
+   uint8_t op = bytes[0];
+   int32_t cost = cycleMethod == mos6502::CYCLE_COUNT ?
+      mos6502::InstrTable[op].cycles : 1;
+
+   for(int i = 0; i < stride; i++)
+   {
+      if (!mask[i]) continue;
+
+      current = i;
+      cpu->SetA(A[i]);
+      cpu->SetX(X[i]);
+      cpu->SetY(Y[i]);
+      cpu->SetS(S[i]);
+      cpu->SetP(P[i]);
+      cpu->pc = pc + 1;
+#ifdef BLOCK_CACHE
+      // the core takes operands from the block being run, they are the
+      // same for every lane of the step
+      cpu->fetch = bytes + 1;
+#endif
+      spent[i] += (cpu->*mos6502::StepTable[op])();
+      left[i] -= cost;
+
+      A[i] = cpu->GetA();
+      X[i] = cpu->GetX();
+      Y[i] = cpu->GetY();
+      S[i] = cpu->GetS();
+      P[i] = cpu->GetP();
+      if (cpu->illegalOpcode)
+      {
+         halted[i] = 1;
+         cpu->illegalOpcode = false;
+      }
+      key[i] = cpu->pc | (left[i] > 0 && !halted[i] ? 0 : STOP);
+      scalar++;
+   }
+}
+
+// the arrays of the lanes copied to a local: the compiler cannot tell that
+// a store to a lane array leaves the members of the object alone, so it
+// would load them again at every lane and give up on vector code
+struct LaneView
+{
+   uint8_t* A;
+   uint8_t* X;
+   uint8_t* Y;
+   uint8_t* S;
+   uint8_t* P;
+   uint32_t* key;
+   int32_t* left;
+   uint32_t* spent;
+   uint8_t* operand;
+   uint16_t* addr;
+   uint8_t* extra;
+   uint8_t* mem;
+   size_t stride;
+
+   uint8_t* Row(uint16_t a) const { return mem + a * stride; }
+};
+
+// effective address of an indexed mode in addr[i], page crossing in extra[i]
+template<int MODE, bool PENALTY>
+static inline void LaneAddress(const LaneView v, int i, const uint8_t* bytes)
+{
+   uint16_t ad = 0;
+   uint8_t crossed = 0;
+
+   if (MODE == MODE_ZEX)
+   {
+      ad = (uint8_t)(bytes[1] + v.X[i]);
+   }
+   else if (MODE == MODE_ZEY)
+   {
+      ad = (uint8_t)(bytes[1] + v.Y[i]);
+   }
+   else if (MODE == MODE_ABX)
+   {
+      ad = (bytes[1] | bytes[2] << 8) + v.X[i];
+      crossed = bytes[1] + v.X[i] > 255;
+   }
+   else if (MODE == MODE_ABY)
+   {
+      ad = (bytes[1] | bytes[2] << 8) + v.Y[i];
+      crossed = bytes[1] + v.Y[i] > 255;
+   }
+   else if (MODE == MODE_INX)
+   {
+      uint8_t zero = bytes[1] + v.X[i];
+      ad = v.Row(zero)[i] | v.Row((uint8_t)(zero + 1))[i] << 8;
+   }
+   else if (MODE == MODE_INY)
+   {
+      uint8_t base = v.Row(bytes[1])[i];
+      ad = base + (v.Row((uint8_t)(bytes[1] + 1))[i] << 8) + v.Y[i];
+      crossed = base + v.Y[i] > 255;
+   }
+
+   v.addr[i] = ad;
+   if (PENALTY) v.extra[i] = crossed;
+}
+
+// the operation on lane i, kept only where on is 0xFF. The operand of the
+// indexed modes goes through operand[], branches leave there whether they
+// were taken
+template<int MODE, class OP>
+static inline void LaneApply(const LaneView v, int i, uint8_t on,
+      uint8_t imm, uint8_t* row, uint8_t crossed)
+{
+   uint8_t a = v.A[i];
+   uint8_t x = v.X[i];
+   uint8_t y = v.Y[i];
+   uint8_t s = v.S[i];
+   uint8_t p = v.P[i];
+   uint8_t m = 0;
+
+   if (MODE == MODE_ACC) m = a;
+   else if (MODE == MODE_IMM) m = imm;
+   else if ((MODE == MODE_ZER || MODE == MODE_ABS) && OP::READ) m = row[i];
+   else if (Indexed(MODE) && OP::READ) m = v.operand[i];
+
+   OP::Do(a, x, y, s, p, m);
+   if (MODE == MODE_ACC) a = m;
+
+   v.A[i] = on ? a : v.A[i];
+   v.X[i] = on ? x : v.X[i];
+   v.Y[i] = on ? y : v.Y[i];
+   v.S[i] = on ? s : v.S[i];
+   v.P[i] = on ? p : v.P[i];
+
+   if ((MODE == MODE_ZER || MODE == MODE_ABS) && OP::WRITE)
+   {
+      row[i] = on ? m : row[i];
+   }
+   else if (Indexed(MODE) && OP::WRITE)
+   {
+      v.operand[i] = m;
+   }
+   else if (MODE == MODE_REL)
+   {
+      // one more cycle if taken, another one if it crosses a page
+      uint8_t taken = OP::Taken(p);
+      v.operand[i] = taken;
+      v.extra[i] = taken + (taken & crossed);
+   }
+}
+
+// PC, cycles and budget of lane i after the step
+template<bool BRANCH, bool EXTRA>
+static inline void LaneRetire(const LaneView v, int i, uint8_t on,
+      uint8_t cycles, int32_t cost, uint16_t next, uint16_t target)
+{
+   // masks rather than selects, GCC does not if-convert these
+   uint32_t m = (uint32_t)(int32_t)(int8_t)on;
+   uint32_t to = BRANCH ? (v.operand[i] ? target : next) : target;
+   int32_t rest = v.left[i] - cost;
+   uint32_t stop = (uint32_t)(rest <= 0) * STOP;
+   v.spent[i] += (cycles + (EXTRA ? v.extra[i] : 0)) & m;
+   v.left[i] = (v.left[i] & ~m) | (rest & m);
+   v.key[i] = (v.key[i] & ~m) | ((to | stop) & m);
+}
+
+// one opcode on the lanes of the step. With many lanes every loop runs
+// over the full width, the lanes outside of the step masked out, so that
+// they compile to vector code; only the operands of the indexed modes are
+// loaded and stored one lane at a time
+template<int MODE, class OP, uint8_t CYCLES, bool PENALTY>
+void mos6502_lanes::Exec(uint16_t pc, const uint8_t* bytes)
+{
+   if (OP::SCALAR || MODE == MODE_ABI || (OP::BCD && Decimal()))
+   {
+      Scalar(pc, bytes);
+      return;
+   }
+
+   const bool branch = MODE == MODE_REL;
+   const bool more = PENALTY || branch;
+   uint16_t next = pc + Length(MODE);
+   uint16_t at = MODE == MODE_ZER ? bytes[1] : bytes[1] | bytes[2] << 8;
+   uint16_t target = OP::JUMP ? at : next;
+   uint8_t crossed = 0;
+   if (branch)
+   {
+      target = next + (int8_t)bytes[1];
+      crossed = (target ^ next) > 0xFF;
+   }
+   uint8_t* row = MODE == MODE_ZER || MODE == MODE_ABS ? Row(at) : nullptr;
+   int32_t cost = cycleMethod == mos6502::CYCLE_COUNT ? CYCLES : 1;
+
+   const LaneView v = {
+      A, X, Y, S, P, key, left, spent, operand, addr, extra, mem, (size_t)stride
+   };
+   const uint8_t* on = mask;
+   int width = stride;
+
+   if (useList)
+   {
+      for(int k = 0; k < groupSize; k++)
+      {
+         int i = list[k];
+         if (Indexed(MODE))
+         {
+            LaneAddress<MODE, PENALTY>(v, i, bytes);
+            if (OP::READ) v.operand[i] = v.Row(v.addr[i])[i];
+         }
+         LaneApply<MODE, OP>(v, i, 0xFF, bytes[1], row, crossed);
+         if (Indexed(MODE) && OP::WRITE) v.Row(v.addr[i])[i] = v.operand[i];
+         LaneRetire<branch, more>(v, i, 0xFF, CYCLES, cost, next, target);
+      }
+      return;
+   }
+
+   if (Indexed(MODE))
+   {
+      for(int i = 0; i < width; i++)
+      {
+         LaneAddress<MODE, PENALTY>(v, i, bytes);
+      }
+      if (OP::READ)
+      {
+         for(int i = 0; i < width; i++)
+         {
+            v.operand[i] = v.Row(v.addr[i])[i];
+         }
+      }
+   }
+   // every lane has arrays of its own, the lanes do not depend on each other
+#pragma GCC ivdep
+   for(int i = 0; i < width; i++)
+   {
+      LaneApply<MODE, OP>(v, i, on[i], bytes[1], row, crossed);
+   }
+   if (Indexed(MODE) && OP::WRITE)
+   {
+      for(int i = 0; i < width; i++)
+      {
+         if (on[i]) v.Row(v.addr[i])[i] = v.operand[i];
+      }
+   }
+#pragma GCC ivdep
+   for(int i = 0; i < width; i++)
+   {
+      LaneRetire<branch, more>(v, i, on[i], CYCLES, cost, next, target);
+   }
+}
+
+// anything not in the opcode table
+template<uint8_t OP>
+void mos6502_lanes::Lane(uint16_t pc, const uint8_t* bytes)
+{
+   Scalar(pc, bytes);
+}
+
+#define MAKE_INSTR(HEX, CODE, MODE, CYCLES, PENALTY) \
+template<> void mos6502_lanes::Lane<HEX>(uint16_t pc, const uint8_t* bytes) \
+{ \
+   Exec<MODE_ ## MODE, Lane_ ## CODE, CYCLES, PENALTY>(pc, bytes); \
+}
+#include "mos6502_opcodes.h"
+#undef MAKE_INSTR
+
+#define LANE4(N)  &mos6502_lanes::Lane<(N)>, &mos6502_lanes::Lane<(N) + 1>, \
+                  &mos6502_lanes::Lane<(N) + 2>, &mos6502_lanes::Lane<(N) + 3>
+#define LANE16(N) LANE4(N), LANE4((N) + 4), LANE4((N) + 8), LANE4((N) + 12)
+#define LANE64(N) LANE16(N), LANE16((N) + 16), LANE16((N) + 32), LANE16((N) + 48)
+
+const mos6502_lanes::LaneExec mos6502_lanes::LaneTable[256] =
+{
+   LANE64(0x00), LANE64(0x40), LANE64(0x80), LANE64(0xC0)
+};
+
+#undef LANE4
+#undef LANE16
+#undef LANE64
+
+uint64_t mos6502_lanes::GetCycles(int lane)
+{
+   return cycles[lane] + spent[lane];
+}
+
+bool mos6502_lanes::IsHalted(int lane)
+{
+   return halted[lane];
+}
+
+uint16_t mos6502_lanes::GetPC(int lane)
+{
+   return key[lane] & 0xFFFF;
+}
+
+uint8_t mos6502_lanes::GetS(int lane)
+{
+   return S[lane];
+}
+
+uint8_t mos6502_lanes::GetP(int lane)
+{
+   return P[lane];
+}
+
+uint8_t mos6502_lanes::GetA(int lane)
+{
+   return A[lane];
+}
+
+uint8_t mos6502_lanes::GetX(int lane)
+{
+   return X[lane];
+}
+
+uint8_t mos6502_lanes::GetY(int lane)
+{
+   return Y[lane];
+}
+
+void mos6502_lanes::SetPC(int lane, uint16_t n)
+{
+   key[lane] = (key[lane] & STOP) | n;
+}
+
+void mos6502_lanes::SetS(int lane, uint8_t n)
+{
+   S[lane] = n;
+}
+
+void mos6502_lanes::SetP(int lane, uint8_t n)
+{
+   P[lane] = n;
+}
+
+void mos6502_lanes::SetA(int lane, uint8_t n)
+{
+   A[lane] = n;
+}
+
+void mos6502_lanes::SetX(int lane, uint8_t n)
+{
+   X[lane] = n;
+}
+
+void mos6502_lanes::SetY(int lane, uint8_t n)
+{
+   Y[lane] = n;
+}
+
+void mos6502_lanes::GetStats(uint64_t& steps, uint64_t& instructions, uint64_t& scalar)
+{
+   steps = this->steps;
+   instructions = this->instructions;
+   scalar = this->scalar;
+}
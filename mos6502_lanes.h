@@ -0,0 +1,135 @@
+//============================================================================
+// Name        : mos6502_lanes
+// Description : Many mos6502 machines run in lockstep, one opcode at a
+//               time for every lane at the same PC
+//============================================================================
+
+#pragma once
+#include "mos6502.h"
+
+#include <stdint.h>
+
+#ifdef BUS_HEADER
+#error "mos6502_lanes owns the memory of its lanes, it does not work with BUS_HEADER"
+#endif
+
+class mos6502_lanes
+{
+   public:
+      // count machines, each with 64K of plain RAM (no I/O, no interrupt
+      // lines). Load the memories, then Reset() before the first Run()
+      mos6502_lanes(int count);
+      ~mos6502_lanes();
+      mos6502_lanes(const mos6502_lanes&) = delete;
+      mos6502_lanes& operator=(const mos6502_lanes&) = delete;
+
+      int GetCount();
+
+      uint8_t Peek(int lane, uint16_t addr);
+      void Poke(int lane, uint16_t addr, uint8_t value);
+      // the same size bytes at addr in every lane
+      void Load(uint16_t addr, const uint8_t* data, uint32_t size);
+
+      // every lane, as mos6502::Reset() with the default reset values
+      void Reset();
+
+      // run every lane that has not halted for cycles more cycles or
+      // instructions, counted as mos6502::Run() does. Each step runs the
+      // lowest PC among the lanes left, on all the lanes at that PC with
+      // the same instruction bytes, so lanes that went apart on a branch
+      // join again where their paths meet
+      void Run(int32_t cycles, mos6502::CycleMethod cycleMethod = mos6502::CYCLE_COUNT);
+
+      // cycles run by lane so far, and whether it stopped on an illegal
+      // opcode (until the next Reset())
+      uint64_t GetCycles(int lane);
+      bool IsHalted(int lane);
+
+      uint16_t GetPC(int lane);
+      uint8_t GetS(int lane);
+      uint8_t GetP(int lane);
+      uint8_t GetA(int lane);
+      uint8_t GetX(int lane);
+      uint8_t GetY(int lane);
+
+      void SetPC(int lane, uint16_t n);
+      void SetS(int lane, uint8_t n);
+      void SetP(int lane, uint8_t n);
+      void SetA(int lane, uint8_t n);
+      void SetX(int lane, uint8_t n);
+      void SetY(int lane, uint8_t n);
+
+      // steps run so far (one opcode over a group of lanes), instructions
+      // run by all the lanes, and how many of those the scalar core ran;
+      // instructions / steps is the number of lanes per step
+      void GetStats(uint64_t& steps, uint64_t& instructions, uint64_t& scalar);
+
+   private:
+      int count;
+      int stride;              // count rounded up to a whole vector
+
+      // address-major: the byte at addr of lane i is mem[addr * stride + i],
+      // so an access to the same address by every lane is a single row
+      uint8_t* mem;
+
+      // registers, one array each, as the core names them
+      uint8_t* A;
+      uint8_t* X;
+      uint8_t* Y;
+      uint8_t* S;
+      uint8_t* P;
+
+      // PC in the low 16 bits, STOP set while the lane does not run: out
+      // of budget, halted or padding. The lowest key is the next PC to run
+      uint32_t* key;
+      uint8_t* halted;
+      int32_t* left;           // budget of the current Run()
+      uint32_t* spent;         // cycles not added to cycles[] yet
+      uint64_t* cycles;
+
+      // the lanes of the current step, both as a mask and as a list
+      uint8_t* mask;           // 0xFF or 0x00
+      int32_t* list;
+      int groupSize;
+      bool useList;            // few lanes, run them one by one
+
+      // per lane scratch of a step: operand byte or branch taken, its
+      // address for the indexed modes, extra cycles
+      uint8_t* operand;
+      uint16_t* addr;
+      uint8_t* extra;
+
+      mos6502::CycleMethod cycleMethod;
+
+      uint64_t steps;
+      uint64_t instructions;
+      uint64_t scalar;
+
+      // runs the opcodes without a lane kernel, one lane at a time, with
+      // the bus on the memory of lane current
+      mos6502* cpu;
+      int current;
+
+      uint8_t* Row(uint16_t addr);
+      void Step(uint16_t pc);
+      void Fold();
+
+      // one instantiation per opcode of mos6502_opcodes.h, see Exec()
+      template<uint8_t OP> void Lane(uint16_t pc, const uint8_t* bytes);
+      template<int MODE, class OP, uint8_t CYCLES, bool PENALTY>
+      void Exec(uint16_t pc, const uint8_t* bytes);
+
+      bool Decimal();
+      void Scalar(uint16_t pc, const uint8_t* bytes);
+
+      typedef void (mos6502_lanes::*LaneExec)(uint16_t, const uint8_t*);
+      static const LaneExec LaneTable[256];
+
+#ifdef BUS_CONTEXT
+      static uint8_t BusRead(void* ctx, uint16_t addr);
+      static void BusWrite(void* ctx, uint16_t addr, uint8_t value);
+#else
+      static uint8_t BusRead(uint16_t addr);
+      static void BusWrite(uint16_t addr, uint8_t value);
+#endif
+};
@@ -0,0 +1,50 @@
+//============================================================================
+// Name        : mos6502_pairs
+// Description : MOS 6502 superinstructions, pairs run as one handler
+//============================================================================
+
+// No include guard: this file is meant to be included several times.
+// Define MAKE_PAIR(FIRST, SECOND, NAME) before including it, every entry
+// below expands to one MAKE_PAIR(...) with no separator after it.
+//
+// The first instruction of a pair must not write memory. If it reads from
+// a bus callback that raises an interrupt line or flushes the block cache,
+// the pair stops after its first half, as the interpreter would.
+
+// loop counters
+   MAKE_PAIR(0xCA, 0xD0, "DEX BNE")
+   MAKE_PAIR(0x88, 0xD0, "DEY BNE")
+   MAKE_PAIR(0xE8, 0xD0, "INX BNE")
+   MAKE_PAIR(0xC8, 0xD0, "INY BNE")
+   MAKE_PAIR(0xE8, 0xE0, "INX CPX #")
+   MAKE_PAIR(0xC8, 0xC0, "INY CPY #")
+
+// compare and branch
+   MAKE_PAIR(0xC9, 0xF0, "CMP # BEQ")
+   MAKE_PAIR(0xC9, 0xD0, "CMP # BNE")
+   MAKE_PAIR(0xC9, 0x90, "CMP # BCC")
+   MAKE_PAIR(0xC9, 0xB0, "CMP # BCS")
+   MAKE_PAIR(0xE0, 0xD0, "CPX # BNE")
+   MAKE_PAIR(0xC0, 0xD0, "CPY # BNE")
+
+// carry setup for arithmetic
+   MAKE_PAIR(0x18, 0x69, "CLC ADC #")
+   MAKE_PAIR(0x18, 0x65, "CLC ADC zpg")
+   MAKE_PAIR(0x18, 0x6D, "CLC ADC abs")
+   MAKE_PAIR(0x18, 0x79, "CLC ADC abs,Y")
+   MAKE_PAIR(0x38, 0xE9, "SEC SBC #")
+   MAKE_PAIR(0x38, 0xE5, "SEC SBC zpg")
+
+// immediate stores
+   MAKE_PAIR(0xA9, 0x85, "LDA # STA zpg")
+   MAKE_PAIR(0xA9, 0x8D, "LDA # STA abs")
+   MAKE_PAIR(0xA2, 0x86, "LDX # STX zpg")
+   MAKE_PAIR(0xA0, 0x84, "LDY # STY zpg")
+
+// memory copies
+   MAKE_PAIR(0xA5, 0x85, "LDA zpg STA zpg")
+   MAKE_PAIR(0xAD, 0x8D, "LDA abs STA abs")
+   MAKE_PAIR(0xBD, 0x9D, "LDA abs,X STA abs,X")
+   MAKE_PAIR(0xBD, 0x99, "LDA abs,X STA abs,Y")
+   MAKE_PAIR(0xB9, 0x99, "LDA abs,Y STA abs,Y")
+   MAKE_PAIR(0xB1, 0x91, "LDA (ind),Y STA (ind),Y")
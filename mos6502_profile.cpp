@@ -0,0 +1,129 @@
+#include "mos6502_profile.h"
+
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+mos6502_profile::mos6502_profile(mos6502* cpu)
+{
+   this->cpu = cpu;
+   entries = new mos6502::ProfileEntry[65536];
+   Clear();
+   cpu->SetProfile(entries);
+}
+
+mos6502_profile::~mos6502_profile()
+{
+   cpu->SetProfile(nullptr);
+   delete[] entries;
+}
+
+void mos6502_profile::Clear()
+{
+   memset(entries, 0, 65536 * sizeof(mos6502::ProfileEntry));
+}
+
+const mos6502::ProfileEntry* mos6502_profile::GetEntries()
+{
+   return entries;
+}
+
+uint64_t mos6502_profile::GetInstructions()
+{
+   uint64_t n = 0;
+   for(int i = 0; i < 65536; i++)
+   {
+      n += entries[i].count;
+   }
+   return n;
+}
+
+uint64_t mos6502_profile::GetCycles()
+{
+   uint64_t n = 0;
+   for(int i = 0; i < 65536; i++)
+   {
+      n += entries[i].cycles;
+   }
+   return n;
+}
+
+void mos6502_profile::Report(FILE* out, int top)
+{
+   std::vector<uint16_t> hot;
+   uint64_t total = 0;
+   for(int i = 0; i < 65536; i++)
+   {
+      if (entries[i].count) hot.push_back(i);
+      total += entries[i].cycles;
+   }
+
+   // most cycles first, then the lowest address
+   size_t n = std::min(hot.size(), (size_t)(top > 0 ? top : 0));
+   std::partial_sort(hot.begin(), hot.begin() + n, hot.end(),
+         [this](uint16_t a, uint16_t b) {
+            return entries[a].cycles != entries[b].cycles ?
+               entries[a].cycles > entries[b].cycles : a < b;
+         });
+
+   fprintf(out, "addr          count         cycles   share        penalty     calls\n");
+   for(size_t i = 0; i < n; i++)
+   {
+      const mos6502::ProfileEntry& e = entries[hot[i]];
+      fprintf(out, "%04X %14llu %14llu  %5.1f%% %14llu %9llu\n", hot[i],
+            (unsigned long long)e.count, (unsigned long long)e.cycles,
+            total ? 100.0 * e.cycles / total : 0.0,
+            (unsigned long long)e.penalty, (unsigned long long)e.calls);
+   }
+   fprintf(out, "%zu addresses run, %llu cycles\n", hot.size(), (unsigned long long)total);
+}
+
+bool mos6502_profile::WriteCallgrind(const char* filename, const char* name)
+{
+   FILE* f = fopen(filename, "w");
+   if (!f) return false;
+
+   uint64_t count = 0;
+   uint64_t cycles = 0;
+   uint64_t penalty = 0;
+   for(int i = 0; i < 65536; i++)
+   {
+      count += entries[i].count;
+      cycles += entries[i].cycles;
+      penalty += entries[i].penalty;
+   }
+
+   fprintf(f, "# callgrind format\n");
+   fprintf(f, "version: 1\n");
+   fprintf(f, "creator: mos6502_profile\n");
+   fprintf(f, "cmd: %s\n", name);
+   fprintf(f, "positions: instr\n");
+   fprintf(f, "events: Instructions Cycles Penalty\n");
+   fprintf(f, "summary: %llu %llu %llu\n\n", (unsigned long long)count,
+         (unsigned long long)cycles, (unsigned long long)penalty);
+   fprintf(f, "ob=%s\n", name);
+   fprintf(f, "fl=%s\n", name);
+
+   bool named = false;
+   for(int i = 0; i < 65536; i++)
+   {
+      const mos6502::ProfileEntry& e = entries[i];
+      if (e.calls)
+      {
+         fprintf(f, "fn=sub_%04X\n", i);
+         named = true;
+      }
+      if (!e.count) continue;
+      if (!named)
+      {
+         // the code below the first JSR target
+         fprintf(f, "fn=code\n");
+         named = true;
+      }
+      fprintf(f, "0x%04X %llu %llu %llu\n", i, (unsigned long long)e.count,
+            (unsigned long long)e.cycles, (unsigned long long)e.penalty);
+   }
+
+   bool ok = !ferror(f);
+   return fclose(f) == 0 && ok;
+}
@@ -0,0 +1,44 @@
+//============================================================================
+// Name        : mos6502_profile
+// Description : Where the cycles of a mos6502 go, per address: hot spot
+//               reports and callgrind files
+//============================================================================
+
+#pragma once
+#include "mos6502.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+#ifndef PROFILE
+#error "mos6502_profile needs PROFILE: the core does the counting"
+#endif
+
+class mos6502_profile
+{
+   public:
+      // profiles cpu from here on, until destroyed
+      mos6502_profile(mos6502* cpu);
+      ~mos6502_profile();
+      mos6502_profile(const mos6502_profile&) = delete;
+      mos6502_profile& operator=(const mos6502_profile&) = delete;
+
+      void Clear();
+
+      // 65536 entries, by address
+      const mos6502::ProfileEntry* GetEntries();
+      uint64_t GetInstructions();
+      uint64_t GetCycles();
+
+      // the top addresses by cycles, with their share of the total
+      void Report(FILE* out, int top = 20);
+
+      // a callgrind profile for callgrind_annotate or KCachegrind, one
+      // position per address. The code from each JSR target up to the
+      // next one makes a function, named after its address
+      bool WriteCallgrind(const char* filename, const char* name = "6502");
+
+   private:
+      mos6502* cpu;
+      mos6502::ProfileEntry* entries;
+};
@@ -0,0 +1,258 @@
+#include "mos6502_replay.h"
+
+// an entry is a varint of (stamp delta << 3 | kind), then for a read the
+// address (low byte first) and the value
+#define KIND_BITS 3
+
+mos6502_replay::mos6502_replay(Mode mode, BusRead read, BusWrite write,
+      void* ctx, ClockCycles clock)
+{
+   this->mode = mode;
+   this->read = read;
+   this->write = write;
+   this->ctx = ctx;
+   this->clock = clock;
+   for(int i = 0; i < 256; i++)
+   {
+      io[i] = false;
+   }
+
+   last = 0;
+   inAccess = false;
+   at = 0;
+   more = false;
+   diverged = false;
+   divergence = 0;
+
+   cpu = new mos6502(&BusReadShim, &BusWriteShim, this, &ClockShim);
+}
+
+mos6502_replay::~mos6502_replay()
+{
+   delete cpu;
+}
+
+mos6502* mos6502_replay::GetCpu()
+{
+   return cpu;
+}
+
+mos6502_replay::Mode mos6502_replay::GetMode()
+{
+   return mode;
+}
+
+void mos6502_replay::SetIO(uint8_t first, uint8_t last, bool io)
+{
+   for(int i = first; i <= last; i++)
+   {
+      this->io[i] = io;
+   }
+}
+
+// the stamp of the instruction running, or of the last boundary between
+// two calls to Run()
+uint64_t mos6502_replay::Stamp()
+{
+   return cpu->GetCycleStamp();
+}
+
+void mos6502_replay::Append(uint64_t stamp, uint8_t kind, uint16_t addr, uint8_t value)
+{
+   uint64_t v = (stamp - last) << KIND_BITS | kind;
+   last = stamp;
+   while(v >= 0x80)
+   {
+      log.push_back((uint8_t)(v | 0x80));
+      v >>= 7;
+   }
+   log.push_back((uint8_t)v);
+   if (kind == READ)
+   {
+      log.push_back(addr & 0xFF);
+      log.push_back(addr >> 8);
+      log.push_back(value);
+   }
+}
+
+void mos6502_replay::Decode()
+{
+   more = at < log.size();
+   if (!more) return;
+
+   uint64_t v = 0;
+   for(int shift = 0; at < log.size(); shift += 7)
+   {
+      uint8_t b = log[at++];
+      v |= (uint64_t)(b & 0x7F) << shift;
+      if (!(b & 0x80)) break;
+   }
+   last += v >> KIND_BITS;
+   next.stamp = last;
+   next.kind = v & ((1 << KIND_BITS) - 1);
+   if (next.kind == READ)
+   {
+      next.addr = log[at] | log[at + 1] << 8;
+      next.value = log[at + 2];
+      at += 3;
+   }
+}
+
+void mos6502_replay::Diverge(uint64_t stamp)
+{
+   if (!diverged)
+   {
+      diverged = true;
+      divergence = stamp;
+   }
+}
+
+// a line change from the log
+void mos6502_replay::Line(uint8_t kind)
+{
+   switch(kind)
+   {
+      case IRQ_LOW:  cpu->IRQ(false); break;
+      case IRQ_HIGH: cpu->IRQ(true);  break;
+      case NMI_LOW:  cpu->NMI(false); break;
+      case NMI_HIGH: cpu->NMI(true);  break;
+   }
+}
+
+void mos6502_replay::IRQ(bool line)
+{
+   if (mode == REPLAY) return;
+   cpu->IRQ(line);
+   uint8_t kind = line ? IRQ_HIGH : IRQ_LOW;
+   if (inAccess) deferred.push_back(kind);
+   else Append(Stamp(), kind);
+}
+
+void mos6502_replay::NMI(bool line)
+{
+   if (mode == REPLAY) return;
+   cpu->NMI(line);
+   uint8_t kind = line ? NMI_HIGH : NMI_LOW;
+   if (inAccess) deferred.push_back(kind);
+   else Append(Stamp(), kind);
+}
+
+const uint8_t* mos6502_replay::GetLog()
+{
+   return log.data();
+}
+
+size_t mos6502_replay::GetLogSize()
+{
+   return log.size();
+}
+
+void mos6502_replay::SetLog(const uint8_t* log, size_t size)
+{
+   this->log.assign(log, log + size);
+   last = 0;
+   at = 0;
+   diverged = false;
+   divergence = 0;
+   Decode();
+
+   // the lines as they were set before the first instruction
+   uint64_t now = Stamp();
+   while(more && next.kind != READ && next.stamp <= now)
+   {
+      Line(next.kind);
+      Decode();
+   }
+}
+
+bool mos6502_replay::Diverged()
+{
+   return diverged;
+}
+
+uint64_t mos6502_replay::GetDivergence()
+{
+   return divergence;
+}
+
+bool mos6502_replay::AtEnd()
+{
+   return !more;
+}
+
+uint8_t mos6502_replay::BusReadShim(void* ctx, uint16_t addr)
+{
+   mos6502_replay* r = (mos6502_replay*)ctx;
+   if (!r->io[addr >> 8])
+   {
+      return r->read(r->ctx, addr);
+   }
+
+   if (r->mode == RECORD)
+   {
+      r->inAccess = true;
+      uint8_t value = r->read(r->ctx, addr);
+      r->inAccess = false;
+      r->Append(r->Stamp(), READ, addr, value);
+      return value;
+   }
+
+   if (r->diverged) return 0x00;
+   uint64_t stamp = r->Stamp();
+   if (!r->more || r->next.kind != READ || r->next.stamp != stamp ||
+       r->next.addr != addr)
+   {
+      r->Diverge(stamp);
+      return 0x00;
+   }
+   uint8_t value = r->next.value;
+   r->Decode();
+   return value;
+}
+
+void mos6502_replay::BusWriteShim(void* ctx, uint16_t addr, uint8_t value)
+{
+   mos6502_replay* r = (mos6502_replay*)ctx;
+   if (r->mode == RECORD)
+   {
+      r->inAccess = true;
+      r->write(r->ctx, addr, value);
+      r->inAccess = false;
+   }
+   else if (!r->io[addr >> 8])
+   {
+      r->write(r->ctx, addr, value);
+   }
+}
+
+// between two instructions, stamp is the cycle count after the one that
+// just ended
+void mos6502_replay::ClockShim(mos6502* cpu, uint32_t n, uint64_t stamp)
+{
+   mos6502_replay* r = (mos6502_replay*)cpu->GetContext();
+
+   if (r->mode == RECORD)
+   {
+      // changes made inside the instruction show from here on
+      for(uint8_t kind : r->deferred)
+      {
+         r->Append(stamp, kind);
+      }
+      r->deferred.clear();
+   }
+   else if (!r->diverged)
+   {
+      // a read the instruction should have made
+      if (r->more && r->next.kind == READ && r->next.stamp < stamp)
+      {
+         r->Diverge(r->next.stamp);
+      }
+      while(r->more && r->next.kind != READ && r->next.stamp <= stamp)
+      {
+         r->Line(r->next.kind);
+         r->Decode();
+      }
+   }
+
+   if (r->clock) r->clock(cpu, n, stamp);
+}
@@ -0,0 +1,120 @@
+//============================================================================
+// Name        : mos6502_replay
+// Description : Records the values read from I/O and the interrupt line
+//               changes of a run, and replays them on a bare CPU
+//============================================================================
+
+#pragma once
+#include "mos6502.h"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+#ifndef BUS_CONTEXT
+#error "mos6502_replay needs BUS_CONTEXT: it sits between the CPU and the bus of the machine"
+#endif
+
+class mos6502_replay
+{
+   public:
+      enum Mode {
+         RECORD,           // I/O goes to the machine and into the log
+         REPLAY,           // I/O and interrupt lines come from the log
+      };
+
+      typedef uint8_t (*BusRead)(void* ctx, uint16_t addr);
+      typedef void (*BusWrite)(void* ctx, uint16_t addr, uint8_t value);
+      typedef void (*ClockCycles)(mos6502* cpu, uint32_t n, uint64_t stamp);
+
+      // a CPU on the bus read/write (with ctx), which serves every page in
+      // RECORD mode. In REPLAY mode it serves the pages that are not I/O,
+      // see SetIO(): the RAM and ROM, no device. The stamps of the log are
+      // those of the ClockCycles callback, which the replay takes over
+      // (clock is still called), so the CPU runs without the JIT and the
+      // fused pairs. Start recording and replaying from the same memory
+      // and CPU state, e.g. after Reset() or LoadState() of one snapshot
+      mos6502_replay(Mode mode, BusRead read, BusWrite write, void* ctx,
+            ClockCycles clock = nullptr);
+      ~mos6502_replay();
+      mos6502_replay(const mos6502_replay&) = delete;
+      mos6502_replay& operator=(const mos6502_replay&) = delete;
+
+      mos6502* GetCpu();
+      Mode GetMode();
+
+      // pages first..last are I/O (none by default). Reads from them are
+      // logged, or replayed; writes to them are dropped in REPLAY mode
+      void SetIO(uint8_t first, uint8_t last, bool io);
+
+      // the interrupt lines of the CPU, to be called instead of its own
+      // IRQ() and NMI(). RECORD logs the change, REPLAY ignores it: the
+      // log drives the lines at the same instruction boundaries
+      void IRQ(bool line);
+      void NMI(bool line);
+
+      // the log so far, about 4 bytes per I/O read and 1-2 per line change
+      const uint8_t* GetLog();
+      size_t GetLogSize();
+      // REPLAY: the log to replay, copied
+      void SetLog(const uint8_t* log, size_t size);
+
+      // REPLAY: whether the run left the log, and the cycle stamp where
+      // it did: an I/O read at another address or cycle than recorded,
+      // one more than recorded, or a recorded one that did not happen.
+      // From there on I/O reads give 0 and the lines stay as they are
+      bool Diverged();
+      uint64_t GetDivergence();
+      // REPLAY: every entry of the log was replayed
+      bool AtEnd();
+
+   private:
+      enum Kind {
+         READ,
+         IRQ_LOW,
+         IRQ_HIGH,
+         NMI_LOW,
+         NMI_HIGH,
+      };
+
+      struct Entry
+      {
+         uint64_t stamp;
+         uint8_t kind;
+         uint16_t addr;
+         uint8_t value;
+      };
+
+      Mode mode;
+      mos6502* cpu;
+      BusRead read;
+      BusWrite write;
+      void* ctx;
+      ClockCycles clock;
+      bool io[256];
+
+      std::vector<uint8_t> log;
+      uint64_t last;           // stamp of the last entry, for the deltas
+
+      // RECORD: inside a bus access, where a line change only shows at the
+      // end of the instruction, so it is logged at the next stamp
+      bool inAccess;
+      std::vector<uint8_t> deferred;
+
+      // REPLAY
+      size_t at;               // of the next entry in the log
+      Entry next;
+      bool more;               // next is valid
+      bool diverged;
+      uint64_t divergence;
+
+      uint64_t Stamp();
+      void Append(uint64_t stamp, uint8_t kind, uint16_t addr = 0, uint8_t value = 0);
+      void Decode();
+      void Diverge(uint64_t stamp);
+      void Line(uint8_t kind);
+
+      static uint8_t BusReadShim(void* ctx, uint16_t addr);
+      static void BusWriteShim(void* ctx, uint16_t addr, uint8_t value);
+      static void ClockShim(mos6502* cpu, uint32_t n, uint64_t stamp);
+};
@@ -0,0 +1,259 @@
+#include "mos6502_rewind.h"
+
+#include <string.h>
+
+// run forward in slices of a quarter of the way left, no instruction takes
+// more than twice its base cycles, then instruction by instruction
+#define REWIND_SLICE_END 64
+
+mos6502_rewind::mos6502_rewind(BusRead read, BusWrite write, void* ctx,
+      uint64_t interval, size_t memory, DeviceState device)
+{
+   this->read = read;
+   this->write = write;
+   this->ctx = ctx;
+   this->device = device;
+   this->interval = interval ? interval : 1;
+   limit = memory;
+   used = 0;
+   serial = 0;
+   event = -1;
+   cycles = 0;
+   for(int i = 0; i < 256; i++)
+   {
+      ram[i] = nullptr;
+   }
+
+   cpu = new mos6502(&BusReadShim, &BusWriteShim, this);
+}
+
+mos6502_rewind::~mos6502_rewind()
+{
+   delete cpu;
+}
+
+mos6502* mos6502_rewind::GetCpu()
+{
+   return cpu;
+}
+
+void mos6502_rewind::MapRAM(uint8_t first, uint8_t last, uint8_t* mem)
+{
+   for(int i = first; i <= last; i++)
+   {
+      ram[i] = mem + (i - first) * 256;
+   }
+   cpu->MapRAM(first, last, mem);
+   if (!ring.empty()) Protect();
+}
+
+// the next write to each RAM page comes through the bus. The reads stay
+// mapped, so the blocks decoded from the pages stay valid
+void mos6502_rewind::Protect()
+{
+   for(int i = 0; i < 256; i++)
+   {
+      if (ram[i]) cpu->SetPage(i, ram[i], nullptr);
+   }
+}
+
+void mos6502_rewind::Take(uint64_t now)
+{
+   Snapshot s;
+   s.id = serial++;
+   s.cycles = now;
+   cpu->SaveState(s.state);
+   ring.push_back(std::move(s));
+   if (device) device(ctx, ring.back().id, TAKE);
+
+   while(used > limit && ring.size() > 1)
+   {
+      Drop();
+   }
+
+   Protect();
+   event = cpu->ScheduleEvent(now + interval, &SnapshotEvent, this);
+}
+
+void mos6502_rewind::Drop()
+{
+   Snapshot& s = ring.front();
+   used -= s.pages.size() * 256;
+   if (device) device(ctx, s.id, DROP);
+   ring.pop_front();
+}
+
+// back to ring[index]: the pages saved by it and every later snapshot, the
+// newest first, give the RAM as it was then
+void mos6502_rewind::Restore(size_t index)
+{
+   for(size_t k = ring.size(); k-- > index; )
+   {
+      Snapshot& s = ring[k];
+      for(const Image& image : s.pages)
+      {
+         memcpy(ram[image.page], image.data, 256);
+#ifdef BLOCK_CACHE
+         cpu->pageGen[image.page]++;
+#endif
+      }
+      used -= s.pages.size() * 256;
+      s.pages.clear();
+      if (k > index && device) device(ctx, s.id, DROP);
+   }
+   ring.resize(index + 1);
+
+   Snapshot& s = ring.back();
+   cpu->LoadState(s.state);
+   cycles = s.cycles;
+   if (device) device(ctx, s.id, RESTORE);
+
+   Protect();
+   if (event >= 0) cpu->CancelEvent(event);
+   event = cpu->ScheduleEvent(cycles + interval, &SnapshotEvent, this);
+}
+
+// to REWIND_SLICE_END cycles or less before cycle
+void mos6502_rewind::Approach(uint64_t cycle)
+{
+   while(cycle > cycles + REWIND_SLICE_END)
+   {
+      uint64_t slice = (cycle - cycles) / 4;
+      cpu->Run(slice > INT32_MAX ? INT32_MAX : (int32_t)slice, cycles);
+   }
+}
+
+// to the first instruction boundary at or after cycle
+void mos6502_rewind::RunTo(uint64_t cycle)
+{
+   Approach(cycle);
+   while(cycles < cycle)
+   {
+      cpu->Run(1, cycles, mos6502::INST_COUNT);
+   }
+}
+
+// the newest snapshot at or before cycle, which must not be before the
+// oldest one
+size_t mos6502_rewind::Find(uint64_t cycle)
+{
+   size_t lo = 0;
+   size_t hi = ring.size();
+   while(hi - lo > 1)
+   {
+      size_t mid = (lo + hi) / 2;
+      if (ring[mid].cycles <= cycle) lo = mid;
+      else hi = mid;
+   }
+   return lo;
+}
+
+void mos6502_rewind::Run(int32_t cycles, mos6502::CycleMethod cycleMethod)
+{
+   if (ring.empty()) Take(this->cycles);
+   cpu->Run(cycles, this->cycles, cycleMethod);
+}
+
+uint64_t mos6502_rewind::GetCycles()
+{
+   return cycles;
+}
+
+bool mos6502_rewind::RunBackTo(uint64_t cycle)
+{
+   if (ring.empty() || cycle < ring.front().cycles || cycle > cycles)
+   {
+      return false;
+   }
+   Restore(Find(cycle));
+   RunTo(cycle);
+   return true;
+}
+
+bool mos6502_rewind::StepBack()
+{
+   if (ring.empty() || cycles <= ring.front().cycles)
+   {
+      return false;
+   }
+
+   // the boundary before this one is only known by running up to it
+   uint64_t now = cycles;
+   Restore(Find(now - 1));
+   Approach(now);
+   uint64_t before = cycles;
+   while(cycles < now)
+   {
+      before = cycles;
+      cpu->Run(1, cycles, mos6502::INST_COUNT);
+   }
+
+   Restore(Find(before));
+   RunTo(before);
+   return true;
+}
+
+void mos6502_rewind::Clear()
+{
+   while(!ring.empty())
+   {
+      Drop();
+   }
+   if (event >= 0) cpu->CancelEvent(event);
+   event = -1;
+   for(int i = 0; i < 256; i++)
+   {
+      if (ram[i]) cpu->SetPage(i, ram[i], ram[i]);
+   }
+}
+
+int mos6502_rewind::GetSnapshots()
+{
+   return (int)ring.size();
+}
+
+uint64_t mos6502_rewind::GetOldest()
+{
+   return ring.empty() ? cycles : ring.front().cycles;
+}
+
+size_t mos6502_rewind::GetMemory()
+{
+   return used;
+}
+
+uint8_t mos6502_rewind::BusReadShim(void* ctx, uint16_t addr)
+{
+   mos6502_rewind* r = (mos6502_rewind*)ctx;
+   return r->read(r->ctx, addr);
+}
+
+// the first write to a RAM page since the last snapshot saves the page
+// into it and maps the page for writing again
+void mos6502_rewind::BusWriteShim(void* ctx, uint16_t addr, uint8_t value)
+{
+   mos6502_rewind* r = (mos6502_rewind*)ctx;
+   uint8_t page = addr >> 8;
+   uint8_t* mem = r->ram[page];
+   if (!mem)
+   {
+      r->write(r->ctx, addr, value);
+      return;
+   }
+
+   std::vector<Image>& pages = r->ring.back().pages;
+   pages.emplace_back();
+   pages.back().page = page;
+   memcpy(pages.back().data, mem, 256);
+   r->used += 256;
+
+   r->cpu->SetPage(page, mem, mem);
+   mem[addr & 0xFF] = value;
+}
+
+void mos6502_rewind::SnapshotEvent(mos6502* cpu, void* ctx, uint64_t when, uint64_t now)
+{
+   mos6502_rewind* r = (mos6502_rewind*)ctx;
+   r->event = -1;
+   r->Take(now);
+}
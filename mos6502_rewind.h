@@ -0,0 +1,119 @@
+//============================================================================
+// Name        : mos6502_rewind
+// Description : A ring of periodic incremental snapshots, to run a
+//               mos6502 backwards
+//============================================================================
+
+#pragma once
+#include "mos6502.h"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <deque>
+#include <vector>
+
+#ifdef BUS_HEADER
+#error "mos6502_rewind tracks the writes to RAM through the bus, it does not work with BUS_HEADER"
+#endif
+#if !defined(BUS_CONTEXT) || !defined(MEMORY_MAP)
+#error "mos6502_rewind needs BUS_CONTEXT and MEMORY_MAP: RAM is mapped read-only after a snapshot and its first write comes back through the bus"
+#endif
+
+class mos6502_rewind
+{
+   public:
+      typedef uint8_t (*BusRead)(void* ctx, uint16_t addr);
+      typedef void (*BusWrite)(void* ctx, uint16_t addr, uint8_t value);
+
+      enum DeviceOp {
+         TAKE,             // snapshot id was taken
+         RESTORE,          // the machine went back to snapshot id
+         DROP,             // snapshot id left the ring
+      };
+      // the state of the devices behind the bus, which has to follow the
+      // CPU for the runs again to give the same results
+      typedef void (*DeviceState)(void* ctx, uint32_t id, DeviceOp op);
+
+      // a CPU on the bus read/write (with ctx), taking a snapshot every
+      // interval cycles and keeping the snapshots in a ring of at most
+      // memory bytes, the oldest go first. A snapshot is the CPU state
+      // plus the RAM pages written to since the snapshot before, saved on
+      // the first write to each. It uses one of the events of the CPU
+      mos6502_rewind(BusRead read, BusWrite write, void* ctx,
+            uint64_t interval = 100000, size_t memory = 16 << 20,
+            DeviceState device = nullptr);
+      ~mos6502_rewind();
+      mos6502_rewind(const mos6502_rewind&) = delete;
+      mos6502_rewind& operator=(const mos6502_rewind&) = delete;
+
+      // map ROM and I/O on the CPU itself, but the RAM through MapRAM()
+      // here, which tracks it. Only the CPU may write to the RAM once it
+      // runs, or call Clear() after changing it
+      mos6502* GetCpu();
+      void MapRAM(uint8_t first, uint8_t last, uint8_t* mem);
+
+      // as mos6502::Run(), with the cycle count kept here. The first run
+      // takes the first snapshot
+      void Run(int32_t cycles, mos6502::CycleMethod cycleMethod = mos6502::CYCLE_COUNT);
+      uint64_t GetCycles();
+
+      // back to the first instruction boundary at or after cycle, by
+      // going back to the last snapshot before it and running from there;
+      // the snapshots after it are dropped. False, with nothing changed,
+      // if cycle is before the oldest snapshot or after the current cycle
+      bool RunBackTo(uint64_t cycle);
+      // back to the boundary before the last instruction
+      bool StepBack();
+
+      // drop every snapshot, the next Run() starts again from here
+      void Clear();
+
+      // snapshots in the ring, the cycle of the oldest one, and the bytes
+      // of RAM they hold
+      int GetSnapshots();
+      uint64_t GetOldest();
+      size_t GetMemory();
+
+   private:
+      struct Image
+      {
+         uint8_t page;
+         uint8_t data[256];
+      };
+
+      struct Snapshot
+      {
+         uint32_t id;
+         uint64_t cycles;
+         mos6502::State state;
+         std::vector<Image> pages;   // as they were at cycles
+      };
+
+      mos6502* cpu;
+      BusRead read;
+      BusWrite write;
+      void* ctx;
+      DeviceState device;
+
+      uint8_t* ram[256];       // nullptr for the pages not tracked
+      uint64_t interval;
+      size_t limit;
+      size_t used;
+
+      std::deque<Snapshot> ring;
+      uint32_t serial;
+      int32_t event;           // of the next snapshot, -1 if none
+      uint64_t cycles;
+
+      void Take(uint64_t now);
+      void Protect();
+      void Drop();
+      void Restore(size_t index);
+      size_t Find(uint64_t cycle);
+      void Approach(uint64_t cycle);
+      void RunTo(uint64_t cycle);
+
+      static uint8_t BusReadShim(void* ctx, uint16_t addr);
+      static void BusWriteShim(void* ctx, uint16_t addr, uint8_t value);
+      static void SnapshotEvent(mos6502* cpu, void* ctx, uint64_t when, uint64_t now);
+};
@@ -0,0 +1,113 @@
+#include "mos6502_trace.h"
+
+#include <chrono>
+
+// polls of an empty buffer before the writer starts sleeping between them
+#define TRACE_SPINS 64
+
+mos6502_trace::mos6502_trace(mos6502* cpu, FILE* file, uint32_t size)
+{
+   this->cpu = cpu;
+   this->file = file;
+   this->size = size ? size : 1;
+   for(int i = 0; i < 2; i++)
+   {
+      buffers[i].records = new mos6502::TraceRecord[this->size];
+      buffers[i].count = 0;
+   }
+   filling = 0;
+   stalls = 0;
+   records = 0;
+   failed = false;
+   done = false;
+   closed = false;
+
+   writer = std::thread(&mos6502_trace::Write, this);
+   cpu->SetTrace(buffers[0].records, this->size, &Flush, this);
+}
+
+mos6502_trace::~mos6502_trace()
+{
+   Close();
+   for(int i = 0; i < 2; i++)
+   {
+      delete[] buffers[i].records;
+   }
+}
+
+void mos6502_trace::Close()
+{
+   if (closed) return;
+   closed = true;
+
+   cpu->FlushTrace();
+   cpu->SetTrace(nullptr, 0, nullptr);
+   done = true;
+   writer.join();
+   fflush(file);
+}
+
+uint64_t mos6502_trace::GetRecords()
+{
+   return records;
+}
+
+uint64_t mos6502_trace::GetStalls()
+{
+   return stalls;
+}
+
+bool mos6502_trace::Failed()
+{
+   return failed;
+}
+
+// on the CPU thread: hand the full buffer over, take the other one once
+// the writer is done with it
+mos6502::TraceRecord* mos6502_trace::Flush(void* ctx, mos6502::TraceRecord* full, uint32_t count)
+{
+   mos6502_trace* t = (mos6502_trace*)ctx;
+   t->buffers[t->filling].count.store(count, std::memory_order_release);
+   t->filling ^= 1;
+
+   Buffer& next = t->buffers[t->filling];
+   if (next.count.load(std::memory_order_acquire))
+   {
+      t->stalls++;
+      while(next.count.load(std::memory_order_acquire))
+      {
+         std::this_thread::yield();
+      }
+   }
+   return next.records;
+}
+
+// the buffers in the order the CPU fills them, until Close() and the last
+// one is out
+void mos6502_trace::Write()
+{
+   int i = 0;
+   int idle = 0;
+   for(;;)
+   {
+      Buffer& b = buffers[i];
+      uint32_t count = b.count.load(std::memory_order_acquire);
+      if (!count)
+      {
+         // Close() hands the last buffer over before it sets done
+         if (done && !b.count.load(std::memory_order_acquire)) break;
+         if (++idle < TRACE_SPINS) std::this_thread::yield();
+         else std::this_thread::sleep_for(std::chrono::microseconds(50));
+         continue;
+      }
+      idle = 0;
+
+      if (!failed && fwrite(b.records, sizeof(mos6502::TraceRecord), count, file) != count)
+      {
+         failed = true;
+      }
+      records += count;
+      b.count.store(0, std::memory_order_release);
+      i ^= 1;
+   }
+}
@@ -0,0 +1,62 @@
+//============================================================================
+// Name        : mos6502_trace
+// Description : Writes the instruction trace of a mos6502 to a file from a
+//               thread of its own
+//============================================================================
+
+#pragma once
+#include "mos6502.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <atomic>
+#include <thread>
+
+#ifndef TRACE
+#error "mos6502_trace needs TRACE: the core fills the records"
+#endif
+
+class mos6502_trace
+{
+   public:
+      // traces cpu into file, open for binary writing and left open, as
+      // raw mos6502::TraceRecord structs. Two buffers of size records take
+      // turns: the CPU fills one while the thread writes the other, and
+      // the CPU only waits when the writer is a whole buffer behind
+      mos6502_trace(mos6502* cpu, FILE* file, uint32_t size = 1 << 16);
+      ~mos6502_trace();
+      mos6502_trace(const mos6502_trace&) = delete;
+      mos6502_trace& operator=(const mos6502_trace&) = delete;
+
+      // writes the records left, stops the thread and the trace of the
+      // CPU. Called by the destructor too
+      void Close();
+
+      // records written so far, times the CPU waited for the writer, and
+      // whether a write to the file failed
+      uint64_t GetRecords();
+      uint64_t GetStalls();
+      bool Failed();
+
+   private:
+      struct Buffer
+      {
+         mos6502::TraceRecord* records;
+         std::atomic<uint32_t> count;   // full, 0 when free to fill
+      };
+
+      mos6502* cpu;
+      FILE* file;
+      uint32_t size;
+      Buffer buffers[2];
+      int filling;             // the buffer of the CPU
+      uint64_t stalls;
+      std::atomic<uint64_t> records;
+      std::atomic<bool> failed;
+      std::atomic<bool> done;
+      std::thread writer;
+      bool closed;
+
+      void Write();
+      static mos6502::TraceRecord* Flush(void* ctx, mos6502::TraceRecord* full, uint32_t count);
+};
@@ -0,0 +1,196 @@
+// compile with "g++ -O3 -pthread main.cpp ../../mos6502.cpp ../../mos6502_async.cpp
+// -o main"
+//
+// runs a CPU on its own thread and drives its IRQ and NMI lines from the
+// main thread through the command queue, waiting for each handler to
+// acknowledge its interrupt, then stops it. Checks that every interrupt
+// was taken once, that a full queue refuses commands, and that a halt
+// ends the thread. Also prints how fast it runs and how long a round
+// trip takes.
+
+#include "../../mos6502_async.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#define ROUNDS 2000
+
+static const uint8_t program[] = {
+   0xE6, 0x10,             // 0200 INC $10
+   0xD0, 0xFC,             // 0202 BNE $0200
+   0xE6, 0x11,             // 0204 INC $11
+   0x4C, 0x00, 0x02,       // 0206 JMP $0200
+};
+
+static const uint8_t irq[] = {
+   0xE6, 0x20,             // 0300 INC $20
+   0x8D, 0x00, 0xD0,       // 0302 STA $D000, releases the line
+   0x40,                   // 0305 RTI
+};
+
+static const uint8_t nmi[] = {
+   0xE6, 0x21,             // 0380 INC $21
+   0x8D, 0x01, 0xD0,       // 0382 STA $D001
+   0x40,                   // 0385 RTI
+};
+
+static uint8_t ram[65536];
+static mos6502* cpu;
+
+// written on the CPU thread, read on the main one
+static std::atomic<int> irqAcks;
+static std::atomic<int> nmiAcks;
+
+uint8_t read(uint16_t addr)
+{
+   return ram[addr];
+}
+
+void write(uint16_t addr, uint8_t value)
+{
+   if (addr == 0xD000)
+   {
+      cpu->IRQ(true);
+      irqAcks++;
+   }
+   if (addr == 0xD001) nmiAcks++;
+   ram[addr] = value;
+}
+
+static double Seconds(std::chrono::steady_clock::time_point start)
+{
+   return std::chrono::duration<double>(
+         std::chrono::steady_clock::now() - start).count();
+}
+
+// waits for an acknowledgement, false after a few seconds without one
+static bool Wait(std::atomic<int>& acks, int count)
+{
+   auto start = std::chrono::steady_clock::now();
+   while(acks < count)
+   {
+      if (Seconds(start) > 5) return false;
+      std::this_thread::yield();
+   }
+   return true;
+}
+
+int main(int argc, char **argv)
+{
+   memcpy(ram + 0x0200, program, sizeof(program));
+   memcpy(ram + 0x0300, irq, sizeof(irq));
+   memcpy(ram + 0x0380, nmi, sizeof(nmi));
+   ram[0xFFFA] = 0x80; ram[0xFFFB] = 0x03;
+   ram[0xFFFC] = 0x00; ram[0xFFFD] = 0x02;
+   ram[0xFFFE] = 0x00; ram[0xFFFF] = 0x03;
+   ram[0x0400] = 0x02;   // JAM
+   cpu = new mos6502(read, write);
+#ifdef MEMORY_MAP
+   cpu->MapRAM(0x00, 0xCF, ram);
+#endif
+   cpu->Reset();
+
+   // a full queue refuses more
+   mos6502_async async(cpu, 1000, mos6502::CYCLE_COUNT, 4);
+   if (!async.NMI(false) || !async.NMI(true) || !async.IRQ(true) || !async.IRQ(true))
+   {
+      printf("FAIL: an empty queue refused a command\n");
+      return 1;
+   }
+   if (async.IRQ(true))
+   {
+      printf("FAIL: a full queue took a command\n");
+      return 1;
+   }
+   if (!async.Start() || async.Start())
+   {
+      printf("FAIL: Start() on a running thread\n");
+      return 1;
+   }
+
+   // the falling edge of the NMI line queued above
+   if (!Wait(nmiAcks, 1))
+   {
+      printf("FAIL: the queued NMI not taken\n");
+      return 1;
+   }
+
+   // interrupts from this thread, one at a time
+   auto start = std::chrono::steady_clock::now();
+   for(int i = 0; i < ROUNDS; i++)
+   {
+      bool queued;
+      if (i & 1)
+      {
+         queued = async.NMI(false) && async.NMI(true);
+         if (queued && !Wait(nmiAcks, 1 + i / 2 + 1))
+         {
+            printf("FAIL: NMI %d not taken\n", i);
+            return 1;
+         }
+      }
+      else
+      {
+         queued = async.IRQ(false);
+         if (queued && !Wait(irqAcks, i / 2 + 1))
+         {
+            printf("FAIL: IRQ %d not taken\n", i);
+            return 1;
+         }
+      }
+      if (!queued)
+      {
+         printf("FAIL: the queue is full with the thread running\n");
+         return 1;
+      }
+   }
+   double roundSeconds = Seconds(start);
+
+   // left running alone for a while, then stopped
+   start = std::chrono::steady_clock::now();
+   uint64_t before = async.GetCycles();
+   std::this_thread::sleep_for(std::chrono::milliseconds(200));
+   if (!async.Stop())
+   {
+      printf("FAIL: the stop is refused\n");
+      return 1;
+   }
+   async.Join();
+   double runSeconds = Seconds(start);
+   uint64_t cycles = async.GetCycles();
+   if (async.IsRunning() || cycles <= before)
+   {
+      printf("FAIL: the thread is still running, or did not run\n");
+      return 1;
+   }
+
+   // every interrupt taken once by its handler, and nothing lost
+   if (ram[0x20] != (uint8_t)(ROUNDS / 2) || ram[0x21] != (uint8_t)(1 + ROUNDS / 2) ||
+         irqAcks != ROUNDS / 2 || nmiAcks != 1 + ROUNDS / 2)
+   {
+      printf("FAIL: %d IRQs and %d NMIs taken, %d of each sent\n", (int)irqAcks,
+            (int)nmiAcks - 1, ROUNDS / 2);
+      return 1;
+   }
+
+   // a halt ends the thread by itself
+   cpu->SetPC(0x0400);
+   async.Start(cycles);
+   async.Join();
+   if (!cpu->IsHalted() || async.IsRunning())
+   {
+      printf("FAIL: the thread did not end on the halt\n");
+      return 1;
+   }
+
+   printf("%d interrupts sent through the queue: every one taken once\n", ROUNDS);
+   printf("%.1f us per round trip, %.1f MHz running alone\n",
+         roundSeconds / ROUNDS * 1e6, (cycles - before) / runSeconds / 1e6);
+   delete cpu;
+   return 0;
+}
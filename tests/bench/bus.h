@@ -0,0 +1,15 @@
+// the benchmark memory as an inline bus, built in with
+// -I. -DBUS_HEADER='"bus.h"' in place of the readRam()/writeRam()
+// callbacks of main.cpp
+
+#pragma once
+#include <stdint.h>
+
+class mos6502_bus
+{
+   public:
+      uint8_t* mem;
+
+      uint8_t Read(uint16_t addr) { return mem[addr]; }
+      void Write(uint16_t addr, uint8_t value) { mem[addr] = value; }
+};
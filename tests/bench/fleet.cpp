@@ -0,0 +1,72 @@
+// compile with "g++ -O3 -pthread -DMEMORY_MAP fleet.cpp ../../mos6502.cpp
+// ../../mos6502_fleet.cpp -o main_fleet"
+//
+// scaling of the fleet runner: the same batch of CPUs on 1, 2, 4... worker
+// threads, up to the number of cores
+
+#include "../../mos6502_fleet.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <thread>
+
+// indexed loads/stores and two nested loops, at $0200, forever
+static const uint8_t copy[] = {
+   0xA2, 0x00,             // 0200 LDX #$00
+   0xA0, 0x00,             // 0202 LDY #$00
+   0xB9, 0x00, 0x10,       // 0204 LDA $1000,Y
+   0x18,                   // 0207 CLC
+   0x69, 0x01,             // 0208 ADC #$01
+   0x99, 0x00, 0x20,       // 020A STA $2000,Y
+   0x5D, 0x00, 0x30,       // 020D EOR $3000,X
+   0x88,                   // 0210 DEY
+   0xD0, 0xF1,             // 0211 BNE $0204
+   0xE8,                   // 0213 INX
+   0xD0, 0xEE,             // 0214 BNE $0204
+   0x4C, 0x00, 0x02,       // 0216 JMP $0200
+};
+
+int main(int argc, char **argv) {
+   int count = 1000;                // CPUs
+   uint64_t amount = 200000;        // instructions per CPU and per run
+
+   if (argc > 1) {
+      count = strtol(argv[1], NULL, 0);
+   }
+   if (argc > 2) {
+      amount = strtoull(argv[2], NULL, 0);
+   }
+
+   int cores = (int)std::thread::hardware_concurrency();
+   if (cores <= 0) cores = 1;
+
+   double base = 0;
+   for (int threads = 1; ; threads *= 2) {
+      if (threads > cores) threads = cores;
+
+      mos6502_fleet fleet(count, threads);
+      for (int i = 0; i < count; i++) {
+         uint8_t *ram = fleet.GetMemory(i);
+         for (int a = 0x1000; a < 0x4000; a++) {
+            ram[a] = (uint8_t)(a * 7 + (a >> 8) + i);
+         }
+         memcpy(ram + 0x200, copy, sizeof(copy));
+         ram[0xFFFC] = 0x00;
+         ram[0xFFFD] = 0x02;
+         fleet.GetCpu(i)->Reset();
+      }
+
+      fleet.Run(amount, mos6502::INST_COUNT, 20000);
+      if (threads == 1) base = fleet.GetMHz();
+
+      printf("%5d CPUs %3d threads %10.2f MHz  x%.2f\n", count, threads,
+             fleet.GetMHz(), base > 0 ? fleet.GetMHz() / base : 0.0);
+
+      if (threads == cores) break;
+   }
+
+   printf("%d cores\n", cores);
+   return 0;
+}
@@ -0,0 +1,130 @@
+// compile with "g++ -O3 -DMEMORY_MAP lanes.cpp ../../mos6502.cpp
+// ../../mos6502_lanes.cpp -o main_lanes" (add -mavx2 for AVX2)
+//
+// the same program on many lanes in lockstep and on as many scalar CPUs
+// run one after the other, with the lanes all on one path and with the
+// lanes going apart on data dependent branches
+
+#include "../../mos6502_lanes.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <chrono>
+
+// indexed loads/stores and two nested loops, at $0200, forever: every lane
+// takes the same branches
+static const uint8_t copy[] = {
+   0xA2, 0x00,             // 0200 LDX #$00
+   0xA0, 0x00,             // 0202 LDY #$00
+   0xB9, 0x00, 0x10,       // 0204 LDA $1000,Y
+   0x18,                   // 0207 CLC
+   0x69, 0x01,             // 0208 ADC #$01
+   0x99, 0x00, 0x20,       // 020A STA $2000,Y
+   0x5D, 0x00, 0x30,       // 020D EOR $3000,X
+   0x88,                   // 0210 DEY
+   0xD0, 0xF1,             // 0211 BNE $0204
+   0xE8,                   // 0213 INX
+   0xD0, 0xEE,             // 0214 BNE $0204
+   0x4C, 0x00, 0x02,       // 0216 JMP $0200
+};
+
+// the same loop with a branch on the data: each lane goes its own way for
+// two instructions and joins the others again at $020C
+static const uint8_t split[] = {
+   0xA2, 0x00,             // 0200 LDX #$00
+   0xA0, 0x00,             // 0202 LDY #$00
+   0xB9, 0x00, 0x10,       // 0204 LDA $1000,Y
+   0x30, 0x04,             // 0207 BMI $020D
+   0x69, 0x01,             // 0209 ADC #$01
+   0x90, 0x02,             // 020B BCC $020F
+   0x49, 0xFF,             // 020D EOR #$FF
+   0x99, 0x00, 0x20,       // 020F STA $2000,Y
+   0x88,                   // 0212 DEY
+   0xD0, 0xEF,             // 0213 BNE $0204
+   0xE8,                   // 0215 INX
+   0xD0, 0xEC,             // 0216 BNE $0204
+   0x4C, 0x00, 0x02,       // 0218 JMP $0200
+};
+
+static uint8_t* ram;
+
+uint8_t read(uint16_t addr) { return ram[addr]; }
+void write(uint16_t addr, uint8_t value) { ram[addr] = value; }
+
+static double Seconds(std::chrono::steady_clock::time_point start)
+{
+   return std::chrono::duration<double>(
+         std::chrono::steady_clock::now() - start).count();
+}
+
+static void Fill(uint8_t* mem, const uint8_t* program, size_t size, int i)
+{
+   memset(mem, 0, 65536);
+   for (int a = 0x1000; a < 0x4000; a++) {
+      mem[a] = (uint8_t)(a * 7 + (a >> 8) + i * 13);
+   }
+   memcpy(mem + 0x200, program, size);
+   mem[0xFFFC] = 0x00;
+   mem[0xFFFD] = 0x02;
+}
+
+static void Bench(const char* name, const uint8_t* program, size_t size,
+      int count, int32_t amount)
+{
+   static uint8_t mem[65536];
+
+   // the lanes
+   mos6502_lanes lanes(count);
+   for (int i = 0; i < count; i++) {
+      Fill(mem, program, size, i);
+      for (int a = 0; a < 65536; a++) {
+         lanes.Poke(i, a, mem[a]);
+      }
+   }
+   lanes.Reset();
+
+   auto start = std::chrono::steady_clock::now();
+   lanes.Run(amount, mos6502::INST_COUNT);
+   double lanesSeconds = Seconds(start);
+
+   uint64_t steps, instructions, scalar;
+   lanes.GetStats(steps, instructions, scalar);
+
+   // the scalar CPUs, one after the other on the same memory
+   ram = mem;
+   mos6502 cpu(read, write);
+   cpu.MapRAM(0x00, 0xFF, mem);
+   double cpuSeconds = 0;
+   for (int i = 0; i < count; i++) {
+      Fill(mem, program, size, i);
+      cpu.Reset();
+      uint64_t cycles = 0;
+      start = std::chrono::steady_clock::now();
+      cpu.Run(amount, cycles, mos6502::INST_COUNT);
+      cpuSeconds += Seconds(start);
+   }
+
+   double total = (double)count * amount;
+   printf("%-6s %5d lanes %10.2f MIPS, %5d scalar CPUs %10.2f MIPS  x%.2f  "
+          "(%.1f lanes per step)\n", name, count, total / lanesSeconds / 1e6,
+          count, total / cpuSeconds / 1e6, cpuSeconds / lanesSeconds,
+          (double)instructions / steps);
+}
+
+int main(int argc, char **argv) {
+   int count = 256;                 // lanes and CPUs
+   int32_t amount = 200000;         // instructions per lane
+
+   if (argc > 1) {
+      count = strtol(argv[1], NULL, 0);
+   }
+   if (argc > 2) {
+      amount = strtol(argv[2], NULL, 0);
+   }
+
+   Bench("same", copy, sizeof(copy), count, amount);
+   Bench("split", split, sizeof(split), count, amount);
+   return 0;
+}
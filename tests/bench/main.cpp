@@ -0,0 +1,200 @@
+// compile with "g++ -O3 main.cpp ../../mos6502.cpp -o main"
+// add -DTHREADED_DISPATCH (or any other engine option) to compare
+
+#include "../../mos6502.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <chrono>
+
+uint8_t ram[65536] = {0};
+
+void writeRam(uint16_t addr, uint8_t val)
+{
+   ram[addr] = val;
+}
+
+uint8_t readRam(uint16_t addr)
+{
+   return ram[addr];
+}
+
+struct Workload
+{
+   const char *name;
+   const uint8_t *code;
+   size_t size;
+};
+
+// all workloads are loaded at $0200 and loop forever
+
+// indexed loads/stores, ADC/EOR and two nested DEY/INX loops
+static const uint8_t copy[] = {
+   0xA2, 0x00,             // 0200 LDX #$00
+   0xA0, 0x00,             // 0202 LDY #$00
+   0xB9, 0x00, 0x10,       // 0204 LDA $1000,Y
+   0x18,                   // 0207 CLC
+   0x69, 0x01,             // 0208 ADC #$01
+   0x99, 0x00, 0x20,       // 020A STA $2000,Y
+   0x5D, 0x00, 0x30,       // 020D EOR $3000,X
+   0x88,                   // 0210 DEY
+   0xD0, 0xF1,             // 0211 BNE $0204
+   0xE8,                   // 0213 INX
+   0xD0, 0xEE,             // 0214 BNE $0204
+   0x4C, 0x00, 0x02,       // 0216 JMP $0200
+};
+
+// 16 bit decimal counter
+static const uint8_t bcd[] = {
+   0xF8,                   // 0200 SED
+   0x18,                   // 0201 CLC
+   0xA5, 0x10,             // 0202 LDA $10
+   0x69, 0x01,             // 0204 ADC #$01
+   0x85, 0x10,             // 0206 STA $10
+   0xA5, 0x11,             // 0208 LDA $11
+   0x69, 0x00,             // 020A ADC #$00
+   0x85, 0x11,             // 020C STA $11
+   0xD8,                   // 020E CLD
+   0x4C, 0x00, 0x02,       // 020F JMP $0200
+};
+
+// subroutine calls, stack and shifts
+static const uint8_t calls[] = {
+   0xA9, 0x05,             // 0200 LDA #$05
+   0x20, 0x10, 0x02,       // 0202 JSR $0210
+   0x48,                   // 0205 PHA
+   0x68,                   // 0206 PLA
+   0x4C, 0x00, 0x02,       // 0207 JMP $0200
+   0xEA, 0xEA, 0xEA,       // 020A NOP (padding)
+   0xEA, 0xEA, 0xEA,       // 020D NOP (padding)
+   0x0A,                   // 0210 ASL A
+   0x2A,                   // 0211 ROL A
+   0x6A,                   // 0212 ROR A
+   0x4A,                   // 0213 LSR A
+   0x08,                   // 0214 PHP
+   0x28,                   // 0215 PLP
+   0x60,                   // 0216 RTS
+};
+
+// checksum of $1000-$1FFF through (zp),Y
+static const uint8_t checksum[] = {
+   0xA9, 0x00,             // 0200 LDA #$00
+   0x85, 0xFB,             // 0202 STA $FB
+   0xA9, 0x10,             // 0204 LDA #$10
+   0x85, 0xFC,             // 0206 STA $FC
+   0xA0, 0x00,             // 0208 LDY #$00
+   0xA9, 0x00,             // 020A LDA #$00
+   0x51, 0xFB,             // 020C EOR ($FB),Y
+   0x71, 0xFB,             // 020E ADC ($FB),Y
+   0xC8,                   // 0210 INY
+   0xD0, 0xF9,             // 0211 BNE $020C
+   0xE6, 0xFC,             // 0213 INC $FC
+   0xA6, 0xFC,             // 0215 LDX $FC
+   0xE0, 0x20,             // 0217 CPX #$20
+   0xD0, 0xEF,             // 0219 BNE $020A
+   0x4C, 0x00, 0x02,       // 021B JMP $0200
+};
+
+// raster poll waiting for a line that never comes
+static const uint8_t idle[] = {
+   0xAD, 0x12, 0xD0,       // 0200 LDA $D012
+   0xC9, 0xF8,             // 0203 CMP #$F8
+   0xD0, 0xF9,             // 0205 BNE $0200
+   0x4C, 0x00, 0x02,       // 0207 JMP $0200
+};
+
+static const Workload workloads[] = {
+   { "copy",     copy,     sizeof(copy) },
+   { "bcd",      bcd,      sizeof(bcd) },
+   { "calls",    calls,    sizeof(calls) },
+   { "checksum", checksum, sizeof(checksum) },
+   { "idle",     idle,     sizeof(idle) },
+};
+
+uint32_t hash(void)
+{
+   uint32_t h = 2166136261u;
+   for (int i = 0; i < 65536; i++) {
+      h = (h ^ ram[i]) * 16777619u;
+   }
+   return h;
+}
+
+int main(int argc, char **argv) {
+   // instructions per workload
+   int32_t count = 50000000;
+
+   if (argc == 2) {
+      count = strtol(argv[1], NULL, 0);
+   }
+   else if (argc > 2) {
+      fprintf(stderr, "Usage: %s [instructions]\n", argv[0]);
+      return -1;
+   }
+
+   double total = 0;
+
+   for (size_t w = 0; w < sizeof(workloads) / sizeof(workloads[0]); w++) {
+      memset(ram, 0, sizeof(ram));
+      for (int i = 0x1000; i < 0x4000; i++) {
+         ram[i] = (uint8_t)(i * 7 + (i >> 8));
+      }
+      memcpy(ram + 0x200, workloads[w].code, workloads[w].size);
+      ram[0xFFFC] = 0x00;
+      ram[0xFFFD] = 0x02;
+
+#ifdef BUS_HEADER
+      mos6502_bus bus = { ram };
+      mos6502 cpu(&bus);
+#else
+      mos6502 cpu(readRam, writeRam);
+#endif
+#ifdef MEMORY_MAP
+      // no I/O, all of it can be mapped
+      cpu.MapRAM(0x00, 0xFF, ram);
+#endif
+#ifdef IDLE_LOOPS
+      // plain ram, no side effects anywhere
+      cpu.SetIdleSafe(0x00, 0xFF, true);
+#endif
+      cpu.Reset();
+
+      uint64_t cycles = 0;
+      auto t0 = std::chrono::steady_clock::now();
+      cpu.Run(count, cycles, mos6502::INST_COUNT);
+      auto t1 = std::chrono::steady_clock::now();
+
+      double secs = std::chrono::duration<double>(t1 - t0).count();
+      double mips = count / secs / 1e6;
+      total += secs;
+
+      printf("%-10s %8.2f MIPS  %12llu cycles  ram %08x\n",
+             workloads[w].name, mips, (unsigned long long) cycles, hash());
+
+#ifdef LAZY_FLAGS_STATS
+      uint64_t updates, reads;
+      cpu.GetFlagStats(updates, reads);
+      printf("%-10s %12llu N/Z updates, %llu evaluated, %.1f%% avoided\n", "",
+             (unsigned long long) updates, (unsigned long long) reads,
+             updates ? 100.0 * (updates - (reads < updates ? reads : updates)) / updates : 0.0);
+#endif
+
+#ifdef SUPERINSTRUCTIONS_STATS
+      for (int i = 0; i < cpu.GetPairCount(); i++) {
+         const char *name;
+         uint64_t runs;
+         cpu.GetPairStats(i, name, runs);
+         if (runs) {
+            printf("%-10s %12llu x %s\n", "", (unsigned long long) runs, name);
+         }
+      }
+#endif
+   }
+
+   printf("%-10s %8.2f MIPS\n", "overall",
+          count * (sizeof(workloads) / sizeof(workloads[0])) / total / 1e6);
+
+   return 0;
+}
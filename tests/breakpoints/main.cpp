@@ -0,0 +1,264 @@
+// compile with "g++ -O3 -DBREAKPOINTS main.cpp ../../mos6502.cpp -o main"
+//
+// runs a program with breakpoints and read/write watchpoints set, under
+// IRQs, in slices of random size, and checks every stop against a
+// reference CPU run instruction by instruction on the plain bus: the
+// reason, the address and the exact cycle count. Also prints how fast it
+// runs with nothing set and with a breakpoint and a watchpoint set that
+// are never hit.
+
+#include "../differential.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <chrono>
+#include <vector>
+
+#define STOPS 5000
+
+static const uint8_t program[] = {
+   0xA2, 0x00,             // 0200 LDX #$00
+   0xBD, 0x00, 0x20,       // 0202 LDA $2000,X
+   0x69, 0x01,             // 0205 ADC #$01
+   0x9D, 0x00, 0x30,       // 0207 STA $3000,X
+   0xE8,                   // 020A INX
+   0xD0, 0xF5,             // 020B BNE $0202
+   0xE6, 0x40,             // 020D INC $40
+   0x20, 0x00, 0x03,       // 020F JSR $0300
+   0x4C, 0x00, 0x02,       // 0212 JMP $0200
+};
+
+static const uint8_t routine[] = {
+   0xA5, 0x40,             // 0300 LDA $40
+   0x85, 0x41,             // 0302 STA $41
+   0x60,                   // 0304 RTS
+};
+
+static const uint8_t irq[] = {
+   0x48,                   // 0400 PHA
+   0x8D, 0x00, 0xD0,       // 0401 STA $D000, releases the line
+   0x68,                   // 0404 PLA
+   0x40,                   // 0405 RTI
+};
+
+static const uint16_t breakpoints[] = { 0x0205, 0x0300, 0x0400 };
+static const uint16_t reads[] = { 0x2010, 0x0040 };
+static const uint16_t writes[] = { 0x30F0, 0x0040 };
+
+// what the reference saw during its last instruction
+static bool vectorRead;
+static mos6502::StopReason hit;
+static uint16_t hitAddr;
+
+static void Access(mos6502::StopReason reason, uint16_t addr)
+{
+   if (current != &reference || hit != mos6502::STOP_NONE) return;
+   const uint16_t* list = reason == mos6502::STOP_READ ? reads : writes;
+   for(int i = 0; i < 2; i++)
+   {
+      if (list[i] == addr)
+      {
+         hit = reason;
+         hitAddr = addr;
+      }
+   }
+}
+
+static void Read(uint16_t addr)
+{
+   if (addr == 0xFFFE) vectorRead = true;
+   Access(mos6502::STOP_READ, addr);
+}
+
+static void Write(uint16_t addr, uint8_t value)
+{
+   if (addr == 0xD000) current->cpu->IRQ(true);
+   Access(mos6502::STOP_WRITE, addr);
+}
+
+static void Program(uint8_t* ram)
+{
+   memcpy(ram + 0x0200, program, sizeof(program));
+   memcpy(ram + 0x0300, routine, sizeof(routine));
+   memcpy(ram + 0x0400, irq, sizeof(irq));
+   for(int i = 0; i < 256; i++)
+   {
+      ram[0x2000 + i] = i * 7;
+   }
+   ram[0xFFFC] = 0x00; ram[0xFFFD] = 0x02;
+   ram[0xFFFE] = 0x00; ram[0xFFFF] = 0x04;
+}
+
+static void IrqEvent(mos6502* cpu, void* ctx, uint64_t when, uint64_t now)
+{
+   cpu->IRQ(false);
+   cpu->ScheduleEvent(when + 1499, &IrqEvent);
+}
+
+static bool IsBreakpoint(uint16_t addr)
+{
+   for(uint16_t b : breakpoints)
+   {
+      if (b == addr) return true;
+   }
+   return false;
+}
+
+static double Seconds(std::chrono::steady_clock::time_point start)
+{
+   return std::chrono::duration<double>(
+         std::chrono::steady_clock::now() - start).count();
+}
+
+static const char* Name(int reason)
+{
+   static const char* names[] = { "none", "breakpoint", "read", "write" };
+   return names[reason];
+}
+
+struct Stop
+{
+   uint64_t cycle;
+   int reason;
+   uint16_t addr;
+};
+
+int main(int argc, char **argv)
+{
+   mos6502 cpu(read, write);
+   mos6502 ref(read, write);
+   Setup(tested, cpu);
+   Setup(reference, ref);
+   onRead = Read;
+   onWrite = Write;
+#ifdef MEMORY_MAP
+   cpu.MapRAM(0x00, 0xCF, tested.ram);
+#endif
+   for(uint16_t b : breakpoints)
+   {
+      cpu.SetBreakpoint(b, true);
+   }
+   for(uint16_t r : reads)
+   {
+      cpu.SetWatchpoint(r, mos6502::WATCH_READ | (r == 0x0040 ? mos6502::WATCH_WRITE : 0));
+   }
+   cpu.SetWatchpoint(0x30F0, mos6502::WATCH_WRITE);
+
+   uint64_t cycles = 0;
+   uint64_t refCycles = 0;
+   current = &tested;
+   cpu.Reset();
+   cpu.ScheduleEvent(700, &IrqEvent);
+   current = &reference;
+   ref.Reset();
+   ref.ScheduleEvent(700, &IrqEvent);
+
+   // the stops the reference sees: before an instruction at a breakpoint,
+   // after one reading or writing a watched address, the first one it
+   // touches
+   std::vector<Stop> expected;
+   while(expected.size() < STOPS)
+   {
+      uint16_t pc = ref.GetPC();
+      uint64_t before = refCycles;
+      vectorRead = false;
+      hit = mos6502::STOP_NONE;
+      ref.Run(1, refCycles, mos6502::INST_COUNT);
+
+      // an IRQ was taken first, the instruction was the handler's
+      if (vectorRead)
+      {
+         pc = 0x0400;
+         before += 6;
+      }
+      if (IsBreakpoint(pc)) expected.push_back({ before, mos6502::STOP_BREAKPOINT, pc });
+      if (hit != mos6502::STOP_NONE) expected.push_back({ refCycles, hit, hitAddr });
+   }
+
+   // the tested CPU, each stop then on from there
+   current = &tested;
+   uint32_t seed = 0x6502;
+   int count[4] = { 0, 0, 0, 0 };
+   for(int i = 0; i < STOPS; i++)
+   {
+      do
+      {
+         seed = seed * 1103515245 + 12345;
+         cpu.Run(1 + (seed >> 8) % 3000, cycles);
+      } while(cpu.GetStopReason() == mos6502::STOP_NONE);
+
+      const Stop& e = expected[i];
+      int reason = cpu.GetStopReason();
+      if (reason != e.reason || cpu.GetStopAddress() != e.addr || cycles != e.cycle ||
+            (reason == mos6502::STOP_BREAKPOINT && cpu.GetPC() != e.addr))
+      {
+         printf("FAIL: stop %d\n", i);
+         printf("tested:    %s at %04X, cycle %llu, pc %04X\n", Name(reason),
+               cpu.GetStopAddress(), (unsigned long long)cycles, cpu.GetPC());
+         printf("reference: %s at %04X, cycle %llu\n", Name(e.reason), e.addr,
+               (unsigned long long)e.cycle);
+         return 1;
+      }
+      count[reason]++;
+   }
+   if (!count[mos6502::STOP_BREAKPOINT] || !count[mos6502::STOP_READ] ||
+         !count[mos6502::STOP_WRITE])
+   {
+      printf("FAIL: not every kind of stop was seen\n");
+      return 1;
+   }
+
+#ifdef MEMORY_MAP
+   // the watched pages are still part of the RAM
+   static uint8_t image[65536];
+   if (cpu.SaveRAM(image) != 0xD0 || memcmp(image, tested.ram, 0xD000))
+   {
+      printf("FAIL: SaveRAM() misses the watched pages\n");
+      return 1;
+   }
+#endif
+
+   // with everything cleared, no more stops
+   cpu.ClearBreakpoints();
+   for(int i = 0; i < 100; i++)
+   {
+      cpu.Run(10000, cycles);
+      if (cpu.GetStopReason() != mos6502::STOP_NONE)
+      {
+         printf("FAIL: a stop after ClearBreakpoints()\n");
+         return 1;
+      }
+   }
+
+   // throughput, with nothing set and with what is never hit
+   const int64_t total = 20000000;
+   auto start = std::chrono::steady_clock::now();
+   for(int64_t n = 0; n < total; n += 10000)
+   {
+      cpu.Run(10000, cycles, mos6502::INST_COUNT);
+   }
+   double offSeconds = Seconds(start);
+
+   cpu.SetBreakpoint(0x0500, true);
+   cpu.SetWatchpoint(0x7000, mos6502::WATCH_READ | mos6502::WATCH_WRITE);
+   start = std::chrono::steady_clock::now();
+   for(int64_t n = 0; n < total; n += 10000)
+   {
+      cpu.Run(10000, cycles, mos6502::INST_COUNT);
+   }
+   double onSeconds = Seconds(start);
+   if (cpu.GetStopReason() != mos6502::STOP_NONE)
+   {
+      printf("FAIL: a stop on what is never run nor touched\n");
+      return 1;
+   }
+
+   printf("%d stops in slices (%d breakpoints, %d reads, %d writes): every one matches "
+         "the reference\n", STOPS, count[mos6502::STOP_BREAKPOINT],
+         count[mos6502::STOP_READ], count[mos6502::STOP_WRITE]);
+   printf("%.1f MIPS with nothing set, %.1f MIPS with a breakpoint and a watchpoint set\n",
+         total / offSeconds / 1e6, total / onSeconds / 1e6);
+   return 0;
+}
@@ -0,0 +1,175 @@
+// compile with "g++ -O3 -DBUS_CONTEXT main.cpp ../../mos6502.cpp -o main"
+//
+// runs many machines side by side, each with its own memory behind a
+// context-carrying bus, plus one old-style machine on global callbacks.
+// They all run the same program from a different seed, in interleaved
+// slices. Afterwards every machine is run again alone, in one go, and
+// must end up in the same state: nothing leaked from one to another.
+
+#include "../../mos6502.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdint.h>
+
+#define MACHINES 1000
+#define SEED     0x10
+#define PORT     0xD000     // counts the writes to it
+#define CODE     0x0200
+
+struct Machine
+{
+   mos6502* cpu;
+   uint8_t ram[65536];
+   uint32_t portWrites;
+   uint64_t ticked;         // cycles seen by the clock cycle callback
+   uint64_t cycles;         // cycles counted by Run()
+   uint64_t instructions;
+};
+
+uint8_t read(void* ctx, uint16_t addr)
+{
+   return ((Machine*)ctx)->ram[addr];
+}
+
+void write(void* ctx, uint16_t addr, uint8_t val)
+{
+   Machine* m = (Machine*)ctx;
+   if (addr == PORT) m->portWrites++;
+   m->ram[addr] = val;
+}
+
+void tick(mos6502* cpu, uint32_t n, uint64_t stamp)
+{
+   Machine* m = (Machine*)cpu->GetContext();
+   if (m) m->ticked += n;
+}
+
+// the old-style machine
+Machine legacy;
+
+uint8_t readLegacy(uint16_t addr)
+{
+   return read(&legacy, addr);
+}
+
+void writeLegacy(uint16_t addr, uint8_t val)
+{
+   write(&legacy, addr, val);
+}
+
+static const uint8_t program[] = {
+   0xA5, SEED,             // 0200 LDA SEED
+   0xA2, 0x00,             // 0202 LDX #0
+   0x18,                   // 0204 CLC
+   0x69, 0x07,             // 0205 ADC #7
+   0x9D, 0x00, 0x10,       // 0207 STA $1000,X
+   0x45, 0x11,             // 020A EOR $11
+   0x8D, 0x00, 0xD0,       // 020C STA PORT
+   0xE8,                   // 020F INX
+   0xD0, 0xF2,             // 0210 BNE $0204
+   0xE6, 0x11,             // 0212 INC $11
+   0x85, SEED,             // 0214 STA SEED
+   0x4C, 0x00, 0x02,       // 0216 JMP $0200
+};
+
+void Setup(Machine* m, mos6502* cpu, uint8_t seed)
+{
+   m->cpu = cpu;
+   m->portWrites = 0;
+   m->ticked = 0;
+   m->cycles = 0;
+   m->instructions = 0;
+   memset(m->ram, 0, sizeof(m->ram));
+   memcpy(m->ram + CODE, program, sizeof(program));
+   m->ram[SEED] = seed;
+   m->ram[0xFFFC] = CODE & 0xFF;
+   m->ram[0xFFFD] = CODE >> 8;
+#ifdef MEMORY_MAP
+   cpu->MapRAM(0x00, 0xCF, m->ram);
+   cpu->MapRAM(0xD1, 0xFF, m->ram + 0xD100);
+#endif
+   cpu->Reset();
+}
+
+bool Same(Machine* a, Machine* b)
+{
+   return a->cpu->GetPC() == b->cpu->GetPC() &&
+      a->cpu->GetA() == b->cpu->GetA() &&
+      a->cpu->GetX() == b->cpu->GetX() &&
+      a->cpu->GetP() == b->cpu->GetP() &&
+      a->cycles == b->cycles &&
+      a->portWrites == b->portWrites &&
+      !memcmp(a->ram, b->ram, sizeof(a->ram));
+}
+
+int main(int argc, char **argv)
+{
+   int rounds = argc > 1 ? atoi(argv[1]) : 50;
+
+   static Machine machines[MACHINES];
+   mos6502* cpus[MACHINES];
+   for(int i = 0; i < MACHINES; i++)
+   {
+      // a clock cycle callback on half of them, it keeps the JIT off
+      cpus[i] = new mos6502(read, write, &machines[i], (i & 1) ? nullptr : tick);
+      Setup(&machines[i], cpus[i], (uint8_t)i);
+   }
+   mos6502 legacyCpu(readLegacy, writeLegacy);
+   Setup(&legacy, &legacyCpu, 0x42);
+
+   // interleaved slices, counted in instructions so that they add up
+   // exactly to a single run of the same length
+   uint32_t seed = 1;
+   for(int round = 0; round < rounds; round++)
+   {
+      for(int i = 0; i <= MACHINES; i++)
+      {
+         Machine* m = i < MACHINES ? &machines[i] : &legacy;
+         seed = seed * 1103515245 + 12345;
+         int32_t slice = 1 + (seed >> 8) % 500;
+         m->cpu->Run(slice, m->cycles, mos6502::INST_COUNT);
+         m->instructions += slice;
+      }
+   }
+
+   if (legacyCpu.GetContext())
+   {
+      printf("FAIL: old-style machine has a context\n");
+      return 1;
+   }
+
+   static Machine alone;
+   uint64_t cycles = 0;
+   for(int i = 0; i <= MACHINES; i++)
+   {
+      Machine* m = i < MACHINES ? &machines[i] : &legacy;
+      mos6502 cpu(read, write, &alone);
+      Setup(&alone, &cpu, i < MACHINES ? (uint8_t)i : 0x42);
+      cpu.Run(m->instructions, alone.cycles, mos6502::INST_COUNT);
+
+      if (!Same(m, &alone) || (i < MACHINES && !(i & 1) && m->ticked != m->cycles))
+      {
+         printf("FAIL: machine %d\n", i);
+         printf("side by side: pc %04X a %02X cycles %llu ticked %llu port %u\n",
+               m->cpu->GetPC(), m->cpu->GetA(),
+               (unsigned long long)m->cycles, (unsigned long long)m->ticked,
+               m->portWrites);
+         printf("alone:        pc %04X a %02X cycles %llu port %u\n",
+               cpu.GetPC(), cpu.GetA(),
+               (unsigned long long)alone.cycles, alone.portWrites);
+         return 1;
+      }
+      cycles += m->cycles;
+   }
+
+   for(int i = 0; i < MACHINES; i++)
+   {
+      delete cpus[i];
+   }
+
+   printf("%d machines, %llu cycles: no machine saw another\n",
+         MACHINES + 1, (unsigned long long)cycles);
+   return 0;
+}
@@ -0,0 +1,343 @@
+// compile with "g++ -O3 -DPERF_COUNTERS main.cpp ../../mos6502.cpp -o main"
+//
+// runs a program touching every addressing mode in slices, then checks
+// the performance counters against a reference CPU run instruction by
+// instruction: instructions, cycles, every opcode and mode, page crossing
+// penalties, taken and not taken branches, pushes and pops. Then runs an
+// idle loop under IRQs and NMIs and checks the interrupts serviced and
+// that the counters add up to the cycles run.
+
+#include "../differential.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdint.h>
+
+#define CYCLES 3000000
+
+static const uint8_t program[] = {
+   0xA2, 0x00,             // 0200 LDX #$00
+   0xA9, 0x37,             // 0202 LDA #$37
+   0x9D, 0xF0, 0x10,       // 0204 STA $10F0,X
+   0x7D, 0xF0, 0x10,       // 0207 ADC $10F0,X
+   0x20, 0x00, 0x03,       // 020A JSR $0300
+   0xE8,                   // 020D INX
+   0xD0, 0xF2,             // 020E BNE $0202
+   0xE6, 0x40,             // 0210 INC $40
+   0xA4, 0x40,             // 0212 LDY $40
+   0xB1, 0x30,             // 0214 LDA ($30),Y
+   0x2A,                   // 0216 ROL A
+   0xB9, 0x80, 0x20,       // 0217 LDA $2080,Y
+   0xB5, 0x41,             // 021A LDA $41,X
+   0xB6, 0x42,             // 021C LDX $42,Y
+   0xA1, 0x44,             // 021E LDA ($44,X)
+   0x20, 0x00, 0x03,       // 0220 JSR $0300
+   0x6C, 0x50, 0x00,       // 0223 JMP ($0050)
+};
+
+static const uint8_t routine[] = {
+   0x48,                   // 0300 PHA
+   0x45, 0x41,             // 0301 EOR $41
+   0x85, 0x41,             // 0303 STA $41
+   0x68,                   // 0305 PLA
+   0x60,                   // 0306 RTS
+};
+
+// waits for the IRQs, which count down $60
+static const uint8_t idle[] = {
+   0xA5, 0x60,             // 0500 LDA $60
+   0xF0, 0xFC,             // 0502 BEQ $0500
+   0xC6, 0x60,             // 0504 DEC $60
+   0x4C, 0x00, 0x05,       // 0506 JMP $0500
+};
+
+static const uint8_t irq[] = {
+   0x48,                   // 0600 PHA
+   0xE6, 0x60,             // 0601 INC $60
+   0x8D, 0x00, 0xD0,       // 0603 STA $D000, releases the line
+   0x68,                   // 0606 PLA
+   0x40,                   // 0607 RTI
+};
+
+static const uint8_t nmi[] = {
+   0x8D, 0x01, 0xD0,       // 0610 STA $D001
+   0x40,                   // 0613 RTI
+};
+
+// what the reference knows of the opcodes above
+struct Opcode
+{
+   uint8_t op;
+   mos6502::AddrMode mode;
+   uint8_t cycles;
+   uint8_t pushes;
+   uint8_t pops;
+};
+
+static const Opcode opcodes[] = {
+   { 0xA2, mos6502::MODE_IMM, 2, 0, 0 },
+   { 0xA9, mos6502::MODE_IMM, 2, 0, 0 },
+   { 0x9D, mos6502::MODE_ABX, 5, 0, 0 },
+   { 0x7D, mos6502::MODE_ABX, 4, 0, 0 },
+   { 0x20, mos6502::MODE_ABS, 6, 2, 0 },
+   { 0xE8, mos6502::MODE_IMP, 2, 0, 0 },
+   { 0xD0, mos6502::MODE_REL, 2, 0, 0 },
+   { 0xE6, mos6502::MODE_ZER, 5, 0, 0 },
+   { 0xA4, mos6502::MODE_ZER, 3, 0, 0 },
+   { 0xB1, mos6502::MODE_INY, 5, 0, 0 },
+   { 0x2A, mos6502::MODE_ACC, 2, 0, 0 },
+   { 0xB9, mos6502::MODE_ABY, 4, 0, 0 },
+   { 0xB5, mos6502::MODE_ZEX, 4, 0, 0 },
+   { 0xB6, mos6502::MODE_ZEY, 4, 0, 0 },
+   { 0xA1, mos6502::MODE_INX, 6, 0, 0 },
+   { 0x6C, mos6502::MODE_ABI, 5, 0, 0 },
+   { 0x48, mos6502::MODE_IMP, 3, 1, 0 },
+   { 0x45, mos6502::MODE_ZER, 3, 0, 0 },
+   { 0x85, mos6502::MODE_ZER, 3, 0, 0 },
+   { 0x68, mos6502::MODE_IMP, 4, 0, 1 },
+   { 0x60, mos6502::MODE_IMP, 6, 0, 2 },
+   { 0xA5, mos6502::MODE_ZER, 3, 0, 0 },
+   { 0xF0, mos6502::MODE_REL, 2, 0, 0 },
+   { 0xC6, mos6502::MODE_ZER, 5, 0, 0 },
+   { 0x4C, mos6502::MODE_ABS, 3, 0, 0 },
+   { 0x8D, mos6502::MODE_ABS, 4, 0, 0 },
+   { 0x40, mos6502::MODE_IMP, 6, 0, 3 },
+};
+
+static const Opcode* Find(uint8_t op)
+{
+   for(const Opcode& o : opcodes)
+   {
+      if (o.op == op) return &o;
+   }
+   return nullptr;
+}
+
+static uint64_t irqsAcked;
+static uint64_t nmisSeen;
+static bool interrupting;
+
+static void Write(uint16_t addr, uint8_t value)
+{
+   if (addr == 0xD000)
+   {
+      irqsAcked++;
+      current->cpu->IRQ(true);
+   }
+   if (addr == 0xD001) nmisSeen++;
+}
+
+static void Program(uint8_t* ram)
+{
+   memcpy(ram + 0x0200, program, sizeof(program));
+   memcpy(ram + 0x0300, routine, sizeof(routine));
+   memcpy(ram + 0x0500, idle, sizeof(idle));
+   memcpy(ram + 0x0600, irq, sizeof(irq));
+   memcpy(ram + 0x0610, nmi, sizeof(nmi));
+   ram[0x30] = 0xC0; ram[0x31] = 0x20;
+   ram[0x50] = 0x00; ram[0x51] = 0x02;
+   ram[0xFFFA] = 0x10; ram[0xFFFB] = 0x06;
+   ram[0xFFFC] = 0x00; ram[0xFFFD] = 0x02;
+   ram[0xFFFE] = 0x00; ram[0xFFFF] = 0x06;
+}
+
+static void IrqEvent(mos6502* cpu, void* ctx, uint64_t when, uint64_t now)
+{
+   if (!interrupting) return;
+   cpu->IRQ(false);
+   cpu->ScheduleEvent(when + 997, &IrqEvent);
+}
+
+static void NmiEvent(mos6502* cpu, void* ctx, uint64_t when, uint64_t now)
+{
+   if (!interrupting) return;
+   cpu->NMI(false);
+   cpu->NMI(true);
+   cpu->ScheduleEvent(when + 3001, &NmiEvent);
+}
+
+static bool Same(const char* what, uint64_t counted, uint64_t expected)
+{
+   if (counted == expected) return true;
+   printf("FAIL: %s counted %llu, expected %llu\n", what,
+         (unsigned long long)counted, (unsigned long long)expected);
+   return false;
+}
+
+int main(int argc, char **argv)
+{
+   mos6502 c(read, write);
+   mos6502 ref(read, write);
+   Setup(tested, c);
+   Setup(reference, ref);
+   onWrite = Write;
+#ifdef MEMORY_MAP
+   c.MapRAM(0x00, 0xCF, tested.ram);
+   ref.MapRAM(0x00, 0xCF, reference.ram);
+#endif
+#ifdef IDLE_LOOPS
+   c.SetIdleSafe(0x00, 0x0F, true);
+#endif
+
+   // a while first, for the JIT to compile something, then from zero
+   uint64_t cycles = 0;
+   uint64_t refCycles = 0;
+   current = &tested;
+   c.Reset();
+   c.Run(20000, cycles, mos6502::INST_COUNT);
+   current = &reference;
+   ref.Reset();
+   ref.Run(20000, refCycles, mos6502::INST_COUNT);
+
+   c.ClearPerfCounters();
+   const mos6502::PerfCounters& perf = c.GetPerfCounters();
+   if (perf.instructions || perf.cycles || perf.opcodes[0xA9] || perf.pushes)
+   {
+      printf("FAIL: the counters are not zero after ClearPerfCounters()\n");
+      return 1;
+   }
+
+   // the counted run, in slices of random size
+   current = &tested;
+   uint64_t start = cycles;
+   uint32_t seed = 0x6502;
+   while(cycles < start + CYCLES)
+   {
+      seed = seed * 1103515245 + 12345;
+      c.Run(1 + (seed >> 8) % 5000, cycles);
+   }
+
+   // the reference, one instruction at a time up to the same cycle
+   mos6502::PerfCounters expected;
+   memset(&expected, 0, sizeof(expected));
+   current = &reference;
+   while(refCycles < cycles)
+   {
+      uint16_t pc = ref.GetPC();
+      const Opcode* o = Find(reference.ram[pc]);
+      if (!o)
+      {
+         printf("FAIL: the reference ran into opcode %02X at %04X\n", reference.ram[pc], pc);
+         return 1;
+      }
+      uint64_t before = refCycles;
+      ref.Run(1, refCycles, mos6502::INST_COUNT);
+      uint64_t took = refCycles - before;
+
+      expected.instructions++;
+      expected.cycles += took;
+      expected.opcodes[o->op]++;
+      expected.modes[o->mode]++;
+      expected.pushes += o->pushes;
+      expected.pops += o->pops;
+      uint64_t penalty = took - o->cycles;
+      if (o->mode == mos6502::MODE_REL)
+      {
+         bool taken = ref.GetPC() != (uint16_t)(pc + 2);
+         if (taken) expected.branchesTaken++;
+         else expected.branchesNotTaken++;
+         penalty -= taken;
+      }
+      expected.crossings += penalty;
+   }
+   if (refCycles != cycles)
+   {
+      printf("FAIL: the reference ends at cycle %llu, the counted run at %llu\n",
+            (unsigned long long)refCycles, (unsigned long long)cycles);
+      return 1;
+   }
+
+   bool ok = Same("instructions", perf.instructions, expected.instructions) &&
+      Same("cycles", perf.cycles, cycles - start) &&
+      Same("cycles", perf.cycles, expected.cycles) &&
+      Same("crossings", perf.crossings, expected.crossings) &&
+      Same("taken branches", perf.branchesTaken, expected.branchesTaken) &&
+      Same("branches not taken", perf.branchesNotTaken, expected.branchesNotTaken) &&
+      Same("pushes", perf.pushes, expected.pushes) &&
+      Same("pops", perf.pops, expected.pops) &&
+      Same("IRQs", perf.irqs, 0) &&
+      Same("NMIs", perf.nmis, 0);
+   for(int i = 0; ok && i < 256; i++)
+   {
+      char what[32];
+      snprintf(what, sizeof(what), "opcode %02X", i);
+      ok = Same(what, perf.opcodes[i], expected.opcodes[i]);
+   }
+   for(int i = 0; ok && i < mos6502::MODE_COUNT; i++)
+   {
+      char what[32];
+      snprintf(what, sizeof(what), "mode %d", i);
+      ok = Same(what, perf.modes[i], expected.modes[i]) && expected.modes[i] > 0;
+   }
+   if (!ok) return 1;
+   if (!perf.crossings || !perf.branchesTaken || !perf.branchesNotTaken)
+   {
+      printf("FAIL: the program did not cross pages and branch both ways\n");
+      return 1;
+   }
+   mos6502::PerfCounters first = perf;
+
+   // the idle loop under interrupts: every instruction is counted and the
+   // interrupt entries make up the rest of the cycles
+   current = &tested;
+   c.ClearPerfCounters();
+   c.SetPC(0x0500);
+   interrupting = true;
+   c.ScheduleEvent(cycles + 500, &IrqEvent);
+   c.ScheduleEvent(cycles + 700, &NmiEvent);
+   start = cycles;
+   while(cycles < start + CYCLES)
+   {
+      seed = seed * 1103515245 + 12345;
+      c.Run(1 + (seed >> 8) % 5000, cycles);
+   }
+   // the handlers still running finish
+   interrupting = false;
+   c.Run(1000, cycles);
+
+   uint64_t instructions = 0;
+   uint64_t modes = 0;
+   uint64_t pushes = 0;
+   uint64_t pops = 0;
+   for(int i = 0; i < 256; i++)
+   {
+      instructions += perf.opcodes[i];
+      const Opcode* o = Find(i);
+      if (o)
+      {
+         pushes += perf.opcodes[i] * o->pushes;
+         pops += perf.opcodes[i] * o->pops;
+      }
+   }
+   for(int i = 0; i < mos6502::MODE_COUNT; i++)
+   {
+      modes += perf.modes[i];
+   }
+   uint64_t interrupts = perf.irqs + perf.nmis;
+   ok = Same("IRQs", perf.irqs, irqsAcked) &&
+      Same("NMIs", perf.nmis, nmisSeen) &&
+      Same("instructions", perf.instructions, instructions) &&
+      Same("instructions", perf.instructions, modes) &&
+      Same("cycles", perf.cycles + 6 * interrupts, cycles - start) &&
+      Same("branches", perf.branchesTaken + perf.branchesNotTaken, perf.opcodes[0xF0]) &&
+      Same("pushes", perf.pushes, pushes + 3 * interrupts) &&
+      Same("pops", perf.pops, pops);
+   if (!ok) return 1;
+   if (perf.irqs < 1000 || perf.nmis < 500)
+   {
+      printf("FAIL: only %llu IRQs and %llu NMIs\n",
+            (unsigned long long)perf.irqs, (unsigned long long)perf.nmis);
+      return 1;
+   }
+
+   printf("%llu instructions counted in slices: every counter matches the reference, "
+         "%llu crossings, %llu/%llu branches taken\n",
+         (unsigned long long)first.instructions, (unsigned long long)first.crossings,
+         (unsigned long long)first.branchesTaken,
+         (unsigned long long)(first.branchesTaken + first.branchesNotTaken));
+   printf("%llu instructions of idle loop, %llu IRQs and %llu NMIs: the counters add up\n",
+         (unsigned long long)perf.instructions, (unsigned long long)perf.irqs,
+         (unsigned long long)perf.nmis);
+   return 0;
+}
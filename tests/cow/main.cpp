@@ -0,0 +1,260 @@
+// compile with "g++ -O3 -DBUS_CONTEXT -DMEMORY_MAP main.cpp
+// ../../mos6502.cpp ../../mos6502_cow.cpp -o main"
+//
+// forks machines from each other at random, runs them with different data
+// and checks each one against a reference CPU that got a full copy of the
+// memory, CPU and device state at every fork: registers, cycles and the
+// whole memory must match. Also prints what a fork costs.
+
+#include "../../mos6502_cow.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <chrono>
+
+#define MACHINES 16
+#define ROUNDS   3000
+#define IO_COUNT 0xE000    // counts its own reads
+#define DATA     0x10      // differs from machine to machine
+
+// self-modifying, with stores sweeping over pages $20-$CF
+static const uint8_t program[] = {
+   0xA2, 0x00,             // 0200 LDX #$00
+   0xBD, 0x00, 0x10,       // 0202 LDA $1000,X
+   0x69, 0x03,             // 0205 ADC #$03      operand changed below
+   0x9D, 0x00, 0x10,       // 0207 STA $1000,X
+   0xEE, 0x06, 0x02,       // 020A INC $0206
+   0xE8,                   // 020D INX
+   0xD0, 0xF2,             // 020E BNE $0202
+   0xA4, DATA,             // 0210 LDY DATA
+   0xAD, 0x00, 0xE0,       // 0212 LDA IO_COUNT
+   0x91, 0x30,             // 0215 STA ($30),Y
+   0xE6, 0x31,             // 0217 INC $31
+   0xA5, 0x31,             // 0219 LDA $31
+   0xC9, 0xD0,             // 021B CMP #$D0
+   0x90, 0x04,             // 021D BCC $0223
+   0xA9, 0x20,             // 021F LDA #$20
+   0x85, 0x31,             // 0221 STA $31
+   0x4C, 0x00, 0x02,       // 0223 JMP $0200
+};
+
+struct Device
+{
+   uint8_t count;
+};
+
+uint8_t ioRead(mos6502_cow* machine, uint16_t addr)
+{
+   Device* d = (Device*)machine->GetContext();
+   return addr == IO_COUNT ? d->count++ : 0x00;
+}
+
+void ioWrite(mos6502_cow* machine, uint16_t addr, uint8_t value)
+{
+}
+
+// the reference: plain memory, every access through the bus
+struct Reference
+{
+   mos6502* cpu;
+   uint8_t ram[65536];
+   Device device;
+   uint64_t cycles;
+};
+
+uint8_t refRead(void* ctx, uint16_t addr)
+{
+   Reference* r = (Reference*)ctx;
+   if ((addr >> 8) == 0xE0) return addr == IO_COUNT ? r->device.count++ : 0x00;
+   return r->ram[addr];
+}
+
+void refWrite(void* ctx, uint16_t addr, uint8_t value)
+{
+   Reference* r = (Reference*)ctx;
+   if ((addr >> 8) != 0xE0) r->ram[addr] = value;
+}
+
+static mos6502_cow* machines[MACHINES];
+static Device devices[MACHINES];
+static uint64_t cycles[MACHINES];
+static Reference refs[MACHINES];
+
+static uint32_t seed = 0x6502;
+
+static uint32_t rnd()
+{
+   seed ^= seed << 13;
+   seed ^= seed >> 17;
+   seed ^= seed << 5;
+   return seed;
+}
+
+// machine b becomes a fork of machine a, reference b a copy of reference a
+static void Fork(int a, int b)
+{
+   machines[a]->Fork(*machines[b]);
+#ifdef BREAKPOINTS
+   // maps every page again from the page table the core keeps
+   machines[a]->GetCpu()->ClearBreakpoints();
+   machines[b]->GetCpu()->ClearBreakpoints();
+#endif
+   devices[b] = devices[a];
+   cycles[b] = cycles[a];
+
+   mos6502::State state;
+   refs[a].cpu->SaveState(state);
+   refs[b].cpu->LoadState(state);
+   memcpy(refs[b].ram, refs[a].ram, sizeof(refs[b].ram));
+   refs[b].device = refs[a].device;
+   refs[b].cycles = refs[a].cycles;
+}
+
+static bool Compare(int i, int round, bool memory)
+{
+   mos6502* c = machines[i]->GetCpu();
+   mos6502* r = refs[i].cpu;
+   int diff = -1;
+   if (memory)
+   {
+      for(int a = 0; a < 65536 && diff < 0; a++)
+      {
+         if ((a >> 8) != 0xE0 && machines[i]->Peek(a) != refs[i].ram[a]) diff = a;
+      }
+   }
+
+   if (c->GetPC() == r->GetPC() && c->GetA() == r->GetA() &&
+       c->GetX() == r->GetX() && c->GetY() == r->GetY() &&
+       c->GetS() == r->GetS() && c->GetP() == r->GetP() &&
+       cycles[i] == refs[i].cycles && devices[i].count == refs[i].device.count &&
+       diff < 0)
+   {
+      return true;
+   }
+
+   printf("FAIL: machine %d, round %d\n", i, round);
+   printf("fork:      pc %04X a %02X x %02X y %02X s %02X p %02X cycles %llu count %02X\n",
+         c->GetPC(), c->GetA(), c->GetX(), c->GetY(), c->GetS(), c->GetP(),
+         (unsigned long long)cycles[i], devices[i].count);
+   printf("reference: pc %04X a %02X x %02X y %02X s %02X p %02X cycles %llu count %02X\n",
+         r->GetPC(), r->GetA(), r->GetX(), r->GetY(), r->GetS(), r->GetP(),
+         (unsigned long long)refs[i].cycles, refs[i].device.count);
+   if (diff >= 0)
+   {
+      printf("ram: %04X fork %02X reference %02X\n",
+            diff, machines[i]->Peek(diff), refs[i].ram[diff]);
+   }
+   return false;
+}
+
+int main(int argc, char **argv)
+{
+   for(int i = 0; i < MACHINES; i++)
+   {
+      machines[i] = new mos6502_cow(ioRead, ioWrite, &devices[i]);
+      machines[i]->MapIO(0xE0, 0xE0);
+      refs[i].cpu = new mos6502(refRead, refWrite, &refs[i]);
+   }
+
+   // the root, machine 0, every other one starts as a fork of it
+   mos6502_cow* root = machines[0];
+   root->Load(0x0200, program, sizeof(program));
+   root->Poke(0x30, 0x00);
+   root->Poke(0x31, 0x20);
+   root->Poke(0xFFFC, 0x00);
+   root->Poke(0xFFFD, 0x02);
+   root->GetCpu()->Reset();
+   for(int a = 0; a < 65536; a++)
+   {
+      refs[0].ram[a] = root->Peek(a);
+   }
+   refs[0].cpu->Reset();
+   for(int i = 1; i < MACHINES; i++)
+   {
+      Fork(0, i);
+   }
+
+   int shared = 0;
+   for(int round = 0; round < ROUNDS; round++)
+   {
+      if (rnd() % 4 == 0)
+      {
+         int a = rnd() % MACHINES;
+         int b = rnd() % MACHINES;
+         if (a != b) Fork(a, b);
+      }
+
+      for(int i = 0; i < MACHINES; i++)
+      {
+         uint32_t r = rnd();
+         if (r % 3 == 0)
+         {
+            machines[i]->Poke(DATA, r >> 8);
+            refs[i].ram[DATA] = r >> 8;
+         }
+         int32_t budget = 1 + (r >> 16) % 3000;
+         machines[i]->GetCpu()->Run(budget, cycles[i]);
+         refs[i].cpu->Run(budget, refs[i].cycles);
+
+         if (!Compare(i, round, round % 100 == 99 || round == ROUNDS - 1))
+         {
+            return 1;
+         }
+         shared += machines[i]->GetSharedPages();
+      }
+   }
+
+   uint64_t copies = 0;
+   for(int i = 0; i < MACHINES; i++)
+   {
+      copies += machines[i]->GetCopies();
+   }
+   if (!shared || !copies)
+   {
+      printf("FAIL: no page was ever shared (%d) or copied (%llu)\n",
+            shared, (unsigned long long)copies);
+      return 1;
+   }
+
+   // what a fork costs: root into the same child again and again, then
+   // the child writing to the pages $10-$CF, the first write to each
+   // copies it
+   const int n = 1000000;
+   auto start = std::chrono::steady_clock::now();
+   for(int i = 0; i < n; i++)
+   {
+      root->Fork(*machines[1]);
+   }
+   double forkNs = std::chrono::duration<double, std::nano>(
+         std::chrono::steady_clock::now() - start).count() / n;
+
+   const int k = 10000;
+   double writeNs = 0;
+   for(int i = 0; i < k; i++)
+   {
+      root->Fork(*machines[1]);
+      start = std::chrono::steady_clock::now();
+      for(int page = 0x10; page < 0xD0; page++)
+      {
+         machines[1]->Poke(page << 8, i);
+      }
+      writeNs += std::chrono::duration<double, std::nano>(
+            std::chrono::steady_clock::now() - start).count();
+   }
+   writeNs /= k * (0xD0 - 0x10);
+
+   printf("%d machines, %d rounds: forks and references agree, "
+         "%.1f pages shared on average, %llu copied\n", MACHINES, ROUNDS,
+         (double)shared / (MACHINES * ROUNDS), (unsigned long long)copies);
+   printf("Fork(): %.0f ns (%.1f million per second), first write to a page: %.0f ns\n",
+         forkNs, 1000.0 / forkNs, writeNs);
+
+   for(int i = 0; i < MACHINES; i++)
+   {
+      delete machines[i];
+      delete refs[i].cpu;
+   }
+   return 0;
+}
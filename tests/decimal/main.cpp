@@ -0,0 +1,189 @@
+// compile with "g++ -O3 -DILLEGAL_OPCODES main.cpp ../../mos6502.cpp -o main"
+//
+// runs ADC, SBC, RRA and ISC for every accumulator, operand, carry and
+// decimal flag and compares A and P with the reference arithmetic below
+
+#include "../../mos6502.h"
+
+#include <stdio.h>
+#include <stdint.h>
+
+#define NEGATIVE  0x80
+#define OVERFLOW  0x40
+#define CONSTANT  0x20
+#define BREAK     0x10
+#define DECIMAL   0x08
+#define ZERO      0x02
+#define CARRY     0x01
+
+#define CODE    0x0200
+#define OPERAND 0x10
+
+uint8_t ram[65536];
+
+uint8_t read(uint16_t addr)
+{
+   return ram[addr];
+}
+
+void write(uint16_t addr, uint8_t val)
+{
+   ram[addr] = val;
+}
+
+static uint8_t SetFlag(uint8_t p, uint8_t flag, bool set)
+{
+   return set ? (p | flag) : (p & ~flag);
+}
+
+// ADC as the core implemented it before the decimal tables, N V Z from
+// the binary sum, then N V again from the decimal one
+static void RefAdc(uint8_t& a, uint8_t& p, uint8_t m)
+{
+   unsigned int carry = p & CARRY;
+   unsigned int tmp = m + a + carry;
+
+   p = SetFlag(p, OVERFLOW, !((a ^ m) & 0x80) && ((a ^ tmp) & 0x80));
+   p = SetFlag(p, NEGATIVE, tmp & 0x80);
+   p = SetFlag(p, ZERO, !(tmp & 0xFF));
+
+   if (p & DECIMAL)
+   {
+      int al = (a & 0xF) + (m & 0xF) + carry;
+      if (al >= 0xA) {
+         al = ((al + 6) & 0xF) + 0x10;
+      }
+      tmp = (m & 0xF0) + (a & 0xF0) + al;
+
+      p = SetFlag(p, OVERFLOW, !((a ^ m) & 0x80) && ((a ^ tmp) & 0x80));
+      p = SetFlag(p, NEGATIVE, tmp & 0x80);
+
+      if (tmp >= 0xA0) tmp += 0x60;
+   }
+
+   p = SetFlag(p, CARRY, tmp > 0xFF);
+   a = tmp & 0xFF;
+}
+
+static void RefSbc(uint8_t& a, uint8_t& p, uint8_t m)
+{
+   int borrow = (p & CARRY) ? 0 : 1;
+   int tmp = a - m - borrow;
+
+   p = SetFlag(p, OVERFLOW, (a ^ m) & (a ^ tmp) & 0x80);
+   p = SetFlag(p, NEGATIVE, tmp & 0x80);
+   p = SetFlag(p, ZERO, !(tmp & 0xFF));
+
+   if (p & DECIMAL)
+   {
+      int al = (a & 0x0F) - (m & 0x0F) - borrow;
+      if (al < 0) {
+         al = ((al - 6) & 0x0F) - 0x10;
+      }
+      tmp = (a & 0xF0) - (m & 0xF0) + al;
+
+      p = SetFlag(p, OVERFLOW, (a ^ m) & (a ^ tmp) & 0x80);
+      p = SetFlag(p, NEGATIVE, tmp & 0x80);
+
+      if (tmp < 0) tmp -= 0x60;
+   }
+
+   p = SetFlag(p, CARRY, tmp >= 0);
+   a = tmp & 0xFF;
+}
+
+// the operand as RRA and ISC modify it before the arithmetic
+static void RefRra(uint8_t& a, uint8_t& p, uint8_t& m)
+{
+   bool carry = m & 0x01;
+   m = (m >> 1) | ((p & CARRY) ? 0x80 : 0);
+   p = SetFlag(p, CARRY, carry);
+   RefAdc(a, p, m);
+}
+
+static void RefIsc(uint8_t& a, uint8_t& p, uint8_t& m)
+{
+   m++;
+   RefSbc(a, p, m);
+}
+
+struct Test
+{
+   const char *name;
+   uint8_t opcode;     // zero page form
+};
+
+static const Test tests[] = {
+   { "ADC", 0x65 },
+   { "SBC", 0xE5 },
+   { "RRA", 0x67 },
+   { "ISC", 0xE7 },
+};
+
+int main()
+{
+   mos6502 cpu(read, write);
+   uint64_t cycles = 0;
+   int failures = 0;
+   int runs = 0;
+
+   for(int t = 0; t < 4; t++)
+   {
+      ram[CODE] = tests[t].opcode;
+      ram[CODE + 1] = OPERAND;
+
+      for(int flags = 0; flags < 4; flags++)
+      {
+         for(int a = 0; a < 256; a++)
+         {
+            for(int m = 0; m < 256; m++)
+            {
+               // start with N V Z opposite to most results
+               uint8_t p = CONSTANT | BREAK | ((a ^ m) & (NEGATIVE | OVERFLOW));
+               if (a == m) p |= ZERO;
+               if (flags & 1) p |= CARRY;
+               if (flags & 2) p |= DECIMAL;
+
+               uint8_t refA = a;
+               uint8_t refP = p;
+               uint8_t refM = m;
+               switch(t)
+               {
+                  case 0: RefAdc(refA, refP, refM); break;
+                  case 1: RefSbc(refA, refP, refM); break;
+                  case 2: RefRra(refA, refP, refM); break;
+                  case 3: RefIsc(refA, refP, refM); break;
+               }
+
+               ram[OPERAND] = m;
+               cpu.SetPC(CODE);
+               cpu.SetA(a);
+               cpu.SetP(p);
+               cpu.Run(1, cycles, mos6502::INST_COUNT);
+               runs++;
+
+               uint8_t gotP = cpu.GetP() | CONSTANT | BREAK;
+               if (cpu.GetA() != refA || gotP != refP || ram[OPERAND] != refM)
+               {
+                  if (failures++ < 10)
+                  {
+                     printf("FAIL: %s a %02X m %02X p %02X: "
+                           "got a %02X p %02X m %02X, expected a %02X p %02X m %02X\n",
+                           tests[t].name, a, m, p,
+                           cpu.GetA(), gotP, ram[OPERAND], refA, refP, refM);
+                  }
+               }
+            }
+         }
+      }
+   }
+
+   if (failures)
+   {
+      printf("%d of %d runs differ\n", failures, runs);
+      return 1;
+   }
+
+   printf("%d runs: ADC, SBC, RRA and ISC match the reference\n", runs);
+   return 0;
+}
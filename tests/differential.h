@@ -0,0 +1,50 @@
+// the fixture of the tests that check a feature against a reference CPU
+// run instruction by instruction: two machines with their own RAM on one
+// bus, which goes to the RAM of the current one. A test gives its program
+// in Program() and whatever it watches on the bus in onRead and onWrite.
+
+#ifndef DIFFERENTIAL_H
+#define DIFFERENTIAL_H
+
+#include "../mos6502.h"
+
+#include <string.h>
+#include <stdint.h>
+
+struct Machine
+{
+   uint8_t ram[65536];
+   mos6502* cpu;
+};
+
+static Machine tested;
+static Machine reference;
+static Machine* current;
+
+// called before the access goes to RAM, if set
+static void (*onRead)(uint16_t addr);
+static void (*onWrite)(uint16_t addr, uint8_t value);
+
+uint8_t read(uint16_t addr)
+{
+   if (onRead) onRead(addr);
+   return current->ram[addr];
+}
+
+void write(uint16_t addr, uint8_t value)
+{
+   if (onWrite) onWrite(addr, value);
+   current->ram[addr] = value;
+}
+
+// the program and its data, vectors included, into zeroed RAM
+static void Program(uint8_t* ram);
+
+static void Setup(Machine& m, mos6502& cpu)
+{
+   memset(m.ram, 0, sizeof(m.ram));
+   Program(m.ram);
+   m.cpu = &cpu;
+}
+
+#endif
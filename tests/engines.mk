@@ -0,0 +1,31 @@
+# the variants of a test that checks a feature on every engine of the core,
+# one binary per engine. A test Makefile sets CXXFLAGS, SRC, DEPS, NAME and
+# the files its run leaves in OUTPUT, then includes this one: an engine flag
+# added to the core goes here only
+
+SHELL := /bin/bash
+.SHELLFLAGS := -e -o pipefail -c
+
+DEPS += ../../mos6502.h ../../mos6502_opcodes.h ../../mos6502_pairs.h
+
+VARIANTS := main main_mapped main_threaded main_blocks main_jit main_super \
+            main_idle
+
+main_mapped:   DEFINES := -DMEMORY_MAP
+main_threaded: DEFINES := -DTHREADED_DISPATCH
+main_blocks:   DEFINES := -DBLOCK_CACHE -DMEMORY_MAP
+main_jit:      DEFINES := -DJIT -DJIT_THRESHOLD=2
+main_super:    DEFINES := -DSUPERINSTRUCTIONS -DLAZY_FLAGS
+main_idle:     DEFINES := -DIDLE_LOOPS
+
+all: $(VARIANTS)
+	@for v in $(VARIANTS); do echo "================ Running $$v"; ./$$v; done
+	@echo ==========================================
+	@echo === $(NAME) TESTS COMPLETE: success
+	@echo ==========================================
+
+clean:
+	rm -f $(VARIANTS) $(OUTPUT)
+
+$(VARIANTS): $(DEPS) ../engines.mk
+	g++ $(CXXFLAGS) $(DEFINES) -o $@ $(SRC)
@@ -0,0 +1,206 @@
+// compile with "g++ -O3 main.cpp ../../mos6502.cpp -o main"
+//
+// runs the same program on two CPUs driven by the same timer events. The
+// reference CPU also has a clock cycle callback, which keeps it on the
+// plain path: no JIT, no superinstructions, no idle loop fast-forward.
+// The other one takes every shortcut its build has. Both must see the
+// events at the same cycles and end up in the same state.
+
+#include "../../mos6502.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdint.h>
+
+#define IO_PORT 0x8000      // writing it releases IRQ
+#define FLAG    0x10        // set by the timer, cleared by the program
+#define CODE    0x0200
+#define IRQ_HANDLER 0x0300
+#define LOG_MAX (1 << 18)
+
+struct Machine
+{
+   mos6502* cpu;
+   uint8_t ram[65536];
+   uint64_t log[LOG_MAX][2]; // when, now of every event run
+   int logged;
+   int late;                 // events run too late or too early
+   uint32_t seed;
+   int32_t oneShot;          // a pending event to cancel, or -1
+};
+
+Machine machines[2];
+uint64_t stamp;
+
+uint8_t readRef(uint16_t addr) { return machines[0].ram[addr]; }
+uint8_t readFast(uint16_t addr) { return machines[1].ram[addr]; }
+
+void writeRef(uint16_t addr, uint8_t val)
+{
+   machines[0].ram[addr] = val;
+   if (addr == IO_PORT) machines[0].cpu->IRQ(true);
+}
+
+void writeFast(uint16_t addr, uint8_t val)
+{
+   machines[1].ram[addr] = val;
+   if (addr == IO_PORT) machines[1].cpu->IRQ(true);
+}
+
+void tick(mos6502*, uint32_t n, uint64_t s)
+{
+   stamp = s;
+}
+
+uint32_t rnd(Machine* m)
+{
+   m->seed ^= m->seed << 13;
+   m->seed ^= m->seed >> 17;
+   m->seed ^= m->seed << 5;
+   return m->seed;
+}
+
+void Record(Machine* m, uint64_t when, uint64_t now)
+{
+   if (m->logged < LOG_MAX)
+   {
+      m->log[m->logged][0] = when;
+      m->log[m->logged][1] = now;
+      m->logged++;
+   }
+   // an instruction plus an interrupt entry at most
+   if (now < when || now - when > 7 + 6) m->late++;
+}
+
+// sets the flag the idle loop waits on, again and again
+void Timer(mos6502* cpu, void* ctx, uint64_t when, uint64_t now)
+{
+   Machine* m = (Machine*)ctx;
+   Record(m, when, now);
+   m->ram[FLAG] = 1;
+   cpu->ScheduleEvent(when + 20 + rnd(m) % 3000, Timer, m);
+
+   // now and then a one-shot, cancelled half of the time
+   if (m->oneShot >= 0 && (rnd(m) & 1))
+   {
+      cpu->CancelEvent(m->oneShot);
+      m->oneShot = -1;
+   }
+   else if (m->oneShot < 0)
+   {
+      m->oneShot = cpu->ScheduleEvent(now + rnd(m) % 500, Timer, m);
+   }
+}
+
+// pulls IRQ, the handler releases it
+void Interrupt(mos6502* cpu, void* ctx, uint64_t when, uint64_t now)
+{
+   Machine* m = (Machine*)ctx;
+   Record(m, when, now);
+   cpu->IRQ(false);
+   cpu->ScheduleEvent(when + 100 + rnd(m) % 5000, Interrupt, m);
+}
+
+static const uint8_t program[] = {
+   0xA5, FLAG,             // 0200 LDA FLAG
+   0xF0, 0xFC,             // 0202 BEQ $0200
+   0xA9, 0x00,             // 0204 LDA #0
+   0x85, FLAG,             // 0206 STA FLAG
+   0xE6, 0x20,             // 0208 INC $20
+   0xA5, 0x20,             // 020A LDA $20
+   0x65, 0x21,             // 020C ADC $21
+   0x85, 0x22,             // 020E STA $22
+   0xA2, 0x08,             // 0210 LDX #8
+   0xCA,                   // 0212 DEX
+   0xD0, 0xFD,             // 0213 BNE $0212
+   0x4C, 0x00, 0x02,       // 0215 JMP $0200
+};
+
+static const uint8_t handler[] = {
+   0x48,                   // 0300 PHA
+   0xE6, 0x21,             // 0301 INC $21
+   0x8D, 0x00, 0x80,       // 0303 STA IO_PORT
+   0x68,                   // 0306 PLA
+   0x40,                   // 0307 RTI
+};
+
+void Setup(Machine* m, mos6502* cpu)
+{
+   m->cpu = cpu;
+   m->logged = 0;
+   m->late = 0;
+   m->seed = 0x6502;
+   m->oneShot = -1;
+   memset(m->ram, 0, sizeof(m->ram));
+   memcpy(m->ram + CODE, program, sizeof(program));
+   memcpy(m->ram + IRQ_HANDLER, handler, sizeof(handler));
+   m->ram[0xFFFC] = CODE & 0xFF;
+   m->ram[0xFFFD] = CODE >> 8;
+   m->ram[0xFFFE] = IRQ_HANDLER & 0xFF;
+   m->ram[0xFFFF] = IRQ_HANDLER >> 8;
+#ifdef IDLE_LOOPS
+   cpu->SetIdleSafe(0x00, 0x7F, true);  // all but IO_PORT
+#endif
+   cpu->Reset();
+   cpu->SetP(0x20);    // interrupts enabled
+   cpu->ScheduleEvent(50, Timer, m);
+   cpu->ScheduleEvent(1000, Interrupt, m);
+}
+
+int main(int argc, char **argv)
+{
+   int slices = argc > 1 ? atoi(argv[1]) : 50000;
+
+   mos6502 ref(readRef, writeRef, tick);
+   mos6502 fast(readFast, writeFast);
+   Setup(&machines[0], &ref);
+   Setup(&machines[1], &fast);
+
+   uint64_t cyclesRef = 0;
+   uint64_t cyclesFast = 0;
+   uint32_t seed = 1;
+
+   for(int slice = 0; slice < slices; slice++)
+   {
+      seed = seed * 1103515245 + 12345;
+      int32_t budget = 1 + (seed >> 8) % 2000;
+      mos6502::CycleMethod method =
+         (seed >> 30) ? mos6502::CYCLE_COUNT : mos6502::INST_COUNT;
+
+      ref.Run(budget, cyclesRef, method);
+      fast.Run(budget, cyclesFast, method);
+
+      if (stamp != cyclesRef ||
+          cyclesRef != cyclesFast ||
+          ref.GetPC() != fast.GetPC() ||
+          ref.GetA() != fast.GetA() ||
+          ref.GetX() != fast.GetX() ||
+          ref.GetP() != fast.GetP() ||
+          memcmp(machines[0].ram, machines[1].ram, 65536) ||
+          machines[0].logged != machines[1].logged ||
+          memcmp(machines[0].log, machines[1].log,
+                 machines[0].logged * sizeof(machines[0].log[0])))
+      {
+         printf("FAIL: slice %d\n", slice);
+         printf("ref:  pc %04X a %02X p %02X cycles %llu events %d\n",
+               ref.GetPC(), ref.GetA(), ref.GetP(),
+               (unsigned long long)cyclesRef, machines[0].logged);
+         printf("fast: pc %04X a %02X p %02X cycles %llu events %d\n",
+               fast.GetPC(), fast.GetA(), fast.GetP(),
+               (unsigned long long)cyclesFast, machines[1].logged);
+         return 1;
+      }
+   }
+
+   if (machines[0].late || machines[1].late)
+   {
+      printf("FAIL: %d events late\n", machines[0].late + machines[1].late);
+      return 1;
+   }
+
+   printf("%d slices, %llu cycles, %d events, %d irqs: engines agree\n",
+         slices, (unsigned long long)cyclesRef, machines[0].logged,
+         machines[0].ram[0x21]);
+   return 0;
+}
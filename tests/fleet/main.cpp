@@ -0,0 +1,148 @@
+// compile with "g++ -O3 -DMEMORY_MAP -pthread main.cpp ../../mos6502.cpp
+// ../../mos6502_fleet.cpp -o main"
+//
+// runs a fleet of CPUs on several threads, twice in a row, and checks
+// every CPU against the same program run alone with the same quanta: the
+// stop reason, the cycle count and the memory must all match, whatever
+// worker ran or stole which quantum
+
+#include "../../mos6502_fleet.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdint.h>
+
+#define COUNTDOWN 0x10      // inner loops per lap
+#define MODE      0x11      // 0: halt after a lap, 1: raise DONE, 2: loop
+#define DONE      0x13      // the check callback stops the CPU on it
+#define CODE      0x0200
+
+static const uint8_t program[] = {
+   0xA5, COUNTDOWN,        // 0200 LDA COUNTDOWN
+   0x85, 0x12,             // 0202 STA $12
+   0xE6, 0x20,             // 0204 INC $20
+   0xD0, 0xFC,             // 0206 BNE $0204
+   0xC6, 0x12,             // 0208 DEC $12
+   0xD0, 0xF8,             // 020A BNE $0204
+   0xA5, MODE,             // 020C LDA MODE
+   0xF0, 0x08,             // 020E BEQ $0218
+   0x29, 0x01,             // 0210 AND #1
+   0x85, DONE,             // 0212 STA DONE
+   0xE6, 0x14,             // 0214 INC $14
+   0xD0, 0xE8,             // 0216 BNE $0200
+   0x02,                   // 0218 illegal opcode
+};
+
+void Load(uint8_t* memory, int i)
+{
+   memcpy(memory + CODE, program, sizeof(program));
+   memory[COUNTDOWN] = 1 + i % 50;
+   memory[MODE] = i % 3;
+   memory[0xFFFC] = CODE & 0xFF;
+   memory[0xFFFD] = CODE >> 8;
+}
+
+bool Done(mos6502_fleet* fleet, int index, void* ctx)
+{
+   return fleet->GetMemory(index)[DONE] != 0;
+}
+
+// the reference, one CPU on its own
+uint8_t alone[65536];
+
+#ifdef BUS_CONTEXT
+uint8_t readAlone(void*, uint16_t addr) { return alone[addr]; }
+void writeAlone(void*, uint16_t addr, uint8_t val) { alone[addr] = val; }
+#else
+uint8_t readAlone(uint16_t addr) { return alone[addr]; }
+void writeAlone(uint16_t addr, uint8_t val) { alone[addr] = val; }
+#endif
+
+int main(int argc, char **argv)
+{
+   int count = argc > 1 ? atoi(argv[1]) : 300;
+   int threads = argc > 2 ? atoi(argv[2]) : 4;
+   const uint64_t amount = 2000000;
+   const int32_t quantum = 30000;
+
+   mos6502_fleet fleet(count, threads);
+   for(int i = 0; i < count; i++)
+   {
+      Load(fleet.GetMemory(i), i);
+      fleet.GetCpu(i)->Reset();
+   }
+
+   fleet.Run(amount, mos6502::CYCLE_COUNT, quantum, Done);
+   uint64_t executed = fleet.GetTotalCycles();
+   fleet.Run(amount, mos6502::CYCLE_COUNT, quantum, Done);
+   executed += fleet.GetTotalCycles();
+
+   int reasons[4] = { 0, 0, 0, 0 };
+   uint64_t expected = 0;
+
+   for(int i = 0; i < count; i++)
+   {
+      memset(alone, 0, sizeof(alone));
+      Load(alone, i);
+#ifdef BUS_CONTEXT
+      mos6502 cpu(readAlone, writeAlone, nullptr);
+#else
+      mos6502 cpu(readAlone, writeAlone);
+#endif
+#ifdef MEMORY_MAP
+      cpu.MapRAM(0x00, 0xFF, alone);
+#endif
+      cpu.Reset();
+
+      uint64_t cycles = 0;
+      mos6502_fleet::StopReason reason = mos6502_fleet::RUNNING;
+      for(int run = 0; run < 2; run++)
+      {
+         if (cpu.IsHalted())
+         {
+            reason = mos6502_fleet::ILLEGAL_OPCODE;
+            continue;
+         }
+         uint64_t left = amount;
+         for(;;)
+         {
+            int32_t slice = left < (uint64_t)quantum ? (int32_t)left : quantum;
+            cpu.Run(slice, cycles, mos6502::CYCLE_COUNT);
+            left -= slice;
+            if (cpu.IsHalted()) { reason = mos6502_fleet::ILLEGAL_OPCODE; break; }
+            if (alone[DONE]) { reason = mos6502_fleet::STOPPED; break; }
+            if (!left) { reason = mos6502_fleet::BUDGET; break; }
+         }
+      }
+
+      if (fleet.GetStopReason(i) != reason ||
+          fleet.GetCycles(i) != cycles ||
+          fleet.GetCpu(i)->GetPC() != cpu.GetPC() ||
+          memcmp(fleet.GetMemory(i), alone, sizeof(alone)))
+      {
+         printf("FAIL: cpu %d\n", i);
+         printf("fleet: reason %d cycles %llu pc %04X\n",
+               fleet.GetStopReason(i), (unsigned long long)fleet.GetCycles(i),
+               fleet.GetCpu(i)->GetPC());
+         printf("alone: reason %d cycles %llu pc %04X\n",
+               reason, (unsigned long long)cycles, cpu.GetPC());
+         return 1;
+      }
+      reasons[reason]++;
+      expected += cycles;
+   }
+
+   if (executed != expected)
+   {
+      printf("FAIL: fleet executed %llu, expected %llu\n",
+            (unsigned long long)executed, (unsigned long long)expected);
+      return 1;
+   }
+
+   printf("%d cpus on %d threads: %d halted, %d stopped, %d ran out of budget, "
+         "%.2f MHz\n", count, fleet.GetThreads(), reasons[mos6502_fleet::ILLEGAL_OPCODE],
+         reasons[mos6502_fleet::STOPPED], reasons[mos6502_fleet::BUDGET],
+         fleet.GetMHz());
+   return 0;
+}
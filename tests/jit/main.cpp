@@ -0,0 +1,345 @@
+// compile with "g++ -O3 -DJIT main.cpp ../../mos6502.cpp -o main"
+//
+// runs generated programs on two CPUs in lockstep, one with the JIT and
+// one with the block cache interpreter only, and stops at the first
+// difference in registers, cycle count or memory. Then runs a loop of
+// more blocks than the code buffer holds, when built with a small one,
+// and checks that the blocks are translated again after it fills up
+
+#include "../../mos6502.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdint.h>
+
+#define IO_PORT 0xBFFC      // bit 0 low pulls IRQ, bit 1 low pulls NMI
+#define CODE    0x0200
+#define SUBS    0x1000
+#define DATA    0x3000
+#define IRQ_HANDLER 0xF000
+#define NMI_HANDLER 0xF100
+
+uint8_t ramJit[65536];
+uint8_t ramRef[65536];
+
+mos6502 *cpuJit;
+mos6502 *cpuRef;
+
+uint8_t readJit(uint16_t addr)
+{
+   return ramJit[addr];
+}
+
+uint8_t readRef(uint16_t addr)
+{
+   return ramRef[addr];
+}
+
+void writeJit(uint16_t addr, uint8_t val)
+{
+   ramJit[addr] = val;
+   if (addr == IO_PORT)
+   {
+      cpuJit->IRQ(val & 1);
+      cpuJit->NMI(val & 2);
+   }
+}
+
+void writeRef(uint16_t addr, uint8_t val)
+{
+   ramRef[addr] = val;
+   if (addr == IO_PORT)
+   {
+      cpuRef->IRQ(val & 1);
+      cpuRef->NMI(val & 2);
+   }
+}
+
+static uint32_t seed;
+
+uint32_t rnd()
+{
+   seed ^= seed << 13;
+   seed ^= seed >> 17;
+   seed ^= seed << 5;
+   return seed;
+}
+
+struct Assembler
+{
+   uint8_t *ram;
+   uint16_t pc;
+
+   void Byte(uint8_t b) { ram[pc++] = b; }
+   void Op(uint8_t op) { Byte(op); }
+   void Op(uint8_t op, uint8_t b) { Byte(op); Byte(b); }
+   void Op(uint8_t op, uint16_t w) { Byte(op); Byte(w & 0xFF); Byte(w >> 8); }
+};
+
+// opcodes the JIT translates inline, immediate operand when two bytes long
+static const uint8_t inlineOps[] = {
+   0xAA, 0xA8, 0x8A, 0x98, 0xBA, 0x9A, 0xE8, 0xC8, 0xCA, 0x88,
+   0x18, 0x38, 0xD8, 0xF8, 0x58, 0x78, 0xB8, 0xEA, 0x0A, 0x4A,
+};
+static const uint8_t inlineImmOps[] = {
+   0xA9, 0xA2, 0xA0, 0x29, 0x09, 0x49, 0xC9, 0xE0, 0xC0,
+};
+
+// opcodes run through their handler: zero page, absolute and indexed
+// memory operations, decimal capable arithmetic, stack and shifts
+static const uint8_t zpOps[] = {
+   0xA5, 0x85, 0x65, 0xE5, 0x25, 0x05, 0x45, 0xC5, 0x24,
+   0xE6, 0xC6, 0x06, 0x46, 0x26, 0x66, 0xB5, 0x95, 0xA6, 0x86,
+};
+static const uint8_t absOps[] = {
+   0xAD, 0x8D, 0x6D, 0xED, 0xBD, 0x9D, 0xB9, 0x99, 0xEE, 0x3E,
+};
+static const uint8_t otherOps[] = {
+   0x2A, 0x6A, 0x48, 0x68, 0x08, 0x28, 0x69, 0xE9,
+};
+// BPL BMI BVC BVS BCC BCS BNE BEQ
+static const uint8_t branchOps[] = {
+   0x10, 0x30, 0x50, 0x70, 0x90, 0xB0, 0xD0, 0xF0,
+};
+
+#define COUNT(a) (sizeof(a) / sizeof((a)[0]))
+
+void EmitBody(Assembler& as, int subs)
+{
+   int n = 1 + rnd() % 14;
+   uint16_t imm = 0;
+
+   for(int i = 0; i < n; i++)
+   {
+      uint32_t r = rnd() % 100;
+
+      if (r < 35)
+      {
+         as.Op(inlineOps[rnd() % COUNT(inlineOps)]);
+      }
+      else if (r < 55)
+      {
+         // remember one immediate operand to modify it later
+         if (!imm || (rnd() & 1)) imm = as.pc + 1;
+         as.Op(inlineImmOps[rnd() % COUNT(inlineImmOps)], (uint8_t)rnd());
+      }
+      else if (r < 70)
+      {
+         // zero page below the loop counter at $F0
+         as.Op(zpOps[rnd() % COUNT(zpOps)], (uint8_t)(rnd() % 0xE0));
+      }
+      else if (r < 80)
+      {
+         as.Op(absOps[rnd() % COUNT(absOps)], (uint16_t)(DATA + rnd() % 0x800));
+      }
+      else if (r < 87)
+      {
+         as.Op(otherOps[rnd() % COUNT(otherOps)]);
+      }
+      else if (r < 91)
+      {
+         // short forward branch over a two byte instruction
+         as.Op(branchOps[rnd() % COUNT(branchOps)], (uint8_t)2);
+         as.Op(inlineImmOps[rnd() % COUNT(inlineImmOps)], (uint8_t)rnd());
+      }
+      else if (r < 94 && imm)
+      {
+         // self-modifying code
+         as.Op(0xEE, imm); // INC imm
+      }
+      else if (r < 96)
+      {
+         // raise IRQ, rarely NMI too, the handlers release the lines
+         as.Op(0xA9, (uint8_t)((rnd() & 7) ? 2 : 0)); // LDA #
+         as.Op(0x8D, (uint16_t)IO_PORT);              // STA IO_PORT
+      }
+      else if (subs)
+      {
+         as.Op(0x20, (uint16_t)(SUBS + (rnd() % subs) * 0x40)); // JSR
+      }
+   }
+}
+
+void Generate(uint8_t *ram)
+{
+   Assembler as;
+   as.ram = ram;
+
+   for(int i = 0; i < 65536; i++)
+   {
+      ram[i] = rnd();
+   }
+   ram[IO_PORT] = 3;
+
+   // subroutines
+   int subs = 1 + rnd() % 8;
+   for(int i = 0; i < subs; i++)
+   {
+      as.pc = SUBS + i * 0x40;
+      EmitBody(as, 0);
+      as.Op(0x60); // RTS
+   }
+
+   // interrupt handlers: release the lines and return
+   as.pc = IRQ_HANDLER;
+   as.Op(0x48);                          // PHA
+   as.Op(0xA9, (uint8_t)3);              // LDA #3
+   as.Op(0x8D, (uint16_t)IO_PORT);       // STA IO_PORT
+   as.Op(0x68);                          // PLA
+   as.Op(0x40);                          // RTI
+   as.pc = NMI_HANDLER;
+   as.Op(0x48);                          // PHA
+   as.Op(0xA9, (uint8_t)3);              // LDA #3
+   as.Op(0x8D, (uint16_t)IO_PORT);       // STA IO_PORT
+   as.Op(0x68);                          // PLA
+   as.Op(0x40);                          // RTI
+
+   ram[0xFFFA] = NMI_HANDLER & 0xFF;
+   ram[0xFFFB] = NMI_HANDLER >> 8;
+   ram[0xFFFC] = CODE & 0xFF;
+   ram[0xFFFD] = CODE >> 8;
+   ram[0xFFFE] = IRQ_HANDLER & 0xFF;
+   ram[0xFFFF] = IRQ_HANDLER >> 8;
+
+   // loops counted down in $F0
+   as.pc = CODE;
+   int loops = 1 + rnd() % 6;
+   for(int i = 0; i < loops; i++)
+   {
+      as.Op(0xA9, (uint8_t)(1 + rnd() % 50)); // LDA #
+      as.Op(0x85, (uint8_t)0xF0);             // STA $F0
+      uint16_t top = as.pc;
+      EmitBody(as, subs);
+      as.Op(0xC6, (uint8_t)0xF0);             // DEC $F0
+      as.Op(0xD0, (uint8_t)(top - (as.pc + 2))); // BNE top
+   }
+   as.Op(0x4C, (uint16_t)CODE);               // JMP CODE
+}
+
+bool Compare(int program, int slice, uint64_t cyclesJit, uint64_t cyclesRef)
+{
+   if (cpuJit->GetPC() == cpuRef->GetPC() &&
+       cpuJit->GetA() == cpuRef->GetA() &&
+       cpuJit->GetX() == cpuRef->GetX() &&
+       cpuJit->GetY() == cpuRef->GetY() &&
+       cpuJit->GetS() == cpuRef->GetS() &&
+       cpuJit->GetP() == cpuRef->GetP() &&
+       cyclesJit == cyclesRef &&
+       !memcmp(ramJit, ramRef, sizeof(ramJit)))
+   {
+      return true;
+   }
+
+   printf("FAIL: program %d slice %d\n", program, slice);
+   printf("jit: pc %04X a %02X x %02X y %02X s %02X p %02X cycles %llu\n",
+         cpuJit->GetPC(), cpuJit->GetA(), cpuJit->GetX(), cpuJit->GetY(),
+         cpuJit->GetS(), cpuJit->GetP(), (unsigned long long)cyclesJit);
+   printf("ref: pc %04X a %02X x %02X y %02X s %02X p %02X cycles %llu\n",
+         cpuRef->GetPC(), cpuRef->GetA(), cpuRef->GetX(), cpuRef->GetY(),
+         cpuRef->GetS(), cpuRef->GetP(), (unsigned long long)cyclesRef);
+   for(int i = 0; i < 65536; i++)
+   {
+      if (ramJit[i] != ramRef[i])
+      {
+         printf("ram: %04X jit %02X ref %02X\n", i, ramJit[i], ramRef[i]);
+         break;
+      }
+   }
+   return false;
+}
+
+// a ring of blocks, each one INX and a JMP to the next
+#define RING_BLOCKS 64
+
+bool FlushCheck()
+{
+   Assembler as = { ramJit, CODE };
+   for(int i = 1; i <= RING_BLOCKS; i++)
+   {
+      as.Op(0xE8);                                              // INX
+      as.Op(0x4C, (uint16_t)(CODE + (i % RING_BLOCKS) * 4));   // JMP next
+   }
+   ramJit[0xFFFC] = CODE & 0xFF;
+   ramJit[0xFFFD] = CODE >> 8;
+
+   mos6502 cpu(readJit, writeJit);
+   cpuJit = &cpu;
+   cpu.IRQ(true);
+   cpu.NMI(true);
+   cpu.Reset();
+
+   // every block hot, then as many turns of the ring again
+   uint64_t cycles = 0;
+   cpu.Run(1000 * RING_BLOCKS * 2, cycles, mos6502::INST_COUNT);
+   uint64_t first = cpu.GetJitBlocks();
+   cpu.Run(1000 * RING_BLOCKS * 2, cycles, mos6502::INST_COUNT);
+   uint64_t again = cpu.GetJitBlocks() - first;
+
+   // the ring fits in the buffer unless the buffer is under the upper
+   // bound JitTranslate() makes room for
+   bool fits = JIT_CODE_SIZE >= RING_BLOCKS * (64 + BLOCK_MAX_INSTR * 128);
+   if (first < RING_BLOCKS || (fits && again) || (!fits && !again))
+   {
+      printf("FAIL: %llu blocks translated, then %llu more, with a %s buffer\n",
+            (unsigned long long)first, (unsigned long long)again,
+            fits ? "large" : "small");
+      return false;
+   }
+   printf("%d blocks in a ring: %llu translations, then %llu more\n", RING_BLOCKS,
+         (unsigned long long)first, (unsigned long long)again);
+   return true;
+}
+
+int main(int argc, char **argv)
+{
+   int programs = argc > 1 ? atoi(argv[1]) : 300;
+   int slices = argc > 2 ? atoi(argv[2]) : 2000;
+
+   cpuJit = new mos6502(readJit, writeJit);
+   cpuRef = new mos6502(readRef, writeRef);
+   cpuRef->EnableJit(false);
+
+   for(int program = 0; program < programs; program++)
+   {
+      seed = 0x6502 + program * 7919;
+      Generate(ramJit);
+      memcpy(ramRef, ramJit, sizeof(ramJit));
+
+      cpuJit->IRQ(true);
+      cpuJit->NMI(true);
+      cpuRef->IRQ(true);
+      cpuRef->NMI(true);
+      cpuJit->Reset();
+      cpuRef->Reset();
+
+      uint64_t cyclesJit = 0;
+      uint64_t cyclesRef = 0;
+
+      for(int slice = 0; slice < slices; slice++)
+      {
+         int32_t budget = 1 + rnd() % 1000;
+         mos6502::CycleMethod method =
+            (rnd() & 1) ? mos6502::CYCLE_COUNT : mos6502::INST_COUNT;
+
+         cpuJit->Run(budget, cyclesJit, method);
+         cpuRef->Run(budget, cyclesRef, method);
+
+         if (!Compare(program, slice, cyclesJit, cyclesRef))
+         {
+            return 1;
+         }
+
+         // the host pulls IRQ now and then, a handler releases it
+         if ((rnd() & 63) == 0)
+         {
+            cpuJit->IRQ(false);
+            cpuRef->IRQ(false);
+         }
+      }
+   }
+
+   printf("%d programs, %d slices each: jit and interpreter agree\n",
+         programs, slices);
+   return FlushCheck() ? 0 : 1;
+}
@@ -0,0 +1,330 @@
+// compile with "g++ -O3 -DMEMORY_MAP main.cpp ../../mos6502.cpp
+// ../../mos6502_lanes.cpp -o main"
+//
+// runs generated programs on a set of lanes and on one scalar CPU per
+// lane, in slices, and stops at the first lane that differs in registers,
+// cycle count, halt or memory. The code is the same in every lane, the data
+// is not, so the lanes go apart on branches and come back together
+
+#include "../../mos6502_lanes.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdint.h>
+
+#if !defined(BUS_CONTEXT) && !defined(MEMORY_MAP)
+#error "the scalar CPUs need BUS_CONTEXT or MEMORY_MAP for a memory each"
+#endif
+
+#define LANES    100        // not a whole vector, to have padding lanes
+#define CODE     0x0200
+#define SUBS     0x1000
+#define DATA     0x3000
+#define POINTERS 0x80       // zero page pointers into DATA
+
+static uint32_t seed;
+
+uint32_t rnd()
+{
+   seed ^= seed << 13;
+   seed ^= seed >> 17;
+   seed ^= seed << 5;
+   return seed;
+}
+
+struct Assembler
+{
+   uint8_t *ram;
+   uint16_t pc;
+
+   void Byte(uint8_t b) { ram[pc++] = b; }
+   void Op(uint8_t op) { Byte(op); }
+   void Op(uint8_t op, uint8_t b) { Byte(op); Byte(b); }
+   void Op(uint8_t op, uint16_t w) { Byte(op); Byte(w & 0xFF); Byte(w >> 8); }
+};
+
+// implied and accumulator
+static const uint8_t impliedOps[] = {
+   0xAA, 0xA8, 0x8A, 0x98, 0xBA, 0xE8, 0xC8, 0xCA, 0x88, 0x18,
+   0x38, 0x58, 0x78, 0xB8, 0xEA, 0x0A, 0x4A, 0x2A, 0x6A,
+};
+static const uint8_t immOps[] = {
+   0xA9, 0xA2, 0xA0, 0x29, 0x09, 0x49, 0xC9, 0xE0, 0xC0, 0x69, 0xE9,
+};
+static const uint8_t zpOps[] = {
+   0xA5, 0xA6, 0xA4, 0x85, 0x86, 0x84, 0x65, 0xE5, 0x25, 0x05, 0x45,
+   0xC5, 0xE4, 0xC4, 0x24, 0xE6, 0xC6, 0x06, 0x46, 0x26, 0x66,
+   0xB5, 0x95, 0xB4, 0x94, 0x75, 0xF5, 0x35, 0xD5, 0xF6, 0x16, 0x76,
+   0xB6, 0x96,
+};
+static const uint8_t absOps[] = {
+   0xAD, 0xAE, 0xAC, 0x8D, 0x8E, 0x8C, 0x6D, 0xED, 0x2D, 0x0D, 0x4D,
+   0xCD, 0xEC, 0xCC, 0x2C, 0xEE, 0xCE, 0x0E, 0x4E, 0x2E, 0x6E,
+   0xBD, 0xB9, 0x9D, 0x99, 0x7D, 0xF9, 0x3D, 0x59, 0xDD, 0xFE, 0x1E,
+   0xBE, 0xBC,
+};
+// (zp,X) and (zp),Y, loads only: the pointers may point anywhere
+static const uint8_t indirectOps[] = {
+   0xA1, 0xB1, 0x61, 0x71, 0xE1, 0xF1, 0x21, 0x31, 0x01, 0x11,
+   0x41, 0x51, 0xC1, 0xD1,
+};
+// BPL BMI BVC BVS BCC BCS BNE BEQ
+static const uint8_t branchOps[] = {
+   0x10, 0x30, 0x50, 0x70, 0x90, 0xB0, 0xD0, 0xF0,
+};
+
+#define COUNT(a) (sizeof(a) / sizeof((a)[0]))
+
+void EmitBody(Assembler& as, int subs, bool main)
+{
+   int n = 1 + rnd() % 20;
+   uint16_t imm = 0;
+
+   for(int i = 0; i < n; i++)
+   {
+      uint32_t r = rnd() % 100;
+
+      if (r < 20)
+      {
+         as.Op(impliedOps[rnd() % COUNT(impliedOps)]);
+      }
+      else if (r < 35)
+      {
+         if (!imm || (rnd() & 1)) imm = as.pc + 1;
+         as.Op(immOps[rnd() % COUNT(immOps)], (uint8_t)rnd());
+      }
+      else if (r < 55)
+      {
+         // zero page below the pointers
+         as.Op(zpOps[rnd() % COUNT(zpOps)], (uint8_t)(rnd() % POINTERS));
+      }
+      else if (r < 70)
+      {
+         as.Op(absOps[rnd() % COUNT(absOps)], (uint16_t)(DATA + rnd() % 0x800));
+      }
+      else if (r < 76)
+      {
+         as.Op(indirectOps[rnd() % COUNT(indirectOps)],
+               (uint8_t)(POINTERS + 2 * (rnd() % 16)));
+      }
+      else if (r < 86)
+      {
+         // short forward branch over a two byte instruction
+         as.Op(branchOps[rnd() % COUNT(branchOps)], (uint8_t)2);
+         as.Op(immOps[rnd() % COUNT(immOps)], (uint8_t)rnd());
+      }
+      else if (r < 89)
+      {
+         // decimal arithmetic
+         as.Op(0xF8);                                   // SED
+         as.Op(0x69, (uint8_t)rnd());                   // ADC #
+         as.Op(0xE5, (uint8_t)(rnd() % POINTERS));      // SBC zp
+         as.Op(0xD8);                                   // CLD
+      }
+      else if (r < 92)
+      {
+         // the stack, balanced
+         bool flags = rnd() & 1;
+         as.Op(flags ? 0x08 : 0x48);                    // PHP / PHA
+         as.Op(immOps[rnd() % COUNT(immOps)], (uint8_t)rnd());
+         as.Op(flags ? 0x28 : 0x68);                    // PLP / PLA
+      }
+      else if (r < 94 && imm && main)
+      {
+         // self-modifying code, only in some lanes when branched over
+         as.Op(0xEE, imm);                              // INC imm
+      }
+      else if (r < 95)
+      {
+         // a few lanes stop on an illegal opcode
+         as.Op(0xAD, (uint16_t)(DATA + rnd() % 0x800)); // LDA abs
+         as.Op(0xC9, (uint8_t)0xFC);                    // CMP #$FC
+         as.Op(0x90, (uint8_t)1);                       // BCC +1
+         as.Op(0x02);
+      }
+      else if (r < 97)
+      {
+         as.Op(0x4C, (uint16_t)(as.pc + 3));            // JMP next
+      }
+      else if (subs)
+      {
+         as.Op(0x20, (uint16_t)(SUBS + (rnd() % subs) * 0x80)); // JSR
+      }
+   }
+}
+
+// the code, the same in every lane
+void Generate(uint8_t *code)
+{
+   Assembler as;
+   as.ram = code;
+   memset(code, 0, 65536);
+
+   int subs = 1 + rnd() % 8;
+   for(int i = 0; i < subs; i++)
+   {
+      as.pc = SUBS + i * 0x80;
+      EmitBody(as, 0, false);
+      as.Op(0x60); // RTS
+   }
+
+   // loops counted down in $F0
+   as.pc = CODE;
+   int loops = 1 + rnd() % 6;
+   for(int i = 0; i < loops; i++)
+   {
+      as.Op(0xA9, (uint8_t)(1 + rnd() % 50)); // LDA #
+      as.Op(0x85, (uint8_t)0xF0);             // STA $F0
+      uint16_t top = as.pc;
+      EmitBody(as, subs, true);
+      as.Op(0xC6, (uint8_t)0xF0);             // DEC $F0
+      as.Op(0xD0, (uint8_t)(top - (as.pc + 2))); // BNE top
+   }
+   as.Op(0x4C, (uint16_t)CODE);               // JMP CODE
+
+   code[0xFFFC] = CODE & 0xFF;
+   code[0xFFFD] = CODE >> 8;
+}
+
+// code over random data, DATA pointers in the zero page
+void Fill(uint8_t *ram, const uint8_t *code)
+{
+   for(int i = 0; i < 65536; i++)
+   {
+      ram[i] = rnd();
+   }
+   memcpy(ram + CODE, code + CODE, DATA - CODE);
+   for(int i = 0; i < 32; i += 2)
+   {
+      ram[POINTERS + i + 1] = (DATA >> 8) + rnd() % 8;
+   }
+   ram[0xFFFC] = code[0xFFFC];
+   ram[0xFFFD] = code[0xFFFD];
+}
+
+uint8_t ram[LANES][65536];
+
+#ifdef BUS_CONTEXT
+uint8_t read(void* ctx, uint16_t addr) { return ((uint8_t*)ctx)[addr]; }
+void write(void* ctx, uint16_t addr, uint8_t val) { ((uint8_t*)ctx)[addr] = val; }
+#else
+// every page is mapped
+uint8_t read(uint16_t addr) { return 0; }
+void write(uint16_t addr, uint8_t val) {}
+#endif
+
+bool Compare(mos6502_lanes& lanes, mos6502** cpus, uint64_t* cycles,
+      int program, int slice, bool memory)
+{
+   for(int i = 0; i < LANES; i++)
+   {
+      mos6502* cpu = cpus[i];
+      bool same = lanes.GetPC(i) == cpu->GetPC() &&
+         lanes.GetA(i) == cpu->GetA() &&
+         lanes.GetX(i) == cpu->GetX() &&
+         lanes.GetY(i) == cpu->GetY() &&
+         lanes.GetS(i) == cpu->GetS() &&
+         lanes.GetP(i) == cpu->GetP() &&
+         lanes.GetCycles(i) == cycles[i] &&
+         lanes.IsHalted(i) == cpu->IsHalted();
+
+      int diff = -1;
+      for(int a = 0; memory && a < 65536 && diff < 0; a++)
+      {
+         if (lanes.Peek(i, a) != ram[i][a]) diff = a;
+      }
+      if (same && diff < 0) continue;
+
+      printf("FAIL: program %d slice %d lane %d\n", program, slice, i);
+      printf("lane:   pc %04X a %02X x %02X y %02X s %02X p %02X cycles %llu%s\n",
+            lanes.GetPC(i), lanes.GetA(i), lanes.GetX(i), lanes.GetY(i),
+            lanes.GetS(i), lanes.GetP(i), (unsigned long long)lanes.GetCycles(i),
+            lanes.IsHalted(i) ? " halted" : "");
+      printf("scalar: pc %04X a %02X x %02X y %02X s %02X p %02X cycles %llu%s\n",
+            cpu->GetPC(), cpu->GetA(), cpu->GetX(), cpu->GetY(),
+            cpu->GetS(), cpu->GetP(), (unsigned long long)cycles[i],
+            cpu->IsHalted() ? " halted" : "");
+      if (diff >= 0)
+      {
+         printf("ram: %04X lane %02X scalar %02X\n",
+               diff, lanes.Peek(i, diff), ram[i][diff]);
+      }
+      return false;
+   }
+   return true;
+}
+
+int main(int argc, char **argv)
+{
+   int programs = argc > 1 ? atoi(argv[1]) : 30;
+   int slices = argc > 2 ? atoi(argv[2]) : 100;
+
+   static uint8_t code[65536];
+   mos6502* cpus[LANES];
+   uint64_t cycles[LANES];
+
+   for(int i = 0; i < LANES; i++)
+   {
+#ifdef BUS_CONTEXT
+      cpus[i] = new mos6502(read, write, ram[i]);
+#else
+      cpus[i] = new mos6502(read, write);
+      cpus[i]->MapRAM(0x00, 0xFF, ram[i]);
+#endif
+   }
+
+   uint64_t steps = 0;
+   uint64_t instructions = 0;
+   uint64_t scalar = 0;
+
+   for(int program = 0; program < programs; program++)
+   {
+      mos6502_lanes lanes(LANES);
+
+      seed = 0x6502 + program * 7919;
+      Generate(code);
+      for(int i = 0; i < LANES; i++)
+      {
+         Fill(ram[i], code);
+         for(int a = 0; a < 65536; a++)
+         {
+            lanes.Poke(i, a, ram[i][a]);
+         }
+         cpus[i]->Reset();
+         cycles[i] = 0;
+      }
+      lanes.Reset();
+
+      for(int slice = 0; slice < slices; slice++)
+      {
+         int32_t budget = 1 + rnd() % 1000;
+         mos6502::CycleMethod method =
+            (rnd() & 1) ? mos6502::CYCLE_COUNT : mos6502::INST_COUNT;
+
+         lanes.Run(budget, method);
+         for(int i = 0; i < LANES; i++)
+         {
+            cpus[i]->Run(budget, cycles[i], method);
+         }
+
+         if (!Compare(lanes, cpus, cycles, program, slice,
+                  slice == slices - 1))
+         {
+            return 1;
+         }
+      }
+
+      uint64_t s, n, c;
+      lanes.GetStats(s, n, c);
+      steps += s;
+      instructions += n;
+      scalar += c;
+   }
+
+   printf("%d programs, %d lanes, %d slices each: lanes and scalar agree\n",
+         programs, LANES, slices);
+   printf("%.1f lanes per step, %.1f%% of the instructions run by the scalar core\n",
+         (double)instructions / steps, 100.0 * scalar / instructions);
+   return 0;
+}
@@ -0,0 +1,194 @@
+// compile with "g++ -O3 -DMEMORY_MAP main.cpp ../../mos6502.cpp -o main"
+//
+// runs the same program on two CPUs with the same memory layout: RAM,
+// an I/O page, a switchable ROM bank and a fixed ROM. The reference CPU
+// sees it all through the bus callbacks, the other one has the RAM and
+// ROM pages mapped and only calls back for I/O and writes to ROM. Both
+// must end up in the same state, and the mapped one must never call back
+// for a RAM or ROM read.
+
+#include "../../mos6502.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdint.h>
+
+#define IO_BANK    0xD000   // bank select, bit 0
+#define IO_COUNTER 0xD001   // counts its own reads
+#define BANK       0xE000
+#define ROM        0xF000
+#define ROUTINE    0x0300   // self-modifying, in RAM
+
+struct Machine
+{
+   mos6502* cpu;
+   bool mapped;
+   uint8_t ram[0xD000];
+   uint8_t bank;
+   uint8_t counter;
+   uint64_t calls;          // bus callbacks
+   int leaks;               // RAM or ROM reads through a callback
+};
+
+Machine machines[2];
+
+uint8_t banks[2][0x1000];
+uint8_t rom[0x1000];
+
+template<int M> uint8_t read(uint16_t addr)
+{
+   Machine& m = machines[M];
+   m.calls++;
+   if (addr >= 0xD000 && addr < 0xE000)
+   {
+      if (addr == IO_BANK) return m.bank;
+      if (addr == IO_COUNTER) return m.counter++;
+      return 0x00;
+   }
+   if (m.mapped) m.leaks++;
+   if (addr < 0xD000) return m.ram[addr];
+   if (addr < 0xF000) return banks[m.bank][addr - BANK];
+   return rom[addr - ROM];
+}
+
+template<int M> void write(uint16_t addr, uint8_t val)
+{
+   Machine& m = machines[M];
+   m.calls++;
+   if (addr < 0xD000)
+   {
+      if (m.mapped) m.leaks++;
+      m.ram[addr] = val;
+   }
+   else if (addr == IO_BANK)
+   {
+      m.bank = val & 1;
+      if (m.mapped) m.cpu->MapROM(0xE0, 0xEF, banks[m.bank]);
+#ifdef BLOCK_CACHE
+      // the code changed behind the back of the reference CPU
+      else m.cpu->FlushBlockCache();
+#endif
+   }
+   // writes to ROM are dropped
+}
+
+static const uint8_t program[] = {
+   0xA2, 0x00,             // F000 LDX #0
+   0xBD, 0x00, 0x10,       // F002 LDA $1000,X
+   0x4D, 0x01, 0xD0,       // F005 EOR IO_COUNTER
+   0x20, 0x00, 0xE0,       // F008 JSR BANK
+   0x9D, 0x00, 0x20,       // F00B STA $2000,X
+   0x8D, 0x00, 0xF1,       // F00E STA $F100 (ROM)
+   0x20, 0x00, 0x03,       // F011 JSR ROUTINE
+   0x9D, 0x00, 0x30,       // F014 STA $3000,X
+   0xE8,                   // F017 INX
+   0xD0, 0xE8,             // F018 BNE $F002
+   0xEE, 0x00, 0xD0,       // F01A INC IO_BANK
+   0x4C, 0x00, 0xF0,       // F01D JMP $F000
+};
+
+static const uint8_t bank0[] = {
+   0x18,                   // E000 CLC
+   0x69, 0x01,             // E001 ADC #1
+   0x60,                   // E003 RTS
+};
+
+static const uint8_t bank1[] = {
+   0x38,                   // E000 SEC
+   0xE9, 0x03,             // E001 SBC #3
+   0x0A,                   // E003 ASL A
+   0x60,                   // E004 RTS
+};
+
+static const uint8_t routine[] = {
+   0xA9, 0x00,             // 0300 LDA #0
+   0xEE, 0x01, 0x03,       // 0302 INC $0301
+   0x60,                   // 0305 RTS
+};
+
+void Setup(Machine* m, mos6502* cpu, bool mapped)
+{
+   m->cpu = cpu;
+   m->mapped = mapped;
+   m->bank = 0;
+   m->counter = 0;
+   m->calls = 0;
+   m->leaks = 0;
+   for(int i = 0; i < 0xD000; i++)
+   {
+      m->ram[i] = (uint8_t)(i * 7 + (i >> 8));
+   }
+   memcpy(m->ram + ROUTINE, routine, sizeof(routine));
+   if (mapped)
+   {
+      cpu->MapRAM(0x00, 0xCF, m->ram);
+      cpu->MapROM(0xE0, 0xEF, banks[0]);
+      cpu->MapROM(0xF0, 0xFF, rom);
+   }
+   cpu->Reset();
+}
+
+int main(int argc, char **argv)
+{
+   int slices = argc > 1 ? atoi(argv[1]) : 20000;
+
+   memcpy(banks[0], bank0, sizeof(bank0));
+   memcpy(banks[1], bank1, sizeof(bank1));
+   memcpy(rom, program, sizeof(program));
+   rom[0xFFC] = ROM & 0xFF;
+   rom[0xFFD] = ROM >> 8;
+
+   mos6502 ref(read<0>, write<0>);
+   mos6502 fast(read<1>, write<1>);
+   Setup(&machines[0], &ref, false);
+   Setup(&machines[1], &fast, true);
+
+   uint64_t cyclesRef = 0;
+   uint64_t cyclesFast = 0;
+   uint32_t seed = 1;
+
+   for(int slice = 0; slice < slices; slice++)
+   {
+      seed = seed * 1103515245 + 12345;
+      int32_t budget = 1 + (seed >> 8) % 2000;
+      mos6502::CycleMethod method =
+         (seed >> 30) ? mos6502::CYCLE_COUNT : mos6502::INST_COUNT;
+
+      ref.Run(budget, cyclesRef, method);
+      fast.Run(budget, cyclesFast, method);
+
+      if (cyclesRef != cyclesFast ||
+          ref.GetPC() != fast.GetPC() ||
+          ref.GetA() != fast.GetA() ||
+          ref.GetX() != fast.GetX() ||
+          ref.GetS() != fast.GetS() ||
+          ref.GetP() != fast.GetP() ||
+          machines[0].bank != machines[1].bank ||
+          machines[0].counter != machines[1].counter ||
+          memcmp(machines[0].ram, machines[1].ram, sizeof(machines[0].ram)))
+      {
+         printf("FAIL: slice %d\n", slice);
+         printf("ref:  pc %04X a %02X p %02X cycles %llu bank %d\n",
+               ref.GetPC(), ref.GetA(), ref.GetP(),
+               (unsigned long long)cyclesRef, machines[0].bank);
+         printf("fast: pc %04X a %02X p %02X cycles %llu bank %d\n",
+               fast.GetPC(), fast.GetA(), fast.GetP(),
+               (unsigned long long)cyclesFast, machines[1].bank);
+         return 1;
+      }
+   }
+
+   if (machines[1].leaks)
+   {
+      printf("FAIL: %d RAM or ROM accesses through the callbacks\n",
+            machines[1].leaks);
+      return 1;
+   }
+
+   printf("%d slices, %llu cycles, %llu callbacks instead of %llu: engines agree\n",
+         slices, (unsigned long long)cyclesRef,
+         (unsigned long long)machines[1].calls,
+         (unsigned long long)machines[0].calls);
+   return 0;
+}
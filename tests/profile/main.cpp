@@ -0,0 +1,241 @@
+// compile with "g++ -O3 -DPROFILE main.cpp ../../mos6502.cpp
+// ../../mos6502_profile.cpp -o main"
+//
+// profiles a run in slices, then checks every address against a reference
+// CPU run instruction by instruction: count, cycles, the penalty cycles of
+// the taken branches and page crossings, and the JSRs to the routine. Then
+// reads the callgrind file and the report back. Also prints how fast it
+// runs with and without the profile.
+
+#include "../../mos6502_profile.h"
+#include "../differential.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <chrono>
+
+#define CYCLES   3000000
+#define FILENAME "profile.out"
+
+static const uint8_t program[] = {
+   0xA2, 0x00,             // 0200 LDX #$00
+   0xA9, 0x37,             // 0202 LDA #$37
+   0x9D, 0xF0, 0x10,       // 0204 STA $10F0,X
+   0x7D, 0xF0, 0x10,       // 0207 ADC $10F0,X
+   0x20, 0x00, 0x03,       // 020A JSR $0300
+   0xE8,                   // 020D INX
+   0xD0, 0xF2,             // 020E BNE $0202
+   0xE6, 0x40,             // 0210 INC $40
+   0xA4, 0x40,             // 0212 LDY $40
+   0xB1, 0x30,             // 0214 LDA ($30),Y
+   0x20, 0x00, 0x03,       // 0216 JSR $0300
+   0x4C, 0x00, 0x02,       // 0219 JMP $0200
+};
+
+static const uint8_t routine[] = {
+   0x48,                   // 0300 PHA
+   0x45, 0x41,             // 0301 EOR $41
+   0x85, 0x41,             // 0303 STA $41
+   0x68,                   // 0305 PLA
+   0x60,                   // 0306 RTS
+};
+
+static void Program(uint8_t* ram)
+{
+   memcpy(ram + 0x0200, program, sizeof(program));
+   memcpy(ram + 0x0300, routine, sizeof(routine));
+   ram[0x30] = 0xC0; ram[0x31] = 0x20;
+   ram[0xFFFC] = 0x00; ram[0xFFFD] = 0x02;
+}
+
+static double Seconds(std::chrono::steady_clock::time_point start)
+{
+   return std::chrono::duration<double>(
+         std::chrono::steady_clock::now() - start).count();
+}
+
+static mos6502::ProfileEntry expected[65536];
+static uint64_t fewest[65536];
+
+int main(int argc, char **argv)
+{
+   mos6502 cpu(read, write);
+   mos6502 ref(read, write);
+   Setup(tested, cpu);
+   Setup(reference, ref);
+#ifdef MEMORY_MAP
+   cpu.MapRAM(0x00, 0xFF, tested.ram);
+   ref.MapRAM(0x00, 0xFF, reference.ram);
+#endif
+
+   // a while without the profile first, for the JIT to compile something
+   uint64_t cycles = 0;
+   uint64_t refCycles = 0;
+   current = &tested;
+   cpu.Reset();
+   cpu.Run(20000, cycles, mos6502::INST_COUNT);
+   current = &reference;
+   ref.Reset();
+   ref.Run(20000, refCycles, mos6502::INST_COUNT);
+
+   // the profiled run, in slices of random size
+   mos6502_profile* profile = new mos6502_profile(&cpu);
+   current = &tested;
+   uint64_t start = cycles;
+   uint32_t seed = 0x6502;
+   while(cycles < start + CYCLES)
+   {
+      seed = seed * 1103515245 + 12345;
+      cpu.Run(1 + (seed >> 8) % 5000, cycles);
+   }
+
+   // the reference, one instruction at a time up to the same cycle
+   current = &reference;
+   for(int i = 0; i < 65536; i++)
+   {
+      fewest[i] = UINT64_MAX;
+   }
+   while(refCycles < cycles)
+   {
+      uint16_t pc = ref.GetPC();
+      uint8_t op = reference.ram[pc];
+      uint64_t before = refCycles;
+      ref.Run(1, refCycles, mos6502::INST_COUNT);
+      uint64_t took = refCycles - before;
+      expected[pc].count++;
+      expected[pc].cycles += took;
+      if (took < fewest[pc]) fewest[pc] = took;
+      if (op == 0x20) expected[ref.GetPC()].calls++;
+   }
+   if (refCycles != cycles)
+   {
+      printf("FAIL: the reference ends at cycle %llu, the profiled run at %llu\n",
+            (unsigned long long)refCycles, (unsigned long long)cycles);
+      return 1;
+   }
+
+   // the fewest cycles an address took are its base, the rest penalty;
+   // every address of the program takes its base at least once
+   const mos6502::ProfileEntry* entries = profile->GetEntries();
+   uint16_t hottest = 0;
+   for(int i = 0; i < 65536; i++)
+   {
+      mos6502::ProfileEntry& e = expected[i];
+      if (e.count) e.penalty = e.cycles - e.count * fewest[i];
+      if (e.cycles > expected[hottest].cycles) hottest = i;
+      const mos6502::ProfileEntry& p = entries[i];
+      if (p.count != e.count || p.cycles != e.cycles ||
+            p.penalty != e.penalty || p.calls != e.calls)
+      {
+         printf("FAIL: address %04X\n", i);
+         printf("profile:   count %llu cycles %llu penalty %llu calls %llu\n",
+               (unsigned long long)p.count, (unsigned long long)p.cycles,
+               (unsigned long long)p.penalty, (unsigned long long)p.calls);
+         printf("reference: count %llu cycles %llu penalty %llu calls %llu\n",
+               (unsigned long long)e.count, (unsigned long long)e.cycles,
+               (unsigned long long)e.penalty, (unsigned long long)e.calls);
+         return 1;
+      }
+   }
+   if (profile->GetCycles() != cycles - start)
+   {
+      printf("FAIL: %llu cycles profiled of %llu\n",
+            (unsigned long long)profile->GetCycles(), (unsigned long long)(cycles - start));
+      return 1;
+   }
+   if (!entries[0x0207].penalty || !entries[0x020E].penalty || !entries[0x0214].penalty ||
+         entries[0x0300].calls != entries[0x020A].count + entries[0x0216].count)
+   {
+      printf("FAIL: the program did not take the penalties and calls it should\n");
+      return 1;
+   }
+
+   // the callgrind file adds up to the same
+   if (!profile->WriteCallgrind(FILENAME, "profile test"))
+   {
+      printf("FAIL: cannot write %s\n", FILENAME);
+      return 1;
+   }
+   FILE* file = fopen(FILENAME, "r");
+   char line[256];
+   unsigned long long sum[3] = {0, 0, 0};
+   unsigned long long summary[3] = {0, 0, 0};
+   unsigned int addr;
+   unsigned long long n[3];
+   char fn[64] = "";
+   bool routineNamed = false;
+   while(fgets(line, sizeof(line), file))
+   {
+      if (sscanf(line, "summary: %llu %llu %llu", &summary[0], &summary[1], &summary[2]) == 3)
+      {
+         continue;
+      }
+      if (sscanf(line, "fn=%63s", fn) == 1)
+      {
+         continue;
+      }
+      if (sscanf(line, "0x%x %llu %llu %llu", &addr, &n[0], &n[1], &n[2]) == 4)
+      {
+         if (addr == 0x0300) routineNamed = strcmp(fn, "sub_0300") == 0;
+         for(int k = 0; k < 3; k++)
+         {
+            sum[k] += n[k];
+         }
+      }
+   }
+   fclose(file);
+   remove(FILENAME);
+   if (sum[0] != profile->GetInstructions() || sum[1] != cycles - start ||
+         summary[0] != sum[0] || summary[1] != sum[1] || summary[2] != sum[2] ||
+         !routineNamed)
+   {
+      printf("FAIL: the callgrind file has %llu instructions, %llu cycles, %llu penalty "
+            "(summary %llu %llu %llu)%s\n", sum[0], sum[1], sum[2],
+            summary[0], summary[1], summary[2], routineNamed ? "" : ", no sub_0300");
+      return 1;
+   }
+
+   // and the report starts with the hottest address
+   file = tmpfile();
+   profile->Report(file, 5);
+   rewind(file);
+   if (!fgets(line, sizeof(line), file) || !fgets(line, sizeof(line), file) ||
+         sscanf(line, "%x", &addr) != 1 || addr != hottest)
+   {
+      printf("FAIL: the report does not start with %04X\n", hottest);
+      return 1;
+   }
+   fclose(file);
+
+   profile->Clear();
+   if (profile->GetInstructions() || profile->GetCycles())
+   {
+      printf("FAIL: the profile is not empty after Clear()\n");
+      return 1;
+   }
+
+   // throughput, the same CPU with and without the profile
+   const int64_t total = 20000000;
+   current = &tested;
+   auto begin = std::chrono::steady_clock::now();
+   for(int64_t i = 0; i < total; i += 10000)
+   {
+      cpu.Run(10000, cycles, mos6502::INST_COUNT);
+   }
+   double onSeconds = Seconds(begin);
+   delete profile;
+
+   begin = std::chrono::steady_clock::now();
+   for(int64_t i = 0; i < total; i += 10000)
+   {
+      cpu.Run(10000, cycles, mos6502::INST_COUNT);
+   }
+   double offSeconds = Seconds(begin);
+
+   printf("%d cycles profiled in slices: every address matches the reference\n", CYCLES);
+   printf("%.1f MIPS without the profile, %.1f MIPS profiled\n",
+         total / offSeconds / 1e6, total / onSeconds / 1e6);
+   return 0;
+}
@@ -0,0 +1,253 @@
+// compile with "g++ -O3 -DBUS_CONTEXT main.cpp ../../mos6502.cpp
+// ../../mos6502_replay.cpp -o main"
+//
+// records a run of a machine whose I/O gives random numbers and the time,
+// raises a timer IRQ from its clock and takes NMIs from the host between
+// slices. Then replays the log on a CPU with nothing but RAM, which must
+// end in the same state, and once more with the IRQ handler changed, which
+// must diverge at its first I/O read.
+
+#include "../../mos6502_replay.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <chrono>
+
+#define SLICES    300
+#define IO        0xD0
+#define IO_RANDOM 0xD000
+#define IO_TIMER  0xD001    // low byte of the cycle stamp
+#define IO_ACK    0xD002    // a write releases the IRQ line
+
+static const uint8_t program[] = {
+   0x58,                   // 0200 CLI
+   0xAD, 0x00, 0xD0,       // 0201 LDA IO_RANDOM
+   0xAA,                   // 0204 TAX
+   0xFE, 0x00, 0x10,       // 0205 INC $1000,X
+   0x29, 0x07,             // 0208 AND #$07
+   0xA8,                   // 020A TAY
+   0xA5, 0x42,             // 020B LDA $42
+   0xF8,                   // 020D SED
+   0x7D, 0x00, 0x10,       // 020E ADC $1000,X
+   0xD8,                   // 0211 CLD
+   0x85, 0x42,             // 0212 STA $42
+   0x88,                   // 0214 DEY
+   0x10, 0xFD,             // 0215 BPL $0214
+   0xA5, 0x40,             // 0217 LDA $40
+   0x29, 0x01,             // 0219 AND #$01
+   0xF0, 0xE4,             // 021B BEQ $0201
+   0xFE, 0x00, 0x20,       // 021D INC $2000,X
+   0x4C, 0x01, 0x02,       // 0220 JMP $0201
+};
+
+static const uint8_t irq[] = {
+   0x48,                   // 0300 PHA
+   0xAD, 0x01, 0xD0,       // 0301 LDA IO_TIMER
+   0x85, 0x43,             // 0304 STA $43
+   0xE6, 0x40,             // 0306 INC $40
+   0x8D, 0x02, 0xD0,       // 0308 STA IO_ACK
+   0x68,                   // 030B PLA
+   0x40,                   // 030C RTI
+};
+
+static const uint8_t nmi[] = {
+   0x48,                   // 0400 PHA
+   0xAD, 0x00, 0xD0,       // 0401 LDA IO_RANDOM
+   0x45, 0x44,             // 0404 EOR $44
+   0x85, 0x44,             // 0406 STA $44
+   0xE6, 0x41,             // 0408 INC $41
+   0x68,                   // 040A PLA
+   0x40,                   // 040B RTI
+};
+
+struct Machine
+{
+   mos6502_replay* replay;
+   uint8_t ram[65536];
+
+   // the devices, only when recording
+   uint32_t random;
+   uint64_t time;
+   uint64_t nextIrq;
+   uint64_t firstTimerRead;   // stamp, 0 until then
+};
+
+uint8_t read(void* ctx, uint16_t addr)
+{
+   Machine* m = (Machine*)ctx;
+   if ((addr >> 8) != IO) return m->ram[addr];
+
+   if (addr == IO_RANDOM)
+   {
+      m->random ^= m->random << 13;
+      m->random ^= m->random >> 17;
+      m->random ^= m->random << 5;
+      return m->random;
+   }
+   if (addr == IO_TIMER)
+   {
+      if (!m->firstTimerRead)
+      {
+         mos6502::State state;
+         m->replay->GetCpu()->SaveState(state);
+         m->firstTimerRead = state.cycleStamp;
+      }
+      return m->time;
+   }
+   return 0x00;
+}
+
+void write(void* ctx, uint16_t addr, uint8_t value)
+{
+   Machine* m = (Machine*)ctx;
+   if ((addr >> 8) != IO) m->ram[addr] = value;
+   else if (addr == IO_ACK) m->replay->IRQ(true);
+}
+
+static Machine recorded;
+static Machine replayed;
+
+void timer(mos6502* cpu, uint32_t n, uint64_t stamp)
+{
+   recorded.time = stamp;
+   if (stamp >= recorded.nextIrq)
+   {
+      recorded.replay->IRQ(false);
+      recorded.nextIrq = stamp + 700 + recorded.random % 300;
+   }
+}
+
+struct Slice
+{
+   int32_t budget;
+   mos6502::CycleMethod method;
+   bool nmi;                // toggle the NMI line after the slice
+};
+
+static Slice slices[SLICES];
+
+static void Setup(Machine& m, mos6502_replay::Mode mode)
+{
+   memset(m.ram, 0, sizeof(m.ram));
+   memcpy(m.ram + 0x0200, program, sizeof(program));
+   memcpy(m.ram + 0x0300, irq, sizeof(irq));
+   memcpy(m.ram + 0x0400, nmi, sizeof(nmi));
+   m.ram[0xFFFA] = 0x00; m.ram[0xFFFB] = 0x04;
+   m.ram[0xFFFC] = 0x00; m.ram[0xFFFD] = 0x02;
+   m.ram[0xFFFE] = 0x00; m.ram[0xFFFF] = 0x03;
+   m.random = 0x6502;
+   m.time = 0;
+   m.nextIrq = 500;
+   m.firstTimerRead = 0;
+
+   m.replay = new mos6502_replay(mode, read, write, &m,
+         mode == mos6502_replay::RECORD ? timer : nullptr);
+   m.replay->SetIO(IO, IO, true);
+#ifdef MEMORY_MAP
+   m.replay->GetCpu()->MapRAM(0x00, IO - 1, m.ram);
+   m.replay->GetCpu()->MapRAM(IO + 1, 0xFF, m.ram + (IO + 1) * 256);
+#endif
+   m.replay->GetCpu()->Reset();
+}
+
+static uint64_t Run(Machine& m)
+{
+   uint64_t cycles = 0;
+   bool line = true;
+   for(int i = 0; i < SLICES; i++)
+   {
+      m.replay->GetCpu()->Run(slices[i].budget, cycles, slices[i].method);
+      if (slices[i].nmi)
+      {
+         line = !line;
+         m.replay->NMI(line);
+      }
+   }
+   return cycles;
+}
+
+static double Seconds(std::chrono::steady_clock::time_point start)
+{
+   return std::chrono::duration<double>(
+         std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char **argv)
+{
+   uint32_t seed = 0x6502;
+   for(int i = 0; i < SLICES; i++)
+   {
+      seed = seed * 1103515245 + 12345;
+      uint32_t r = seed >> 8;
+      slices[i].budget = 1 + r % 5000;
+      slices[i].method = (r >> 13) & 1 ? mos6502::CYCLE_COUNT : mos6502::INST_COUNT;
+      slices[i].nmi = (r >> 14) % 4 == 0;
+   }
+
+   Setup(recorded, mos6502_replay::RECORD);
+   auto start = std::chrono::steady_clock::now();
+   uint64_t cycles = Run(recorded);
+   double recordSeconds = Seconds(start);
+   mos6502* a = recorded.replay->GetCpu();
+
+   if (!recorded.firstTimerRead || !recorded.ram[0x40] || !recorded.ram[0x41])
+   {
+      printf("FAIL: the recording took no IRQ (%d) or no NMI (%d)\n",
+            recorded.ram[0x40], recorded.ram[0x41]);
+      return 1;
+   }
+
+   // the same run from the log, with the devices gone
+   Setup(replayed, mos6502_replay::REPLAY);
+   mos6502_replay* r = replayed.replay;
+   r->SetLog(recorded.replay->GetLog(), recorded.replay->GetLogSize());
+   start = std::chrono::steady_clock::now();
+   uint64_t again = Run(replayed);
+   double replaySeconds = Seconds(start);
+   mos6502* b = r->GetCpu();
+
+   if (r->Diverged() || !r->AtEnd() || again != cycles ||
+       a->GetPC() != b->GetPC() || a->GetA() != b->GetA() ||
+       a->GetX() != b->GetX() || a->GetY() != b->GetY() ||
+       a->GetS() != b->GetS() || a->GetP() != b->GetP() ||
+       memcmp(recorded.ram, replayed.ram, IO * 256))
+   {
+      printf("FAIL: replay %s at %llu, %s\n", r->Diverged() ? "diverged" : "did not diverge",
+            (unsigned long long)r->GetDivergence(), r->AtEnd() ? "at the end" : "not at the end");
+      printf("recorded: pc %04X a %02X x %02X y %02X s %02X p %02X cycles %llu\n",
+            a->GetPC(), a->GetA(), a->GetX(), a->GetY(), a->GetS(), a->GetP(),
+            (unsigned long long)cycles);
+      printf("replayed: pc %04X a %02X x %02X y %02X s %02X p %02X cycles %llu\n",
+            b->GetPC(), b->GetA(), b->GetX(), b->GetY(), b->GetS(), b->GetP(),
+            (unsigned long long)again);
+      return 1;
+   }
+   delete r;
+
+   // the IRQ handler reads IO_RANDOM instead of IO_TIMER: the replay must
+   // leave the log at the first IRQ
+   Setup(replayed, mos6502_replay::REPLAY);
+   r = replayed.replay;
+   replayed.ram[0x0302] = IO_RANDOM & 0xFF;
+   r->SetLog(recorded.replay->GetLog(), recorded.replay->GetLogSize());
+   Run(replayed);
+   if (!r->Diverged() || r->GetDivergence() != recorded.firstTimerRead)
+   {
+      printf("FAIL: changed replay %s at %llu, expected %llu\n",
+            r->Diverged() ? "diverged" : "did not diverge",
+            (unsigned long long)r->GetDivergence(),
+            (unsigned long long)recorded.firstTimerRead);
+      return 1;
+   }
+   delete r;
+
+   printf("%llu cycles, %d IRQs, %d NMIs: %zu bytes of log, replayed and diverging as expected\n",
+         (unsigned long long)cycles, recorded.ram[0x40], recorded.ram[0x41],
+         recorded.replay->GetLogSize());
+   printf("record %.1f MHz, replay %.1f MHz\n",
+         cycles / recordSeconds / 1e6, cycles / replaySeconds / 1e6);
+   delete recorded.replay;
+   return 0;
+}
@@ -0,0 +1,360 @@
+// compile with "g++ -O3 -DBUS_CONTEXT -DMEMORY_MAP main.cpp
+// ../../mos6502.cpp ../../mos6502_rewind.cpp -o main"
+//
+// runs a program with I/O, IRQs and self-modifying code that writes all
+// over the memory, then goes back to random cycles, newest first, and
+// steps back from some of them. At each one the registers, the memory and
+// the device must match a reference CPU run forward once, instruction by
+// instruction; and again after running forward from there. Also prints
+// what the snapshots cost Run().
+
+#include "../../mos6502_rewind.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <vector>
+
+#define CYCLES    4000000
+#define INTERVAL  20000
+#define MEMORY    (256 << 10)
+#define TARGETS   40
+#define STEPS     3         // back from every fourth target
+#define IO        0xE0
+#define IO_RANDOM 0xE000
+#define IO_ACK    0xE001    // a write releases the IRQ line
+#define IO_IRQ    0xE002    // a write pulls it
+
+static const uint8_t program[] = {
+   0x58,                   // 0200 CLI
+   0xA2, 0x00,             // 0201 LDX #$00
+   0xBD, 0x00, 0x10,       // 0203 LDA $1000,X
+   0x69, 0x03,             // 0206 ADC #$03      operand changed below
+   0x9D, 0x00, 0x10,       // 0208 STA $1000,X
+   0xEE, 0x07, 0x02,       // 020B INC $0207
+   0xE8,                   // 020E INX
+   0xD0, 0xF2,             // 020F BNE $0203
+   0xAD, 0x00, 0xE0,       // 0211 LDA IO_RANDOM
+   0xA8,                   // 0214 TAY
+   0x91, 0x30,             // 0215 STA ($30),Y
+   0xE6, 0x31,             // 0217 INC $31
+   0xA5, 0x31,             // 0219 LDA $31
+   0xC9, 0xD0,             // 021B CMP #$D0
+   0x90, 0x04,             // 021D BCC $0223
+   0xA9, 0x20,             // 021F LDA #$20
+   0x85, 0x31,             // 0221 STA $31
+   0x98,                   // 0223 TYA
+   0x29, 0x0F,             // 0224 AND #$0F
+   0xD0, 0x03,             // 0226 BNE $022B
+   0x8D, 0x02, 0xE0,       // 0228 STA IO_IRQ
+   0x4C, 0x01, 0x02,       // 022B JMP $0201
+};
+
+static const uint8_t irq[] = {
+   0x48,                   // 0300 PHA
+   0xE6, 0x40,             // 0301 INC $40
+   0x8D, 0x01, 0xE0,       // 0303 STA IO_ACK
+   0x68,                   // 0306 PLA
+   0x40,                   // 0307 RTI
+};
+
+struct Machine
+{
+   mos6502* cpu;
+   uint8_t ram[65536];
+   uint32_t random;
+   std::map<uint32_t, uint32_t> saved;   // random at each snapshot
+};
+
+uint8_t read(void* ctx, uint16_t addr)
+{
+   Machine* m = (Machine*)ctx;
+   if ((addr >> 8) != IO) return m->ram[addr];
+   if (addr != IO_RANDOM) return 0x00;
+   m->random ^= m->random << 13;
+   m->random ^= m->random >> 17;
+   m->random ^= m->random << 5;
+   return m->random;
+}
+
+void write(void* ctx, uint16_t addr, uint8_t value)
+{
+   Machine* m = (Machine*)ctx;
+   if ((addr >> 8) != IO) m->ram[addr] = value;
+   else if (addr == IO_ACK) m->cpu->IRQ(true);
+   else if (addr == IO_IRQ) m->cpu->IRQ(false);
+}
+
+void device(void* ctx, uint32_t id, mos6502_rewind::DeviceOp op)
+{
+   Machine* m = (Machine*)ctx;
+   switch(op)
+   {
+      case mos6502_rewind::TAKE:    m->saved[id] = m->random; break;
+      case mos6502_rewind::RESTORE: m->random = m->saved[id]; break;
+      case mos6502_rewind::DROP:    m->saved.erase(id); break;
+   }
+}
+
+static void Setup(Machine& m)
+{
+   memset(m.ram, 0, sizeof(m.ram));
+   memcpy(m.ram + 0x0200, program, sizeof(program));
+   memcpy(m.ram + 0x0300, irq, sizeof(irq));
+   m.ram[0x30] = 0x00; m.ram[0x31] = 0x20;
+   m.ram[0xFFFC] = 0x00; m.ram[0xFFFD] = 0x02;
+   m.ram[0xFFFE] = 0x00; m.ram[0xFFFF] = 0x03;
+   m.random = 0x6502;
+}
+
+// what is compared at a boundary
+struct Check
+{
+   uint64_t cycles;
+   mos6502::State state;
+   uint64_t hash;           // of the memory, 0 if not taken
+   uint32_t random;
+};
+
+static Check Take(Machine& m, uint64_t cycles, bool memory)
+{
+   Check c;
+   c.cycles = cycles;
+   m.cpu->SaveState(c.state);
+   c.hash = 0;
+   if (memory)
+   {
+      c.hash = 14695981039346656037ull;
+      for(int a = 0; a < 65536; a++)
+      {
+         c.hash = (c.hash ^ m.ram[a]) * 1099511628211ull;
+      }
+   }
+   c.random = m.random;
+   return c;
+}
+
+static bool Same(const Check& a, const Check& b, const char* what)
+{
+   const mos6502::State& s = a.state;
+   const mos6502::State& t = b.state;
+   if (a.cycles == b.cycles && s.pc == t.pc && s.A == t.A && s.X == t.X &&
+       s.Y == t.Y && s.sp == t.sp && s.status == t.status &&
+       s.irq_line == t.irq_line && (!a.hash || !b.hash || a.hash == b.hash) &&
+       a.random == b.random)
+   {
+      return true;
+   }
+
+   printf("FAIL: %s\n", what);
+   printf("rewound:   pc %04X a %02X x %02X y %02X s %02X p %02X irq %d cycles %llu random %08X\n",
+         s.pc, s.A, s.X, s.Y, s.sp, s.status, s.irq_line,
+         (unsigned long long)a.cycles, a.random);
+   printf("reference: pc %04X a %02X x %02X y %02X s %02X p %02X irq %d cycles %llu random %08X\n",
+         t.pc, t.A, t.X, t.Y, t.sp, t.status, t.irq_line,
+         (unsigned long long)b.cycles, b.random);
+   if (a.hash != b.hash) printf("the memory differs\n");
+   return false;
+}
+
+static uint32_t seed = 0x6502;
+
+static uint32_t rnd()
+{
+   seed ^= seed << 13;
+   seed ^= seed >> 17;
+   seed ^= seed << 5;
+   return seed;
+}
+
+static Machine machine;
+static Machine reference;
+
+static double Seconds(std::chrono::steady_clock::time_point start)
+{
+   return std::chrono::duration<double>(
+         std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char **argv)
+{
+   Setup(machine);
+   mos6502_rewind* rewind = new mos6502_rewind(read, write, &machine,
+         INTERVAL, MEMORY, device);
+   machine.cpu = rewind->GetCpu();
+   rewind->MapRAM(0x00, IO - 1, machine.ram);
+   rewind->MapRAM(IO + 1, 0xFF, machine.ram + (IO + 1) * 256);
+   machine.cpu->Reset();
+
+   while(rewind->GetCycles() < CYCLES)
+   {
+      uint32_t r = rnd();
+      rewind->Run(1 + r % 5000, (r >> 16) & 1 ? mos6502::CYCLE_COUNT : mos6502::INST_COUNT);
+#ifdef BREAKPOINTS
+      // maps every page again from the page table the core keeps
+      machine.cpu->ClearBreakpoints();
+#endif
+   }
+   uint64_t end = rewind->GetCycles();
+   uint64_t oldest = rewind->GetOldest();
+   if (!oldest || rewind->GetMemory() > MEMORY + 65536 || !machine.ram[0x40] ||
+       (int)machine.saved.size() != rewind->GetSnapshots())
+   {
+      printf("FAIL: oldest snapshot at %llu, %zu bytes, %d IRQs, %zu device states for %d snapshots\n",
+            (unsigned long long)oldest, rewind->GetMemory(), machine.ram[0x40],
+            machine.saved.size(), rewind->GetSnapshots());
+      return 1;
+   }
+   Check last = Take(machine, end, true);
+
+   std::vector<uint64_t> targets;
+   targets.push_back(oldest);
+   targets.push_back(oldest + 1);
+   targets.push_back(end);
+   while(targets.size() < TARGETS)
+   {
+      targets.push_back(oldest + rnd() % (end - oldest));
+   }
+   std::sort(targets.begin(), targets.end());
+
+   // the reference, instruction by instruction, with the boundaries before
+   // each target
+   Setup(reference);
+   reference.cpu = new mos6502(read, write, &reference);
+   reference.cpu->Reset();
+   std::vector<Check> checks;
+   std::vector<std::vector<Check>> before;
+   std::vector<Check> history;
+   uint64_t cycles = 0;
+   for(uint64_t t : targets)
+   {
+      while(cycles < t)
+      {
+         history.push_back(Take(reference, cycles, false));
+         if (history.size() > STEPS) history.erase(history.begin());
+         reference.cpu->Run(1, cycles, mos6502::INST_COUNT);
+      }
+      checks.push_back(Take(reference, cycles, true));
+      before.push_back(history);
+   }
+   if (!Same(last, checks.back(), "the run forward"))
+   {
+      return 1;
+   }
+
+   // newest first
+   int steps = 0;
+   auto start = std::chrono::steady_clock::now();
+   for(int i = TARGETS - 1; i >= 0; i--)
+   {
+      char what[64];
+      snprintf(what, sizeof(what), "back to %llu", (unsigned long long)targets[i]);
+      if (!rewind->RunBackTo(targets[i]) ||
+          !Same(Take(machine, rewind->GetCycles(), true), checks[i], what))
+      {
+         return 1;
+      }
+      if (i % 4) continue;
+
+      for(int k = (int)before[i].size() - 1; k >= 0; k--)
+      {
+         const Check& c = before[i][k];
+         bool back = rewind->StepBack();
+         if (c.cycles < oldest)
+         {
+            if (!back) break;
+            printf("FAIL: stepped back before the oldest snapshot\n");
+            return 1;
+         }
+         snprintf(what, sizeof(what), "step back to %llu", (unsigned long long)c.cycles);
+         if (!back)
+         {
+            printf("FAIL: no %s\n", what);
+            return 1;
+         }
+         if (!Same(Take(machine, rewind->GetCycles(), false), c, what))
+         {
+            return 1;
+         }
+         steps++;
+      }
+      while(rewind->GetCycles() < checks[i].cycles)
+      {
+         rewind->Run(1, mos6502::INST_COUNT);
+      }
+      snprintf(what, sizeof(what), "forward again to %llu", (unsigned long long)targets[i]);
+      if (!Same(Take(machine, rewind->GetCycles(), true), checks[i], what))
+      {
+         return 1;
+      }
+   }
+   double backSeconds = Seconds(start);
+
+   if (rewind->RunBackTo(oldest - 1) || rewind->RunBackTo(rewind->GetCycles() + 1))
+   {
+      printf("FAIL: went back before the oldest snapshot or forward\n");
+      return 1;
+   }
+
+   // the future again, in slices as Run() would take them
+   while(end - rewind->GetCycles() > 64)
+   {
+      rewind->Run(1 + rnd() % ((end - rewind->GetCycles()) / 4));
+   }
+   while(rewind->GetCycles() < end)
+   {
+      rewind->Run(1, mos6502::INST_COUNT);
+   }
+   if (!Same(Take(machine, rewind->GetCycles(), true), last, "the run forward again"))
+   {
+      return 1;
+   }
+   delete rewind;
+   delete reference.cpu;
+
+   // what the snapshots cost, against a CPU with the memory mapped and
+   // nothing else, both with the default interval and memory
+   const int32_t slice = 10000;
+   const uint64_t total = 200000000;
+   Setup(machine);
+   mos6502* plain = new mos6502(read, write, &machine);
+   machine.cpu = plain;
+   plain->MapRAM(0x00, IO - 1, machine.ram);
+   plain->MapRAM(IO + 1, 0xFF, machine.ram + (IO + 1) * 256);
+   plain->Reset();
+   cycles = 0;
+   start = std::chrono::steady_clock::now();
+   while(cycles < total)
+   {
+      plain->Run(slice, cycles);
+   }
+   double plainSeconds = Seconds(start);
+   delete plain;
+
+   Setup(machine);
+   rewind = new mos6502_rewind(read, write, &machine);
+   machine.cpu = rewind->GetCpu();
+   rewind->MapRAM(0x00, IO - 1, machine.ram);
+   rewind->MapRAM(IO + 1, 0xFF, machine.ram + (IO + 1) * 256);
+   machine.cpu->Reset();
+   start = std::chrono::steady_clock::now();
+   while(rewind->GetCycles() < total)
+   {
+      rewind->Run(slice);
+   }
+   double rewindSeconds = Seconds(start);
+
+   printf("%d targets back from %llu cycles and %d steps back: rewound runs agree, "
+         "%.1f ms each\n", TARGETS, (unsigned long long)end, steps,
+         backSeconds * 1000 / TARGETS);
+   printf("Run(): %.1f MHz plain, %.1f MHz with %d snapshots of %zu KB (%+.1f%%)\n",
+         total / plainSeconds / 1e6, total / rewindSeconds / 1e6,
+         rewind->GetSnapshots(), rewind->GetMemory() >> 10,
+         (rewindSeconds / plainSeconds - 1) * 100);
+   delete rewind;
+   return 0;
+}
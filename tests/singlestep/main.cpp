@@ -32,6 +32,9 @@ mos6502 *cpu = NULL;
 int linenum;
 uint64_t cycles;
 uint64_t actual_cycles;
+uint64_t ticked_cycles;
+uint64_t last_stamp;
+bool bad_stamp;
 int failures = 0;
 bool is_unstable = false;
 const char *name = NULL;
@@ -49,8 +52,13 @@ uint8_t readRam(uint16_t addr)
    return ram[addr];
 }
 
-void tick(mos6502*)
+void tick(mos6502*, uint32_t n, uint64_t stamp)
 {
+   ticked_cycles += n;
+   if (stamp != last_stamp + n) {
+      bad_stamp = true;
+   }
+   last_stamp = stamp;
 }
 
 void translate(void)
@@ -216,6 +224,11 @@ void handle_initial(char *copy)
       q++;
    }
 
+#ifdef BLOCK_CACHE
+   // the ram was rewritten behind the back of the CPU
+   cpu->FlushBlockCache();
+#endif
+
    free(copy);
 }
 
@@ -292,6 +305,8 @@ void handle_line(const char *line)
    handle_initial(strdup(line));
 
    actual_cycles = 0;
+   ticked_cycles = 0;
+   bad_stamp = false;
 
    bool jammed = false;
 
@@ -303,6 +318,11 @@ void handle_line(const char *line)
          sprintf(buf, "FAIL: actual %d != %d cycles at %d", (int) actual_cycles, (int) cycles, linenum);
          fail(buf);
       }
+      if (ticked_cycles != actual_cycles || bad_stamp) {
+         char buf[1024];
+         sprintf(buf, "FAIL: clock callback got %d cycles, run %d at %d", (int) ticked_cycles, (int) actual_cycles, linenum);
+         fail(buf);
+      }
    }
    else {
       jammed = true;
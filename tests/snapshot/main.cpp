@@ -0,0 +1,329 @@
+// compile with "g++ -O3 -DMEMORY_MAP main.cpp ../../mos6502.cpp -o main"
+//
+// runs a program with interrupts, I/O, decimal mode and self-modifying
+// code in slices, takes a snapshot half way, then restores it twice: on
+// the same CPU and on a new one. Both must run the second half exactly as
+// the first time, slice by slice: registers, cycles, clock stamps, memory.
+// Also prints what a snapshot costs.
+
+#include "../../mos6502.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <chrono>
+
+#define SLICES    400
+#define SNAPSHOT  150       // taken before this slice
+#define IO_COUNT  0xE000    // counts its own reads
+#define IO_ACK    0xE001    // a write releases the IRQ line
+
+static const uint8_t program[] = {
+   0x58,                   // 0200 CLI
+   0xA2, 0x00,             // 0201 LDX #$00
+   0xBD, 0x00, 0x10,       // 0203 LDA $1000,X
+   0x69, 0x03,             // 0206 ADC #$03      operand changed below
+   0x9D, 0x00, 0x10,       // 0208 STA $1000,X
+   0xEE, 0x07, 0x02,       // 020B INC $0207
+   0xE8,                   // 020E INX
+   0xD0, 0xF2,             // 020F BNE $0203
+   0x20, 0x00, 0x03,       // 0211 JSR $0300
+   0x4C, 0x01, 0x02,       // 0214 JMP $0201
+};
+
+// IRQs masked, so that they stay pending for a while
+static const uint8_t routine[] = {
+   0x78,                   // 0300 SEI
+   0xAD, 0x00, 0xE0,       // 0301 LDA IO_COUNT
+   0x48,                   // 0304 PHA
+   0x45, 0x20,             // 0305 EOR $20
+   0x85, 0x20,             // 0307 STA $20
+   0x68,                   // 0309 PLA
+   0xF8,                   // 030A SED
+   0x65, 0x21,             // 030B ADC $21
+   0x85, 0x21,             // 030D STA $21
+   0xD8,                   // 030F CLD
+   0x58,                   // 0310 CLI
+   0x60,                   // 0311 RTS
+};
+
+static const uint8_t irq[] = {
+   0x48,                   // 0400 PHA
+   0xE6, 0x22,             // 0401 INC $22
+   0xA5, 0x22,             // 0403 LDA $22
+   0x8D, 0x01, 0xE0,       // 0405 STA IO_ACK
+   0x68,                   // 0408 PLA
+   0x40,                   // 0409 RTI
+};
+
+// long enough to be inside it at the end of a slice, with IRQs held off
+static const uint8_t nmi[] = {
+   0xA0, 0x40,             // 0500 LDY #$40
+   0x88,                   // 0502 DEY
+   0xD0, 0xFD,             // 0503 BNE $0502
+   0xE6, 0x23,             // 0505 INC $23
+   0x40,                   // 0507 RTI
+};
+
+// RAM below $E000, I/O at $E0xx, ROM from $F000 (the vectors)
+struct Machine
+{
+   mos6502* cpu;
+   uint8_t ram[65536];
+   uint8_t count;
+   uint64_t stamp;
+};
+
+static Machine m;
+
+uint8_t read(uint16_t addr)
+{
+   if (addr == IO_COUNT) return m.count++;
+   if ((addr >> 8) == 0xE0) return 0x00;
+   return m.ram[addr];
+}
+
+void write(uint16_t addr, uint8_t value)
+{
+   if (addr == IO_ACK) m.cpu->IRQ(true);
+   else if (addr < 0xE000) m.ram[addr] = value;
+}
+
+void clocked(mos6502*, uint32_t, uint64_t stamp)
+{
+   m.stamp = stamp;
+}
+
+struct Slice
+{
+   int32_t budget;
+   mos6502::CycleMethod method;
+   bool irq;                // assert the IRQ line after the slice
+   bool nmi;                // pulse the NMI line after the slice
+};
+
+struct Trace
+{
+   mos6502::State state;
+   uint64_t cycles;
+   uint64_t stamp;
+   uint8_t count;
+   uint32_t hash;
+};
+
+static Slice slices[SLICES];
+
+static mos6502* Create(bool clock)
+{
+   mos6502* cpu = clock ? new mos6502(read, write, clocked) : new mos6502(read, write);
+#ifdef MEMORY_MAP
+   cpu->MapRAM(0x00, 0xDF, m.ram);
+   cpu->MapROM(0xF0, 0xFF, m.ram + 0xF000);
+#endif
+   return cpu;
+}
+
+static void Run(int slice, uint64_t& cycles, Trace& trace)
+{
+   // the lines change between slices, so that a snapshot may find an
+   // interrupt pending
+   const Slice& s = slices[slice];
+   m.cpu->Run(s.budget, cycles, s.method);
+   if (s.irq) m.cpu->IRQ(false);
+   if (s.nmi)
+   {
+      m.cpu->NMI(true);
+      m.cpu->NMI(false);
+   }
+
+   m.cpu->SaveState(trace.state);
+   trace.cycles = cycles;
+   trace.stamp = m.stamp;
+   trace.count = m.count;
+   trace.hash = 2166136261u;
+   for(int i = 0; i < 65536; i++)
+   {
+      trace.hash = (trace.hash ^ m.ram[i]) * 16777619u;
+   }
+}
+
+static bool Same(const Trace& a, const Trace& b)
+{
+   return a.state.cycleStamp == b.state.cycleStamp &&
+      a.state.pc == b.state.pc && a.state.A == b.state.A &&
+      a.state.X == b.state.X && a.state.Y == b.state.Y &&
+      a.state.sp == b.state.sp && a.state.status == b.state.status &&
+      a.state.illegalOpcode == b.state.illegalOpcode &&
+      a.state.irq_line == b.state.irq_line &&
+      a.state.nmi_request == b.state.nmi_request &&
+      a.state.nmi_inhibit == b.state.nmi_inhibit &&
+      a.state.nmi_line == b.state.nmi_line &&
+      a.cycles == b.cycles && a.stamp == b.stamp &&
+      a.count == b.count && a.hash == b.hash;
+}
+
+static void Print(const char* name, const Trace& t)
+{
+   printf("%s: pc %04X a %02X x %02X y %02X s %02X p %02X irq %d nmi %d/%d/%d "
+         "cycles %llu stamp %llu count %02X ram %08X\n", name, t.state.pc,
+         t.state.A, t.state.X, t.state.Y, t.state.sp, t.state.status,
+         t.state.irq_line, t.state.nmi_request, t.state.nmi_inhibit,
+         t.state.nmi_line, (unsigned long long)t.cycles,
+         (unsigned long long)t.stamp, t.count, t.hash);
+}
+
+// the RAM of the snapshot, through the page table when there is one
+static uint8_t saved[65536];
+static uint8_t savedCount;
+static mos6502::State savedState;
+static uint64_t savedCycles;
+
+static void Save(uint64_t cycles)
+{
+   m.cpu->SaveState(savedState);
+#ifdef MEMORY_MAP
+   m.cpu->SaveRAM(saved);
+#else
+   memcpy(saved, m.ram, 0xE000);
+#endif
+   savedCount = m.count;
+   savedCycles = cycles;
+}
+
+static void Restore(uint64_t& cycles)
+{
+   m.cpu->LoadState(savedState);
+#ifdef MEMORY_MAP
+   m.cpu->LoadRAM(saved);
+#else
+   memcpy(m.ram, saved, 0xE000);
+#ifdef BLOCK_CACHE
+   // the code changed behind the back of the CPU
+   m.cpu->FlushBlockCache();
+#endif
+#endif
+   m.count = savedCount;
+   cycles = savedCycles;
+}
+
+static bool Check(bool clock)
+{
+   static Trace first[SLICES];
+   Trace again;
+
+   memset(m.ram, 0, sizeof(m.ram));
+   memcpy(m.ram + 0x0200, program, sizeof(program));
+   memcpy(m.ram + 0x0300, routine, sizeof(routine));
+   memcpy(m.ram + 0x0400, irq, sizeof(irq));
+   memcpy(m.ram + 0x0500, nmi, sizeof(nmi));
+   m.ram[0xFFFA] = 0x00; m.ram[0xFFFB] = 0x05;
+   m.ram[0xFFFC] = 0x00; m.ram[0xFFFD] = 0x02;
+   m.ram[0xFFFE] = 0x00; m.ram[0xFFFF] = 0x04;
+   m.count = 0;
+   m.stamp = 0;
+
+   mos6502* cpu = Create(clock);
+   m.cpu = cpu;
+   cpu->Reset();
+
+   uint64_t cycles = 0;
+   for(int i = 0; i < SLICES; i++)
+   {
+      if (i == SNAPSHOT) Save(cycles);
+      Run(i, cycles, first[i]);
+   }
+
+   // the same CPU back in time, then a new CPU taking over from the snapshot
+   for(int pass = 0; pass < 2; pass++)
+   {
+      if (pass == 1)
+      {
+         m.cpu = Create(clock);
+      }
+      Restore(cycles);
+      m.stamp = savedState.cycleStamp;
+
+      for(int i = SNAPSHOT; i < SLICES; i++)
+      {
+         Run(i, cycles, again);
+         if (!Same(first[i], again))
+         {
+            printf("FAIL: %s, %s CPU, slice %d\n",
+                  clock ? "clocked" : "not clocked",
+                  pass ? "new" : "same", i);
+            Print("first", first[i]);
+            Print("again", again);
+            return false;
+         }
+      }
+      if (pass == 1) delete m.cpu;
+   }
+
+   delete cpu;
+   return true;
+}
+
+static double Nanoseconds(std::chrono::steady_clock::time_point start, int n)
+{
+   return std::chrono::duration<double, std::nano>(
+         std::chrono::steady_clock::now() - start).count() / n;
+}
+
+int main(int argc, char **argv)
+{
+   uint32_t seed = 0x6502;
+   for(int i = 0; i < SLICES; i++)
+   {
+      seed = seed * 1103515245 + 12345;
+      uint32_t r = seed >> 8;
+      slices[i].budget = 1 + r % 700;
+      slices[i].method = (r >> 10) & 1 ? mos6502::CYCLE_COUNT : mos6502::INST_COUNT;
+      slices[i].irq = (r >> 11) % 5 == 0;
+      slices[i].nmi = (r >> 14) % 7 == 0;
+   }
+   // both interrupts pending in the snapshot
+   slices[SNAPSHOT - 1].irq = true;
+   slices[SNAPSHOT - 1].nmi = true;
+
+   if (!Check(false) || !Check(true)) return 1;
+
+   // what a snapshot costs
+   const int n = 1000000;
+   mos6502* cpu = Create(false);
+   m.cpu = cpu;
+   cpu->Reset();
+   mos6502::State state;
+
+   auto start = std::chrono::steady_clock::now();
+   for(int i = 0; i < n; i++)
+   {
+      cpu->SaveState(state);
+      state.A += i;
+      cpu->LoadState(state);
+   }
+   double stateNs = Nanoseconds(start, n);
+
+   const int k = 10000;
+   start = std::chrono::steady_clock::now();
+   for(int i = 0; i < k; i++)
+   {
+#ifdef MEMORY_MAP
+      cpu->SaveRAM(saved);
+      saved[i & 0xFFFF]++;
+      cpu->LoadRAM(saved);
+#else
+      memcpy(saved, m.ram, 0xE000);
+      saved[i & 0xFFFF]++;
+      memcpy(m.ram, saved, 0xE000);
+#endif
+   }
+   double ramNs = Nanoseconds(start, k);
+   delete cpu;
+
+   printf("%d slices replayed from slice %d, on the same CPU and on a new one\n",
+         SLICES - SNAPSHOT, SNAPSHOT);
+   printf("SaveState() + LoadState(): %.1f ns, 56K of RAM saved and loaded: %.2f us\n",
+         stateNs, ramNs / 1000);
+   return 0;
+}
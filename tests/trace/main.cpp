@@ -0,0 +1,204 @@
+// compile with "g++ -O3 -pthread -DTRACE main.cpp ../../mos6502.cpp
+// ../../mos6502_trace.cpp -o main"
+//
+// traces a run to a file, in slices, then reads the file back and checks
+// every record against a reference CPU run instruction by instruction:
+// cycle, PC, opcode, operands, registers and cycles taken, and the
+// effective address and data of the stores, immediates and branches.
+// Also prints how fast the trace goes to disk.
+
+#include "../../mos6502_trace.h"
+#include "../differential.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <chrono>
+
+#define INSTRUCTIONS 2000000
+#define FILENAME     "trace.bin"
+
+static const uint8_t program[] = {
+   0xA2, 0x00,             // 0200 LDX #$00
+   0xA9, 0x37,             // 0202 LDA #$37
+   0x9D, 0xF0, 0x10,       // 0204 STA $10F0,X
+   0x7D, 0xF0, 0x10,       // 0207 ADC $10F0,X
+   0x20, 0x00, 0x03,       // 020A JSR $0300
+   0xE8,                   // 020D INX
+   0xD0, 0xF2,             // 020E BNE $0202
+   0xE6, 0x40,             // 0210 INC $40
+   0xA4, 0x40,             // 0212 LDY $40
+   0xB1, 0x30,             // 0214 LDA ($30),Y
+   0xF8,                   // 0216 SED
+   0x69, 0x19,             // 0217 ADC #$19
+   0xD8,                   // 0219 CLD
+   0x91, 0x30,             // 021A STA ($30),Y
+   0x4C, 0x00, 0x02,       // 021C JMP $0200
+};
+
+static const uint8_t routine[] = {
+   0x48,                   // 0300 PHA
+   0x45, 0x41,             // 0301 EOR $41
+   0x85, 0x41,             // 0303 STA $41
+   0x68,                   // 0305 PLA
+   0x60,                   // 0306 RTS
+};
+
+static void Program(uint8_t* ram)
+{
+   memcpy(ram + 0x0200, program, sizeof(program));
+   memcpy(ram + 0x0300, routine, sizeof(routine));
+   ram[0x30] = 0x00; ram[0x31] = 0x20;
+   ram[0xFFFC] = 0x00; ram[0xFFFD] = 0x02;
+}
+
+// bytes of an official opcode, itself included
+static int Length(uint8_t op)
+{
+   switch(op & 0x0F)
+   {
+      case 0x0: return op & 0x10 ? 2 : op == 0x20 ? 3 : op >= 0x80 ? 2 : 1;
+      case 0x2: return op == 0xA2 ? 2 : 1;
+      case 0x1: case 0x4: case 0x5: case 0x6: return 2;
+      case 0x9: return op & 0x10 ? 3 : 2;
+      case 0xC: case 0xD: case 0xE: return 3;
+   }
+   return 1;
+}
+
+static double Seconds(std::chrono::steady_clock::time_point start)
+{
+   return std::chrono::duration<double>(
+         std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char **argv)
+{
+   // the traced run, in slices of random size
+   mos6502 cpu(read, write);
+   Setup(tested, cpu);
+   current = &tested;
+#ifdef MEMORY_MAP
+   cpu.MapRAM(0x00, 0xFF, tested.ram);
+#endif
+   cpu.Reset();
+
+   FILE* file = fopen(FILENAME, "wb");
+   if (!file)
+   {
+      printf("FAIL: cannot create %s\n", FILENAME);
+      return 1;
+   }
+   mos6502_trace* trace = new mos6502_trace(&cpu, file, 4096);
+   uint64_t cycles = 0;
+   uint32_t seed = 0x6502;
+   int64_t left = INSTRUCTIONS;
+   while(left > 0)
+   {
+      seed = seed * 1103515245 + 12345;
+      int32_t n = 1 + (seed >> 8) % 3000;
+      if (n > left) n = left;
+      cpu.Run(n, cycles, mos6502::INST_COUNT);
+      left -= n;
+   }
+   trace->Close();
+   if (trace->Failed() || trace->GetRecords() != INSTRUCTIONS)
+   {
+      printf("FAIL: %llu records written of %d%s\n",
+            (unsigned long long)trace->GetRecords(), INSTRUCTIONS,
+            trace->Failed() ? ", a write failed" : "");
+      return 1;
+   }
+   uint64_t stalls = trace->GetStalls();
+   delete trace;
+   fclose(file);
+
+   // the records against the reference, one instruction at a time
+   mos6502 ref(read, write);
+   Setup(reference, ref);
+   current = &reference;
+#ifdef MEMORY_MAP
+   ref.MapRAM(0x00, 0xFF, reference.ram);
+#endif
+   ref.Reset();
+   file = fopen(FILENAME, "rb");
+   uint64_t refCycles = 0;
+   mos6502::TraceRecord r;
+   for(int i = 0; i < INSTRUCTIONS; i++)
+   {
+      if (fread(&r, sizeof(r), 1, file) != 1)
+      {
+         printf("FAIL: the file ends at record %d\n", i);
+         return 1;
+      }
+
+      uint16_t pc = ref.GetPC();
+      uint8_t op = reference.ram[pc];
+      uint8_t a = ref.GetA(), x = ref.GetX(), y = ref.GetY();
+      uint8_t p = ref.GetP(), s = ref.GetS();
+      uint64_t before = refCycles;
+      ref.Run(1, refCycles, mos6502::INST_COUNT);
+
+      int len = Length(op);
+      uint8_t op0 = len > 1 ? reference.ram[(uint16_t)(pc + 1)] : 0;
+      uint8_t op1 = len > 2 ? reference.ram[(uint16_t)(pc + 2)] : 0;
+      uint16_t abs = op0 | op1 << 8;
+      bool bad = r.cycle != before || r.pc != pc || r.opcode != op ||
+         r.operand[0] != op0 || r.operand[1] != op1 ||
+         r.A != a || r.X != x || r.Y != y || r.P != p || r.S != s ||
+         r.cycles != refCycles - before;
+      if (op == 0x9D) bad |= r.addr != (uint16_t)(abs + x) || r.data != a;
+      if (op == 0xA9 || op == 0x69) bad |= r.data != op0;
+      if (op == 0xD0) bad |= r.addr != (uint16_t)(pc + 2 + (int8_t)op0);
+      if (op == 0xE8 || op == 0xD8 || op == 0xF8) bad |= r.data != 0;
+      if (bad)
+      {
+         printf("FAIL: record %d\n", i);
+         printf("trace:     cycle %llu pc %04X op %02X %02X %02X a %02X x %02X y %02X p %02X s %02X "
+               "cycles %d addr %04X data %02X\n", (unsigned long long)r.cycle, r.pc, r.opcode,
+               r.operand[0], r.operand[1], r.A, r.X, r.Y, r.P, r.S, r.cycles, r.addr, r.data);
+         printf("reference: cycle %llu pc %04X op %02X %02X %02X a %02X x %02X y %02X p %02X s %02X "
+               "cycles %d\n", (unsigned long long)before, pc, op, op0, op1, a, x, y, p, s,
+               (int)(refCycles - before));
+         return 1;
+      }
+   }
+   if (fread(&r, sizeof(r), 1, file) != 0)
+   {
+      printf("FAIL: more records than instructions\n");
+      return 1;
+   }
+   fclose(file);
+
+   // throughput, the same CPU without and with the trace
+   const int64_t total = 20000000;
+   current = &tested;
+   auto start = std::chrono::steady_clock::now();
+   for(int64_t n = 0; n < total; n += 10000)
+   {
+      cpu.Run(10000, cycles, mos6502::INST_COUNT);
+   }
+   double offSeconds = Seconds(start);
+
+   file = fopen(FILENAME, "wb");
+   start = std::chrono::steady_clock::now();
+   trace = new mos6502_trace(&cpu, file);
+   for(int64_t n = 0; n < total; n += 10000)
+   {
+      cpu.Run(10000, cycles, mos6502::INST_COUNT);
+   }
+   trace->Close();
+   fclose(file);
+   double onSeconds = Seconds(start);
+   remove(FILENAME);
+
+   printf("%d instructions traced in slices: every record matches the reference, "
+         "%llu waits for the writer\n", INSTRUCTIONS, (unsigned long long)stalls);
+   printf("%.1f MIPS without the trace, %.1f MIPS traced to disk (%.0f MB/s, %llu waits)\n",
+         total / offSeconds / 1e6, total / onSeconds / 1e6,
+         total * sizeof(mos6502::TraceRecord) / onSeconds / 1e6,
+         (unsigned long long)trace->GetStalls());
+   delete trace;
+   return 0;
+}
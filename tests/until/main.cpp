@@ -0,0 +1,314 @@
+// compile with "g++ -O3 -DBREAKPOINTS main.cpp ../../mos6502.cpp -o main"
+//
+// calls RunUntil() with random conditions, under IRQs, each call from
+// where the last one stopped, and checks every stop against a reference
+// CPU run instruction by instruction on the plain bus: the reason, the
+// address and the exact cycles the call took. Then halts on an illegal
+// opcode. Also prints how fast it runs with Run() and with RunUntil()
+// on a condition never met.
+
+#include "../differential.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <chrono>
+
+#define CALLS 5000
+
+static const uint8_t program[] = {
+   0xA2, 0x00,             // 0200 LDX #$00
+   0xBD, 0x00, 0x20,       // 0202 LDA $2000,X
+   0x69, 0x01,             // 0205 ADC #$01
+   0x9D, 0x00, 0x30,       // 0207 STA $3000,X
+   0xE8,                   // 020A INX
+   0xD0, 0xF5,             // 020B BNE $0202
+   0xE6, 0x40,             // 020D INC $40
+   0x00, 0xEA,             // 020F BRK
+   0xA5, 0x40,             // 0211 LDA $40
+   0xC9, 0xC0,             // 0213 CMP #$C0
+   0xD0, 0xE9,             // 0215 BNE $0200
+   0x4C, 0x17, 0x02,       // 0217 JMP $0217
+};
+
+static const uint8_t irq[] = {
+   0x48,                   // 0400 PHA
+   0x8D, 0x00, 0xD0,       // 0401 STA $D000, releases the line
+   0x68,                   // 0404 PLA
+   0x40,                   // 0405 RTI
+};
+
+static const uint16_t targets[] = { 0x0205, 0x020D, 0x0217 };
+
+static bool vectorRead;
+
+static void Read(uint16_t addr)
+{
+   if (addr == 0xFFFE) vectorRead = true;
+}
+
+static void Write(uint16_t addr, uint8_t value)
+{
+   if (addr == 0xD000) current->cpu->IRQ(true);
+}
+
+static void Program(uint8_t* ram)
+{
+   memcpy(ram + 0x0200, program, sizeof(program));
+   memcpy(ram + 0x0400, irq, sizeof(irq));
+   for(int i = 0; i < 256; i++)
+   {
+      ram[0x2000 + i] = i * 7;
+   }
+   ram[0x0500] = 0x02;   // JAM
+   ram[0xFFFC] = 0x00; ram[0xFFFD] = 0x02;
+   ram[0xFFFE] = 0x00; ram[0xFFFF] = 0x04;
+}
+
+static void IrqEvent(mos6502* cpu, void* ctx, uint64_t when, uint64_t now)
+{
+   cpu->IRQ(false);
+   cpu->ScheduleEvent(when + 1499, &IrqEvent);
+}
+
+static bool IsTarget(uint16_t addr)
+{
+   for(uint16_t t : targets)
+   {
+      if (t == addr) return true;
+   }
+   return false;
+}
+
+static bool IsJump(uint8_t op)
+{
+   return (op & 0x1F) == 0x10 || op == 0x4C || op == 0x6C;
+}
+
+static double Seconds(std::chrono::steady_clock::time_point start)
+{
+   return std::chrono::duration<double>(
+         std::chrono::steady_clock::now() - start).count();
+}
+
+static const char* Name(int reason)
+{
+   static const char* names[] = { "none", "breakpoint", "read", "write", "target",
+         "cycles", "instructions", "brk", "trap", "jam" };
+   return names[reason];
+}
+
+// one instruction of the reference, and the interrupt entry before it
+struct Step
+{
+   uint16_t pc;        // before the entry
+   uint16_t addr;      // of the instruction
+   uint16_t after;     // pc after it
+   uint8_t op;
+   uint64_t begin;     // cycle before the entry
+   uint64_t start;     // and after it
+   uint64_t end;
+};
+
+static uint64_t refCycles;
+
+static Step RefStep(mos6502& ref)
+{
+   Step s;
+   s.pc = ref.GetPC();
+   s.begin = refCycles;
+   vectorRead = false;
+   ref.Run(1, refCycles, mos6502::INST_COUNT);
+   s.end = refCycles;
+   s.after = ref.GetPC();
+   s.addr = s.pc;
+   s.start = s.begin;
+
+   // the vector was read by an IRQ taken first, unless by the BRK itself
+   if (vectorRead && !(reference.ram[s.pc] == 0x00 && s.after == 0x0400))
+   {
+      s.addr = 0x0400;
+      s.start += 6;
+   }
+   s.op = reference.ram[s.addr];
+   return s;
+}
+
+int main(int argc, char **argv)
+{
+   mos6502 cpu(read, write);
+   mos6502 ref(read, write);
+   Setup(tested, cpu);
+   Setup(reference, ref);
+   onRead = Read;
+   onWrite = Write;
+#ifdef MEMORY_MAP
+   cpu.MapRAM(0x00, 0xCF, tested.ram);
+#endif
+
+   uint64_t cycles = 0;
+   current = &tested;
+   cpu.Reset();
+   cpu.ScheduleEvent(700, &IrqEvent);
+   current = &reference;
+   ref.Reset();
+   ref.ScheduleEvent(700, &IrqEvent);
+
+   // the reference runs one step ahead of the tested CPU: cur is the
+   // next instruction, entered when a target stopped after its entry
+   Step cur = RefStep(ref);
+   bool entered = false;
+   bool resume = false;
+   uint32_t seed = 0x6502;
+   int count[10] = { 0 };
+   for(int i = 0; i < CALLS; i++)
+   {
+      mos6502::StopConditions until;
+      seed = seed * 1103515245 + 12345;
+      if (seed & 0x10000) until.cycles = 1 + (seed >> 20) % 3000;
+      if (seed & 0x20000) until.instructions = 1 + (seed >> 8) % 1000;
+      if (seed & 0x40000)
+      {
+         until.pcs = targets;
+         until.pcCount = 3;
+      }
+      until.brk = (seed & 0x80000) != 0;
+      until.trap = (seed & 0x100000) != 0;
+      if (until.cycles == UINT64_MAX && until.instructions == UINT64_MAX)
+      {
+         until.cycles = 1 + (seed >> 12) % 30000;
+      }
+
+      // where the reference stops, stepping as RunUntil() checks
+      mos6502::StopReason reason;
+      uint64_t from = entered ? cur.start : cur.begin;
+      uint64_t to;
+      uint16_t addr;
+      uint64_t n = 0;
+      for(bool first = true; ; first = false)
+      {
+         uint64_t now = entered ? cur.start : cur.begin;
+         if (now - from >= until.cycles)
+         {
+            reason = mos6502::STOP_CYCLES;
+            to = now;
+            addr = entered ? cur.addr : cur.pc;
+            break;
+         }
+         if (n == until.instructions)
+         {
+            reason = mos6502::STOP_INSTRUCTIONS;
+            to = now;
+            addr = entered ? cur.addr : cur.pc;
+            break;
+         }
+         if (until.pcCount && IsTarget(cur.addr) && !(first && resume))
+         {
+            reason = mos6502::STOP_TARGET;
+            to = cur.start;
+            addr = cur.addr;
+            entered = true;
+            break;
+         }
+         Step done = cur;
+         n++;
+         cur = RefStep(ref);
+         entered = false;
+         if (until.brk && done.op == 0x00)
+         {
+            reason = mos6502::STOP_BRK;
+            to = done.end;
+            addr = done.addr;
+            break;
+         }
+         if (until.trap && IsJump(done.op) && done.after == done.addr)
+         {
+            reason = mos6502::STOP_TRAP;
+            to = done.end;
+            addr = done.addr;
+            break;
+         }
+      }
+      resume = reason == mos6502::STOP_TARGET;
+
+      current = &tested;
+      uint64_t before = cycles;
+      mos6502::RunResult result = cpu.RunUntil(until, cycles);
+      current = &reference;
+      if (result.reason != reason || result.addr != addr || result.cycles != to - from ||
+            cycles != before + result.cycles || cpu.GetStopReason() != reason ||
+            (reason != mos6502::STOP_BRK && reason != mos6502::STOP_TRAP && cpu.GetPC() != addr))
+      {
+         printf("FAIL: call %d\n", i);
+         printf("tested:    %s at %04X, %llu cycles, pc %04X\n", Name(result.reason),
+               result.addr, (unsigned long long)result.cycles, cpu.GetPC());
+         printf("reference: %s at %04X, %llu cycles\n", Name(reason), addr,
+               (unsigned long long)(to - from));
+         return 1;
+      }
+      count[reason]++;
+   }
+   for(int r = mos6502::STOP_TARGET; r <= mos6502::STOP_TRAP; r++)
+   {
+      if (!count[r])
+      {
+         printf("FAIL: no %s stop was seen\n", Name(r));
+         return 1;
+      }
+   }
+
+   // the targets were for the call only
+   mos6502::StopConditions budget;
+   budget.cycles = 100000;
+   current = &tested;
+   if (cpu.RunUntil(budget, cycles).reason != mos6502::STOP_CYCLES)
+   {
+      printf("FAIL: a target is left after RunUntil()\n");
+      return 1;
+   }
+
+   // an illegal opcode halts, and every call after stops on it at once
+   cpu.SetPC(0x0500);
+   mos6502::RunResult jam = cpu.RunUntil(budget, cycles);
+   mos6502::RunResult again = cpu.RunUntil(budget, cycles);
+   if (jam.reason != mos6502::STOP_JAM || jam.addr != 0x0500 || !cpu.IsHalted() ||
+         again.reason != mos6502::STOP_JAM || again.cycles != 0)
+   {
+      printf("FAIL: %s at %04X on the illegal opcode\n", Name(jam.reason), jam.addr);
+      return 1;
+   }
+
+   // throughput, with Run() and with RunUntil() on what never happens
+   cpu.Reset();
+   const int64_t total = 20000000;
+   auto start = std::chrono::steady_clock::now();
+   for(int64_t k = 0; k < total; k += 10000)
+   {
+      cpu.Run(10000, cycles, mos6502::INST_COUNT);
+   }
+   double runSeconds = Seconds(start);
+
+   const uint16_t never = 0x0600;
+   mos6502::StopConditions none;
+   none.pcs = &never;
+   none.pcCount = 1;
+   none.instructions = total;
+   none.brk = true;
+   start = std::chrono::steady_clock::now();
+   mos6502::RunResult last = cpu.RunUntil(none, cycles);
+   double untilSeconds = Seconds(start);
+   if (last.reason != mos6502::STOP_INSTRUCTIONS)
+   {
+      printf("FAIL: %s at %04X running the budget\n", Name(last.reason), last.addr);
+      return 1;
+   }
+
+   printf("%d calls (%d targets, %d cycles, %d instructions, %d brk, %d traps): every stop "
+         "matches the reference\n", CALLS, count[mos6502::STOP_TARGET],
+         count[mos6502::STOP_CYCLES], count[mos6502::STOP_INSTRUCTIONS],
+         count[mos6502::STOP_BRK], count[mos6502::STOP_TRAP]);
+   printf("%.1f MIPS with Run(), %.1f MIPS with RunUntil()\n",
+         total / runSeconds / 1e6, total / untilSeconds / 1e6);
+   return 0;
+}